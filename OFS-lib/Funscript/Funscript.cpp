@@ -6,6 +6,9 @@
 #include "OFS_EventSystem.h"
 #include "OFS_Serialization.h"
 #include "FunscriptUndoSystem.h"
+#include "FunscriptReader.h"
+#include "FunscriptWriter.h"
+#include "FunscriptCache.h"
 
 #include "state/states/ChapterState.h"
 
@@ -42,6 +45,89 @@ void Funscript::loadMetadata(const nlohmann::json& metadataObj, Funscript::Metad
 	OFS::Serializer<false>::Deserialize(outMetadata, metadataObj);
 }
 
+void Funscript::loadChapterState(const nlohmann::json& jsonMetadata) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	auto& chapterState = ChapterState::StaticStateSlow();
+
+	if(jsonMetadata.contains("bookmarks"))
+	{
+		auto& jsonBookmarks = jsonMetadata["bookmarks"];
+		if(jsonBookmarks.is_array())
+		{
+			for(auto& jsonBookmark : jsonBookmarks)
+			{
+				if(!jsonBookmark.contains("name") || !jsonBookmark.contains("time"))
+					continue;
+				if(!jsonBookmark["name"].is_string() || !jsonBookmark["time"].is_string())
+					continue;
+
+				auto name = std::move(jsonBookmark["name"].get<std::string>());
+				auto timeStr = std::move(jsonBookmark["time"].get<std::string>());
+
+				bool succ = false;
+				float time = Util::ParseTime(timeStr.c_str(), &succ);
+				if(!succ) 
+				{
+					LOGF_ERROR("Failed to parse \"%s\" to time", timeStr.c_str());
+					continue;
+				}
+
+				if(auto bookmark = chapterState.AddBookmark(time)) 
+				{
+					bookmark->name = std::move(name);
+				}
+			}
+		}
+	}
+
+	if(jsonMetadata.contains("chapters"))
+	{
+		auto& jsonChapters = jsonMetadata["chapters"];
+		if(jsonChapters.is_array())
+		{
+			for(auto& jsonChapter : jsonChapters)
+			{
+				if(!jsonChapter.contains("name") || !jsonChapter.contains("startTime") || !jsonChapter.contains("endTime"))
+					continue;
+				if(!jsonChapter["name"].is_string() || !jsonChapter["startTime"].is_string() || !jsonChapter["endTime"].is_string())
+					continue;
+				
+				auto name = std::move(jsonChapter["name"].get<std::string>());
+				auto startTimeStr = std::move(jsonChapter["startTime"].get<std::string>());
+				auto endTimeStr = std::move(jsonChapter["endTime"].get<std::string>());
+
+				bool succ = false;
+				float startTime = Util::ParseTime(startTimeStr.c_str(), &succ);
+				if(!succ) 
+				{
+					LOGF_ERROR("Failed to parse \"%s\" to time", startTimeStr.c_str());
+					continue;
+				}
+				float endTime = Util::ParseTime(endTimeStr.c_str(), &succ);
+				if(!succ)
+				{
+					LOGF_ERROR("Failed to parse \"%s\" to time", endTimeStr.c_str());
+					continue;
+				}
+
+				if(startTime > endTime)
+					continue;
+
+				// Insert chapter at the middle point				
+				float middlePoint = startTime + ((endTime - startTime)/2.f);
+				if(auto chapter = chapterState.AddChapter(middlePoint, 1.f))
+				{
+					chapter->name = std::move(name);
+					// Set size is used to safely resize the chapter to the correct size
+					chapterState.SetChapterSize(*chapter, startTime);
+					chapterState.SetChapterSize(*chapter, endTime);
+				}
+			}
+		}
+	}
+}
+
 void Funscript::saveMetadata(nlohmann::json& outMetadataObj, const Funscript::Metadata& inMetadata) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
@@ -50,6 +136,27 @@ void Funscript::saveMetadata(nlohmann::json& outMetadataObj, const Funscript::Me
 
 void Funscript::notifyActionsChanged(bool isEdit) noexcept
 {
+	pendingChange.Full = true;
+	pendingChange.Edit |= isEdit;
+	pendingChange.Version = ++editVersion;
+	strokes.Invalidate();
+	statistics.Invalidate();
+	funscriptChanged = true;
+	if (isEdit && !unsavedEdits) {
+		unsavedEdits = true;
+		editTime = std::chrono::system_clock::now();
+	}
+}
+
+void Funscript::notifyActionsChanged(bool isEdit, FunscriptTime fromTime, FunscriptTime toTime, uint32_t inserted, uint32_t removed) noexcept
+{
+	pendingChange.Extend(fromTime, toTime);
+	strokes.Invalidate(fromTime, toTime);
+	statistics.Invalidate(fromTime, toTime);
+	pendingChange.Inserted += inserted;
+	pendingChange.Removed += removed;
+	pendingChange.Edit |= isEdit;
+	pendingChange.Version = ++editVersion;
 	funscriptChanged = true;
 	if (isEdit && !unsavedEdits) {
 		unsavedEdits = true;
@@ -62,7 +169,8 @@ void Funscript::Update() noexcept
 	OFS_PROFILE(__FUNCTION__);
 	if (funscriptChanged) {
 		funscriptChanged = false;
-		EV::Enqueue<FunscriptActionsChangedEvent>(this);
+		EV::Enqueue<FunscriptActionsChangedEvent>(this, pendingChange);
+		pendingChange = FunscriptChange();
 	}
 	if (selectionChanged) {
 		selectionChanged = false;
@@ -76,16 +184,13 @@ float Funscript::GetPositionAtTime(float time) const noexcept
 	if (data.Actions.size() == 0) {	return 0; } 
 	else if (data.Actions.size() == 1) return data.Actions[0].pos;
 
-	int i = 0;
 	auto it = data.Actions.lower_bound(FunscriptAction(time, 0));
-	if (it != data.Actions.end()) {
-		i = std::distance(data.Actions.begin(), it);
-		if (i > 0) --i;
-	}
+	if (it == data.Actions.end()) it = data.Actions.begin();
+	else if (it != data.Actions.begin()) --it;
 
-	for (; i < data.Actions.size()-1; i++) {
-		auto& action = data.Actions[i];
-		auto& next = data.Actions[i + 1];
+	for (auto last = data.Actions.end() - 1; it != last; ++it) {
+		auto& action = *it;
+		auto& next = *(it + 1);
 
 		if (time > action.atS && time < next.atS) {
 			// interpolate position
@@ -104,15 +209,34 @@ float Funscript::GetPositionAtTime(float time) const noexcept
 	return data.Actions.back().pos;
 }
 
+void Funscript::GetPositionsAtTimes(const float* times, uint32_t count, float* outPositions, Interpolation mode) const noexcept
+{
+	FunscriptSpline::SampleTimes(data.Actions, times, count, outPositions, mode);
+}
+
+void Funscript::GetPositionsAtTimes(float startTime, float step, uint32_t count, float* outPositions, Interpolation mode) const noexcept
+{
+	FunscriptSpline::SampleSteps(data.Actions, startTime, step, count, outPositions, mode);
+}
+
+void Funscript::addAction(FunscriptAction newAction) noexcept
+{
+	auto it = data.Actions.lower_bound(newAction);
+	uint32_t idx = std::distance(data.Actions.begin(), it);
+	bool inserted = data.Actions.emplace(newAction);
+	if (inserted) data.Selection.Insert(idx, 1);
+	notifyActionsChanged(true, newAction.atS, newAction.atS, inserted ? 1 : 0, 0);
+}
+
 void Funscript::AddMultipleActions(const FunscriptArray& actions) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	for(auto& action : actions)
-	{
-		data.Actions.emplace(action);
-	}
-	sortActions(data.Actions);
-	notifyActionsChanged(true);
+	if (actions.empty()) return;
+	size_t inserted = 0;
+	preserveSelection([&]() {
+		inserted = data.Actions.merge(actions.begin(), actions.end());
+	});
+	notifyActionsChanged(true, actions.front().atS, actions.back().atS, inserted, 0);
 }
 
 
@@ -120,16 +244,25 @@ bool Funscript::EditAction(FunscriptAction oldAction, FunscriptAction newAction)
 {
 	OFS_PROFILE(__FUNCTION__);
 	// update action
-	auto act = getAction(oldAction);
-	if (act != nullptr) {
-		act->atS = newAction.atS;
-		act->pos = newAction.pos;
-		checkForInvalidatedActions();
-		notifyActionsChanged(true);
-		sortActions(data.Actions);
-		return true;
-	}
-	return false;
+	auto idx = actionIndex(oldAction);
+	if (idx == FunscriptSelection::None) return false;
+
+	// move the action to its new sorted position and carry the selection bit with it
+	FunscriptAction moved = data.Actions[idx];
+	moved.atS = newAction.atS;
+	moved.pos = newAction.pos;
+	bool selected = data.Selection.Test(idx);
+	data.Actions.erase(data.Actions.begin() + idx);
+	data.Selection.Erase(idx, 1);
+
+	auto it = data.Actions.upper_bound(moved);
+	uint32_t newIdx = std::distance(data.Actions.begin(), it);
+	data.Actions.insert(it, moved);
+	data.Selection.Insert(newIdx, 1);
+	data.Selection.Set(newIdx, selected);
+
+	notifyActionsChanged(true, oldAction.atS, newAction.atS, 0, 0);
+	return true;
 }
 
 void Funscript::AddEditAction(FunscriptAction action, float frameTime) noexcept
@@ -137,129 +270,160 @@ void Funscript::AddEditAction(FunscriptAction action, float frameTime) noexcept
 	OFS_PROFILE(__FUNCTION__);
 	auto close = getActionAtTime(data.Actions, action.atS, frameTime);
 	if (close != nullptr) {
+		FunscriptTime oldTime = close->atS;
 		*close = action;
-		notifyActionsChanged(true);
-		checkForInvalidatedActions();
+		notifyActionsChanged(true, oldTime, action.atS, 0, 0);
 	}
 	else {
 		AddAction(action);
 	}
 }
 
-void Funscript::checkForInvalidatedActions() noexcept
+template<typename Container>
+inline static bool selectExactly(const FunscriptArray& actions, FunscriptSelection& selection, const Container& selected) noexcept
 {
-	OFS_PROFILE(__FUNCTION__);
-	auto it = std::remove_if(data.Selection.begin(), data.Selection.end(), 
-		[this](auto selected) {
-			auto found = getAction(selected);
-			return !found;
-		});
-		
-	if (it != data.Selection.end()) {
-		data.Selection.erase(it, data.Selection.end());
-		notifySelectionChanged();
+	selection.Resize(actions.size());
+	bool hadSelection = !selection.Empty();
+	selection.Clear();
+
+	ActionLess less;
+	uint32_t idx = 0;
+	auto it = actions.cbegin(), end = actions.cend();
+	auto selIt = selected.cbegin(), selEnd = selected.cend();
+	while (it != end && selIt != selEnd) {
+		if (less(*selIt, *it)) { ++selIt; }
+		else if (less(*it, *selIt)) { ++it; ++idx; }
+		else {
+			if (*selIt == *it) selection.Set(idx, true);
+			++it; ++idx; ++selIt;
+		}
 	}
+	return hadSelection || !selected.empty();
+}
+
+void Funscript::restoreSelection(const FunscriptArray& selected) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	if (selectExactly(data.Actions, data.Selection, selected)) notifySelectionChanged();
 }
 
-void Funscript::RemoveAction(FunscriptAction action, bool checkInvalidSelection) noexcept
+void Funscript::restoreSelection(const FunscriptFrameArray& selected) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	auto it = data.Actions.find(action);
-	if (it != data.Actions.end()) {
-		data.Actions.erase(it);
-		notifyActionsChanged(true);
+	if (selectExactly(data.Actions, data.Selection, selected)) notifySelectionChanged();
+}
 
-		if (checkInvalidSelection) { checkForInvalidatedActions(); }
+uint32_t Funscript::eraseSelectedActions() noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	auto& actions = data.Actions;
+	uint32_t removed = data.Selection.Count();
+	if (removed == actions.size()) {
+		actions.clear();
 	}
+	else if (removed > 0) {
+		// single pass compaction over the unselected actions
+		uint32_t idx = data.Selection.First();
+		auto out = actions.begin() + idx;
+		auto it = out;
+		for (auto end = actions.end(); it != end; ++it, ++idx) {
+			if (!data.Selection.Test(idx)) *out++ = *it;
+		}
+		actions.erase(out, actions.end());
+	}
+	data.Selection.Clear();
+	data.Selection.Resize(actions.size());
+	return removed;
 }
 
-void Funscript::RemoveActions(const FunscriptArray& removeActions) noexcept
+void Funscript::RemoveAction(FunscriptAction action) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	auto it = std::remove_if(data.Actions.begin(), data.Actions.end(),
-		[&removeActions, end = removeActions.end()](auto action) {
-			if (removeActions.find(action) != end) {
-				return true;
-			}
-			return false;
-		});
-	data.Actions.erase(it, data.Actions.end());
+	auto idx = actionIndex(action);
+	if (idx != FunscriptSelection::None) {
+		data.Actions.erase(data.Actions.begin() + idx);
+		if (data.Selection.Test(idx)) notifySelectionChanged();
+		data.Selection.Erase(idx, 1);
+		notifyActionsChanged(true, action.atS, action.atS, 0, 1);
+	}
+}
 
-	notifyActionsChanged(true);
-	checkForInvalidatedActions();
+void Funscript::RemoveActions(const FunscriptArray& removeActions) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	if (removeActions.empty()) return;
+	size_t removed = 0;
+	preserveSelection([&]() {
+		removed = data.Actions.erase_sorted(removeActions.begin(), removeActions.end());
+	});
+	notifyActionsChanged(true, removeActions.front().atS, removeActions.back().atS, 0, removed);
 }
 
 std::vector<FunscriptAction> Funscript::GetLastStroke(float time) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	// TODO: refactor...
-	// assuming "*it" is a peak bottom or peak top
-	// if you went up it would return a down stroke and if you went down it would return a up stroke
-	auto it = std::min_element(data.Actions.begin(), data.Actions.end(),
-		[time](auto a, auto b) {
-			return std::abs(a.atS - time) < std::abs(b.atS - time);
-		});
-	if (it == data.Actions.end() || it-1 == data.Actions.begin()) return std::vector<FunscriptAction>(0);
-
-	std::vector<FunscriptAction> stroke;
-	stroke.reserve(5);
-
-	// search previous stroke
-	bool goingUp = (it - 1)->pos > it->pos;
-	int32_t prevPos = (it-1)->pos;
-	for (auto searchIt = it-1; searchIt != data.Actions.begin(); searchIt--) {
-		if ((searchIt - 1)->pos > prevPos != goingUp) {
-			break;
-		}
-		else if ((searchIt - 1)->pos == prevPos && (searchIt-1)->pos != searchIt->pos) {
-			break;
-		}
-		prevPos = (searchIt - 1)->pos;
-		it = searchIt;
-	}
-
-	it--;
-	if (it == data.Actions.begin()) return std::vector<FunscriptAction>(0);
-	goingUp = !goingUp;
-	prevPos = it->pos;
-	stroke.emplace_back(*it);
-	it--;
-	for (;; it--) {
-		bool up = it->pos > prevPos;
-		if (up != goingUp) {
-			break;
-		}
-		else if (it->pos == prevPos) {
-			break;
-		}
-		stroke.emplace_back(*it);
-		prevPos = it->pos;
-		if (it == data.Actions.begin()) break;
+	if (data.Actions.empty()) return std::vector<FunscriptAction>(0);
+	auto closest = data.Actions.lower_bound(FunscriptAction(time, 0));
+	if (closest == data.Actions.end()
+		|| (closest != data.Actions.begin() && std::abs((closest - 1)->atS - time) <= std::abs(closest->atS - time))) {
+		--closest;
+	}
+
+	// the stroke leading up to the closest action, the one before it gets returned
+	auto& strokeIndex = Strokes();
+	uint32_t current = strokeIndex.StrokeAt(closest->atS);
+	if (current == FunscriptStrokeIndex::None || current == 0) return std::vector<FunscriptAction>(0);
+	auto stroke = strokeIndex[current - 1];
+
+	auto first = data.Actions.lower_bound(stroke.From);
+	auto last = data.Actions.upper_bound(stroke.To);
+	std::vector<FunscriptAction> actions;
+	actions.reserve(std::distance(first, last));
+	while (last != first) {
+		--last;
+		actions.emplace_back(*last);
 	}
-	return stroke;
+	return actions;
 }
 
 void Funscript::SetActions(const FunscriptArray& override_with) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	//data.Actions.clear();
-	//data.Actions.assign(override_with.begin(), override_with.end());
-	//sortActions(data.Actions);
-	data.Actions = override_with;
+	preserveSelection([&]() {
+		data.Actions = override_with;
+	});
 	notifyActionsChanged(true);
 }
 
-void Funscript::RemoveActionsInInterval(float fromTime, float toTime) noexcept
+void Funscript::RemoveActionsInInterval(FunscriptTime fromTime, FunscriptTime toTime) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	data.Actions.erase(
-		std::remove_if(data.Actions.begin(), data.Actions.end(),
-			[fromTime, toTime](auto action) {
-				return action.atS >= fromTime && action.atS <= toTime;
-			}), data.Actions.end()
-	);
-	checkForInvalidatedActions();
-	notifyActionsChanged(true);
+	auto startIt = data.Actions.lower_bound(FunscriptAction(fromTime, 0));
+	auto endIt = data.Actions.upper_bound(FunscriptAction(toTime, 0));
+	uint32_t startIdx = std::distance(data.Actions.begin(), startIt);
+	uint32_t removed = std::distance(startIt, endIt);
+	if (data.Selection.CountRange(startIdx, startIdx + removed) > 0) notifySelectionChanged();
+	data.Actions.erase(startIt, endIt);
+	data.Selection.Erase(startIdx, removed);
+	notifyActionsChanged(true, fromTime, toTime, 0, removed);
+}
+
+void Funscript::ReplaceActionsInInterval(FunscriptTime fromTime, FunscriptTime toTime, const FunscriptArray& actions) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	auto sizeBefore = data.Actions.size();
+	size_t removed = 0;
+	preserveSelection([&]() {
+		removed = data.Actions.replace_interval(FunscriptAction(fromTime, 0), FunscriptAction(toTime, 0), actions.begin(), actions.end());
+	});
+	auto inserted = data.Actions.size() + removed - sizeBefore;
+	FunscriptTime changeFrom = fromTime;
+	FunscriptTime changeTo = toTime;
+	if (!actions.empty()) {
+		changeFrom = std::min(changeFrom, actions.front().atS);
+		changeTo = std::max(changeTo, actions.back().atS);
+	}
+	notifyActionsChanged(true, changeFrom, changeTo, inserted, removed);
 }
 
 void Funscript::RangeExtendSelection(int32_t rangeExtend) noexcept
@@ -337,106 +501,93 @@ void Funscript::RangeExtendSelection(int32_t rangeExtend) noexcept
 	};
 	std::vector<FunscriptAction*> rangeExtendSelection;
 	rangeExtendSelection.reserve(SelectionSize());
-	int selectionOffset = 0;
-	for (auto&& act : data.Actions) {
-		for (int i = selectionOffset; i < data.Selection.size(); i++) {
-			if (data.Selection[i] == act) {
-				rangeExtendSelection.push_back(&act);
-				selectionOffset = i;
-				break;
-			}
-		}
-	}
+	data.Selection.ForEachAction(data.Actions, [&](FunscriptAction& action) {
+		rangeExtendSelection.push_back(&action);
+	});
 	if (rangeExtendSelection.size() == 0) { return; }
 	ClearSelection();
 	ExtendRange(rangeExtendSelection, rangeExtend);
+	notifyActionsChanged(true, rangeExtendSelection.front()->atS, rangeExtendSelection.back()->atS, 0, 0);
 }
 
 bool Funscript::ToggleSelection(FunscriptAction action) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	auto it = data.Selection.find(action);
-	bool isSelected = it != data.Selection.end();
-	if (isSelected) {
-		data.Selection.erase(it);
-	}
-	else {
-		data.Selection.emplace(action);
-	}
+	auto idx = actionIndex(action);
+	if (idx == FunscriptSelection::None) return false;
+	bool selected = data.Selection.Toggle(idx);
 	notifySelectionChanged();
-	return !isSelected;
+	return selected;
 }
 
 void Funscript::SetSelected(FunscriptAction action, bool selected) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	auto it = data.Selection.find(action); 
-	bool isSelected = it != data.Selection.end();
-	if(isSelected && !selected) {
-		data.Selection.erase(it);
-	}
-	else if(!isSelected && selected) {
-		data.Selection.emplace(action);
-	}
+	auto idx = actionIndex(action);
+	if (idx == FunscriptSelection::None) return;
+	data.Selection.Set(idx, selected);
 	notifySelectionChanged();
 }
 
 void Funscript::SelectTopActions() noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	if (data.Selection.size() < 3) return;
-	std::vector<FunscriptAction> deselect;
-	for (int i = 1; i < data.Selection.size() - 1; i++) {
-		auto& prev = data.Selection[i - 1];
-		auto& current = data.Selection[i];
-		auto& next = data.Selection[i + 1];
-
-		auto& min1 = prev.pos < current.pos ? prev : current;
-		auto& min2 = min1.pos < next.pos ? min1 : next;
+	if (data.Selection.Count() < 3) return;
+	auto& actions = data.Actions;
+	OFS_FrameVector<uint32_t> deselect;
+	uint32_t prevIdx = data.Selection.First();
+	uint32_t currentIdx = data.Selection.FindNext(prevIdx + 1);
+	uint32_t nextIdx = data.Selection.FindNext(currentIdx + 1);
+	while (nextIdx != FunscriptSelection::None) {
+		uint32_t min1 = actions[prevIdx].pos < actions[currentIdx].pos ? prevIdx : currentIdx;
+		uint32_t min2 = actions[min1].pos < actions[nextIdx].pos ? min1 : nextIdx;
 		deselect.emplace_back(min1);
-		if (min1.atS != min2.atS) deselect.emplace_back(min2);
+		if (min1 != min2) deselect.emplace_back(min2);
+
+		prevIdx = currentIdx;
+		currentIdx = nextIdx;
+		nextIdx = data.Selection.FindNext(nextIdx + 1);
 	}
-	for (auto& act : deselect) SetSelected(act, false);
+	for (auto idx : deselect) data.Selection.Set(idx, false);
 	notifySelectionChanged();
 }
 
 void Funscript::SelectBottomActions() noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	if (data.Selection.size() < 3) return;
-	std::vector<FunscriptAction> deselect;
-	for (int i = 1; i < data.Selection.size() - 1; i++) {
-		auto& prev = data.Selection[i - 1];
-		auto& current = data.Selection[i];
-		auto& next = data.Selection[i + 1];
-
-		auto& max1 = prev.pos > current.pos ? prev : current;
-		auto& max2 = max1.pos > next.pos ? max1 : next;
+	if (data.Selection.Count() < 3) return;
+	auto& actions = data.Actions;
+	OFS_FrameVector<uint32_t> deselect;
+	uint32_t prevIdx = data.Selection.First();
+	uint32_t currentIdx = data.Selection.FindNext(prevIdx + 1);
+	uint32_t nextIdx = data.Selection.FindNext(currentIdx + 1);
+	while (nextIdx != FunscriptSelection::None) {
+		uint32_t max1 = actions[prevIdx].pos > actions[currentIdx].pos ? prevIdx : currentIdx;
+		uint32_t max2 = actions[max1].pos > actions[nextIdx].pos ? max1 : nextIdx;
 		deselect.emplace_back(max1);
-		if (max1.atS != max2.atS) deselect.emplace_back(max2);
+		if (max1 != max2) deselect.emplace_back(max2);
+
+		prevIdx = currentIdx;
+		currentIdx = nextIdx;
+		nextIdx = data.Selection.FindNext(nextIdx + 1);
 	}
-	for (auto& act : deselect) SetSelected(act, false);
+	for (auto idx : deselect) data.Selection.Set(idx, false);
 	notifySelectionChanged();
 }
 
 void Funscript::SelectMidActions() noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	if (data.Selection.size() < 3) return;
+	if (data.Selection.Count() < 3) return;
 	auto selectionCopy = data.Selection;
 	SelectTopActions();
 	auto topPoints = data.Selection;
 	data.Selection = selectionCopy;
 	SelectBottomActions();
-	auto bottomPoints = data.Selection;
-	
-	selectionCopy.erase(std::remove_if(selectionCopy.begin(), selectionCopy.end(),
-		[&topPoints, &bottomPoints](auto val) {
-			return std::any_of(topPoints.begin(), topPoints.end(), [val](auto a) { return a == val; })
-				|| std::any_of(bottomPoints.begin(), bottomPoints.end(), [val](auto a) { return a == val; });
-		}), selectionCopy.end());
-	data.Selection = selectionCopy;
-	sortSelection();
+
+	selectionCopy.Subtract(topPoints);
+	selectionCopy.Subtract(data.Selection);
+	data.Selection = std::move(selectionCopy);
 	notifySelectionChanged();
 }
 
@@ -446,25 +597,27 @@ void Funscript::SelectTime(float fromTime, float toTime, bool clear) noexcept
 	if(clear)
 		ClearSelection();
 
-	for (auto& action : data.Actions) {
-		if (action.atS >= fromTime && action.atS <= toTime) {
-			ToggleSelection(action);
-		}
-		else if (action.atS > toTime)
-			break;
+	auto startIt = data.Actions.lower_bound(FunscriptAction(fromTime, 0));
+	auto endIt = data.Actions.upper_bound(FunscriptAction(toTime, 0));
+	uint32_t startIdx = std::distance(data.Actions.begin(), startIt);
+	uint32_t endIdx = std::distance(data.Actions.begin(), endIt);
+	if (startIdx < endIdx) {
+		if (clear)
+			data.Selection.SetRange(startIdx, endIdx, true);
+		else
+			data.Selection.ToggleRange(startIdx, endIdx);
 	}
-
-	if (!clear)
-		sortSelection();
 	notifySelectionChanged();
 }
 
 FunscriptArray Funscript::GetSelection(float fromTime, float toTime) noexcept
 {
+	OFS_PROFILE(__FUNCTION__);
 	FunscriptArray selection;
 	if (!data.Actions.empty()) {
 		auto start = data.Actions.lower_bound(FunscriptAction(fromTime, 0));
 		auto end = data.Actions.upper_bound(FunscriptAction(toTime, 0));
+		selection.reserve(std::distance(start, end));
 		for (; start != end; ++start) {
 			auto action = *start;
 			if (action.atS >= fromTime && action.atS <= toTime) {
@@ -475,50 +628,72 @@ FunscriptArray Funscript::GetSelection(float fromTime, float toTime) noexcept
 	return selection;
 }
 
+FunscriptArray Funscript::GetSelectedActions() const noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	FunscriptArray selected;
+	selected.reserve(data.Selection.Count());
+	data.Selection.ForEachAction(data.Actions, [&](const FunscriptAction& action) {
+		selected.emplace_back_unsorted(action);
+	});
+	return selected;
+}
+
+FunscriptFrameArray Funscript::copySelectedActions() const noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	FunscriptFrameArray selected;
+	selected.reserve(data.Selection.Count());
+	data.Selection.ForEachAction(data.Actions, [&](const FunscriptAction& action) {
+		selected.emplace_back_unsorted(action);
+	});
+	return selected;
+}
+
+const FunscriptAction* Funscript::GetClosestActionSelection(float time) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	if (!HasSelection()) return nullptr;
+	auto it = data.Actions.lower_bound(FunscriptAction(time, 0));
+	uint32_t idx = std::distance(data.Actions.begin(), it);
+	uint32_t nextIdx = data.Selection.FindNext(idx);
+	uint32_t prevIdx = data.Selection.FindPrev(idx);
+	if (nextIdx == FunscriptSelection::None) return &data.Actions[prevIdx];
+	if (prevIdx == FunscriptSelection::None) return &data.Actions[nextIdx];
+
+	auto& next = data.Actions[nextIdx];
+	auto& prev = data.Actions[prevIdx];
+	return std::abs(next.atS - time) <= std::abs(time - prev.atS) ? &next : &prev;
+}
+
 void Funscript::SelectAction(FunscriptAction select) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	auto action = GetAction(select);
-	if (action != nullptr) {
-		if (ToggleSelection(select)) {
-			// keep selection ordered for rendering purposes
-			sortSelection();
-		}
-		notifySelectionChanged();
-	}
+	ToggleSelection(select);
 }
 
 void Funscript::DeselectAction(FunscriptAction deselect) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	auto action = GetAction(deselect);
-	if (action != nullptr)
-		SetSelected(*action, false);
-	notifySelectionChanged();
+	SetSelected(deselect, false);
 }
 
 void Funscript::SelectAll() noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	ClearSelection();
-	data.Selection.assign(data.Actions.begin(), data.Actions.end());
+	data.Selection.Resize(data.Actions.size());
+	data.Selection.SelectAll();
 	notifySelectionChanged();
 }
 
 void Funscript::RemoveSelectedActions() noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	if (data.Selection.size() == data.Actions.size()) {
-		// assume data.selection == data.Actions
-		// aslong as we don't fuck up the selection this is safe 
-		data.Actions.clear();
-	}
-	else {
-		RemoveActions(data.Selection);
-	}
-
-	ClearSelection();
-	notifyActionsChanged(true);
+	if (!HasSelection()) return;
+	FunscriptTime changeFrom = SelectionFront()->atS;
+	FunscriptTime changeTo = SelectionBack()->atS;
+	auto removed = eraseSelectedActions();
+	notifyActionsChanged(true, changeFrom, changeTo, 0, removed);
 	notifySelectionChanged();
 }
 
@@ -532,15 +707,41 @@ void Funscript::moveAllActionsTime(float timeOffset)
 	notifyActionsChanged(true);
 }
 
-void Funscript::moveActionsPosition(std::vector<FunscriptAction*> moving, int32_t posOffset)
+void Funscript::transformAllPositions(float scale, float offset) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	ClearSelection();
-	for (auto move : moving) {
-		move->pos += posOffset;
-		move->pos = Util::Clamp<int16_t>(move->pos, 0, 100);
+	if (data.Actions.empty()) return;
+	Columns();
+	columns.TransformPositions(columns.All(), scale, offset);
+	// positions don't affect the order so they are copied back in place
+	auto positions = columns.Positions();
+	for (auto& action : data.Actions) {
+		action.pos = (int16_t)*positions++;
 	}
-	notifyActionsChanged(true);
+	notifyActionsChanged(true, data.Actions.front().atS, data.Actions.back().atS, 0, 0);
+	// the columns already contain the new positions
+	columns.MarkSynced(editVersion);
+}
+
+const FunscriptColumns& Funscript::Columns() noexcept
+{
+	if (!columns.IsSynced(editVersion)) {
+		columns.Rebuild(data.Actions, editVersion);
+	}
+	return columns;
+}
+
+const FunscriptStrokeIndex& Funscript::Strokes() noexcept
+{
+	strokes.Sync(data.Actions, editVersion);
+	return strokes;
+}
+
+const FunscriptStatistics& Funscript::Statistics(const FunscriptStatistics::Settings& settings) noexcept
+{
+	statistics.SetSettings(settings);
+	statistics.Sync(Columns(), editVersion);
+	return statistics;
 }
 
 void Funscript::MoveSelectionTime(float timeOffset, float frameTime) noexcept
@@ -549,14 +750,16 @@ void Funscript::MoveSelectionTime(float timeOffset, float frameTime) noexcept
 	if (!HasSelection()) return;
 
 	// faster path when everything is selected
-	if (data.Selection.size() == data.Actions.size()) {
+	if (data.Selection.Count() == data.Actions.size()) {
 		moveAllActionsTime(timeOffset);
 		SelectAll();
 		return;
 	}
 
-	auto prev = GetPreviousActionBehind(data.Selection.front().atS);
-	auto next = GetNextActionAhead(data.Selection.back().atS);
+	auto front = *SelectionFront();
+	auto back = *SelectionBack();
+	auto prev = GetPreviousActionBehind(front.atS);
+	auto next = GetNextActionAhead(back.atS);
 
 	auto min_bound = 0.f;
 	auto max_bound = std::numeric_limits<float>::max();
@@ -564,116 +767,100 @@ void Funscript::MoveSelectionTime(float timeOffset, float frameTime) noexcept
 	if (timeOffset > 0) {
 		if (next != nullptr) {
 			max_bound = next->atS - frameTime;
-			timeOffset = std::min(timeOffset, max_bound - data.Selection.back().atS);
+			timeOffset = std::min(timeOffset, max_bound - back.atS);
 		}
 	}
 	else {
 		if (prev != nullptr) {
 			min_bound = prev->atS + frameTime;
-			timeOffset = std::max(timeOffset, min_bound - data.Selection.front().atS);
+			timeOffset = std::max(timeOffset, min_bound - front.atS);
 		}
 	}
 
-	FunscriptArray newSelection;
-	newSelection.reserve(data.Selection.size());
-	for (auto selected : data.Selection) {
-		auto move = getAction(selected);
-		if (move) {
-			FunscriptAction newAction = *move;
-			newAction.atS += timeOffset;
-			newSelection.emplace(newAction);
-			RemoveAction(*move, false);
-			AddAction(newAction);
-		}
+	// the order doesn't change by moving everything by the same offset
+	auto moved = copySelectedActions();
+	for (auto& action : moved) {
+		action.atS += timeOffset;
 	}
-	ClearSelection();
-	data.Selection = std::move(newSelection);
-	notifyActionsChanged(true);
+	FunscriptTime changeFrom = std::min(front.atS, moved.front().atS);
+	FunscriptTime changeTo = std::max(back.atS, moved.back().atS);
+
+	auto removed = eraseSelectedActions();
+	auto inserted = data.Actions.merge(moved.begin(), moved.end());
+	restoreSelection(moved);
+	notifyActionsChanged(true, changeFrom, changeTo, inserted, removed);
 }
 
 void Funscript::MoveSelectionPosition(int32_t pos_offset) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
 	if (!HasSelection()) return;
-	std::vector<FunscriptAction*> moving;
-	
+
 	// faster path when everything is selected
-	if (data.Selection.size() == data.Actions.size()) {
-		for (auto& action : data.Actions)
-			moving.push_back(&action);
-		moveActionsPosition(moving, pos_offset);
-		SelectAll();
+	if (data.Selection.Count() == data.Actions.size()) {
+		transformAllPositions(1.f, (float)pos_offset);
 		return;
 	}
 
-	for (auto& find : data.Selection) {
-		auto m = getAction(find);
-		if (m != nullptr)
-			moving.push_back(m);
-	}
-
-	ClearSelection();
-	for (auto move : moving) {
-		move->pos += pos_offset;
-		move->pos = Util::Clamp<int16_t>(move->pos, 0, 100);
-		data.Selection.emplace_back_unsorted(*move);
-	}
-	sortSelection();
-	notifyActionsChanged(true);
+	// positions don't affect the order so the selection stays valid
+	data.Selection.ForEachAction(data.Actions, [&](FunscriptAction& move) {
+		move.pos += pos_offset;
+		move.pos = Util::Clamp<int16_t>(move.pos, 0, 100);
+	});
+	notifyActionsChanged(true, SelectionFront()->atS, SelectionBack()->atS, 0, 0);
 }
 
 void Funscript::SetSelection(const FunscriptArray& actionsToSelect) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	ClearSelection();
-	for(auto& action : actionsToSelect) {
-		data.Selection.emplace(action);
-	}
+	restoreSelection(actionsToSelect);
 	notifySelectionChanged();
 }
 
-bool Funscript::IsSelected(FunscriptAction action) noexcept
+bool Funscript::IsSelected(FunscriptAction action) const noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	auto it = data.Selection.find(action);
-	return it != data.Selection.end();
+	return data.Selection.Test(actionIndex(action));
 }
 
 void Funscript::EqualizeSelection() noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	if (data.Selection.size() < 3) return;
-	sortSelection(); // might be unnecessary
-	auto first = data.Selection.front();
-	auto last = data.Selection.back();
+	if (data.Selection.Count() < 3) return;
+	auto copySelection = copySelectedActions();
+	auto first = copySelection.front();
+	auto last = copySelection.back();
 	float duration = last.atS - first.atS;
-	float stepTime = duration / (float)(data.Selection.size()-1);
-		
-	auto copySelection = data.Selection;
-	RemoveSelectedActions(); // clears selection
+	float stepTime = duration / (float)(copySelection.size()-1);
+
+	auto removed = eraseSelectedActions();
 
 	for (int i = 1; i < copySelection.size()-1; i++) {
 		auto& newAction = copySelection[i];
 		newAction.atS = first.atS + i * stepTime;
 	}
 
-	for (auto& action : copySelection)
-		AddAction(action);
-
-	data.Selection = std::move(copySelection);
+	auto inserted = data.Actions.merge(copySelection.begin(), copySelection.end());
+	restoreSelection(copySelection);
+	notifyActionsChanged(true, first.atS, last.atS, inserted, removed);
 }
 
 void Funscript::InvertSelection() noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	if (data.Selection.empty()) return;
-	auto copySelection = data.Selection;
-	RemoveSelectedActions();
-	for (auto& act : copySelection)	{
-		act.pos = std::abs(act.pos - 100);
-		AddAction(act);
+	if (!HasSelection()) return;
+
+	// faster path when everything is selected
+	if (data.Selection.Count() == data.Actions.size()) {
+		transformAllPositions(-1.f, 100.f);
+		return;
 	}
-	data.Selection = copySelection;
+
+	// positions don't affect the order so the selection stays valid
+	data.Selection.ForEachAction(data.Actions, [&](FunscriptAction& act) {
+		act.pos = std::abs(act.pos - 100);
+	});
+	notifyActionsChanged(true, SelectionFront()->atS, SelectionBack()->atS, 0, 0);
 }
 
 void Funscript::UpdateRelativePath(const std::string& path) noexcept
@@ -704,12 +891,14 @@ bool Funscript::Deserialize(const nlohmann::json& json, Funscript::Metadata* out
 
 	for (auto& action : jsonActions) 
 	{
-		float time = action["at"].get<double>() / 1000.0;
+		double ms = action["at"].get<double>();
 		int32_t pos = action["pos"];
-		if (time >= 0.f) {
-			data.Actions.emplace(time, Util::Clamp(pos, 0, 100));
+		if (ms >= 0.0) {
+			data.Actions.emplace(FunscriptAction::TimeFromMilliseconds(ms), Util::Clamp(pos, 0, 100));
 		}
 	}
+	data.Selection.Clear();
+	data.Selection.Resize(data.Actions.size());
 
 	if(outMetadata)
 	{
@@ -725,106 +914,102 @@ bool Funscript::Deserialize(const nlohmann::json& json, Funscript::Metadata* out
 
 	if(loadChapters && json.contains("metadata"))
 	{
-		auto& chapterState = ChapterState::StaticStateSlow();
-		auto& jsonMetadata = json["metadata"];
-
-		if(jsonMetadata.contains("bookmarks"))
-		{
-			auto& jsonBookmarks = jsonMetadata["bookmarks"];
-			if(jsonBookmarks.is_array())
-			{
-				for(auto& jsonBookmark : jsonBookmarks)
-				{
-					if(!jsonBookmark.contains("name") || !jsonBookmark.contains("time"))
-						continue;
-					if(!jsonBookmark["name"].is_string() || !jsonBookmark["time"].is_string())
-						continue;
+		loadChapterState(json["metadata"]);
+	}
 
-					auto name = std::move(jsonBookmark["name"].get<std::string>());
-					auto timeStr = std::move(jsonBookmark["time"].get<std::string>());
+	notifyActionsChanged(false);
+	return true;
+}
 
-					bool succ = false;
-					float time = Util::ParseTime(timeStr.c_str(), &succ);
-					if(!succ) 
-					{
-						LOGF_ERROR("Failed to parse \"%s\" to time", timeStr.c_str());
-						continue;
-					}
+bool Funscript::parseActions(const std::string& jsonText, nlohmann::json& outJsonMetadata, bool* hasMetadata) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	data.Actions.clear();
+	// an action takes roughly 25 bytes of json
+	data.Actions.reserve(jsonText.size() / 25);
 
-					if(auto bookmark = chapterState.AddBookmark(time)) 
-					{
-						bookmark->name = std::move(name);
-					}
-				}
-			}
-		}
+	FunscriptSaxReader reader(data.Actions);
+	if (!reader.Parse(jsonText.data(), jsonText.size())) {
+		data.Actions.clear();
+		return false;
+	}
 
-		if(jsonMetadata.contains("chapters"))
-		{
-			auto& jsonChapters = jsonMetadata["chapters"];
-			if(jsonChapters.is_array())
-			{
-				for(auto& jsonChapter : jsonChapters)
-				{
-					if(!jsonChapter.contains("name") || !jsonChapter.contains("startTime") || !jsonChapter.contains("endTime"))
-						continue;
-					if(!jsonChapter["name"].is_string() || !jsonChapter["startTime"].is_string() || !jsonChapter["endTime"].is_string())
-						continue;
-					
-					auto name = std::move(jsonChapter["name"].get<std::string>());
-					auto startTimeStr = std::move(jsonChapter["startTime"].get<std::string>());
-					auto endTimeStr = std::move(jsonChapter["endTime"].get<std::string>());
-
-					bool succ = false;
-					float startTime = Util::ParseTime(startTimeStr.c_str(), &succ);
-					if(!succ) 
-					{
-						LOGF_ERROR("Failed to parse \"%s\" to time", startTimeStr.c_str());
-						continue;
-					}
-					float endTime = Util::ParseTime(endTimeStr.c_str(), &succ);
-					if(!succ)
-					{
-						LOGF_ERROR("Failed to parse \"%s\" to time", endTimeStr.c_str());
-						continue;
-					}
+	if (!reader.Sorted) {
+		// same result as emplacing one by one, the first action at a given time wins
+		std::vector<FunscriptAction> sorted(data.Actions.begin(), data.Actions.end());
+		std::stable_sort(sorted.begin(), sorted.end(), ActionLess());
+		sorted.erase(std::unique(sorted.begin(), sorted.end(),
+			[](auto a, auto b) noexcept { return !ActionLess()(a, b) && !ActionLess()(b, a); }), sorted.end());
+		data.Actions.clear();
+		for (auto action : sorted) data.Actions.emplace_back_unsorted(action);
+	}
+	*hasMetadata = reader.HasMetadata;
+	outJsonMetadata = std::move(reader.Metadata);
+	return true;
+}
 
-					if(startTime > endTime)
-						continue;
+void Funscript::finishDeserialize(const nlohmann::json* jsonMetadata, Funscript::Metadata* outMetadata, bool loadChapters) noexcept
+{
+	data.Selection.Clear();
+	data.Selection.Resize(data.Actions.size());
 
-					// Insert chapter at the middle point				
-					float middlePoint = startTime + ((endTime - startTime)/2.f);
-					if(auto chapter = chapterState.AddChapter(middlePoint, 1.f))
-					{
-						chapter->name = std::move(name);
-						// Set size is used to safely resize the chapter to the correct size
-						chapterState.SetChapterSize(*chapter, startTime);
-						chapterState.SetChapterSize(*chapter, endTime);
-					}
-				}
-			}
+	if (outMetadata) {
+		if (jsonMetadata) {
+			loadMetadata(*jsonMetadata, *outMetadata);
 		}
+		else {
+			*outMetadata = Funscript::Metadata();
+		}
+	}
+
+	if (loadChapters && jsonMetadata) {
+		loadChapterState(*jsonMetadata);
 	}
 
 	notifyActionsChanged(false);
+}
+
+bool Funscript::DeserializeText(const std::string& jsonText, Funscript::Metadata* outMetadata, bool loadChapters) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	nlohmann::json jsonMetadata;
+	bool hasMetadata = false;
+	if (!parseActions(jsonText, jsonMetadata, &hasMetadata)) {
+		finishDeserialize(nullptr, nullptr, false);
+		return false;
+	}
+	finishDeserialize(hasMetadata ? &jsonMetadata : nullptr, outMetadata, loadChapters);
 	return true;
 }
 
-void Funscript::Serialize(nlohmann::json& json, const FunscriptData& funscriptData, const Funscript::Metadata& metadata, bool includeChapters) noexcept
+bool Funscript::DeserializeFile(const std::string& path, Funscript::Metadata* outMetadata, bool loadChapters) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	json = nlohmann::json::object();
-	json["actions"] = nlohmann::json::array();
-	json["metadata"] = nlohmann::json::object();
-	json["version"] = "1.0";
-	json["inverted"] = false;
-	json["range"] = 100;
+	nlohmann::json jsonMetadata;
+	bool hasMetadata = false;
+	if (FunscriptCache::Load(path, data.Actions, jsonMetadata, &hasMetadata)) {
+		finishDeserialize(hasMetadata ? &jsonMetadata : nullptr, outMetadata, loadChapters);
+		return true;
+	}
+
+	auto jsonText = Util::ReadFileString(path.c_str());
+	if (jsonText.empty() || !parseActions(jsonText, jsonMetadata, &hasMetadata)) {
+		finishDeserialize(nullptr, nullptr, false);
+		return false;
+	}
+	FunscriptCache::Store(path, jsonText, data.Actions, hasMetadata ? &jsonMetadata : nullptr);
+	finishDeserialize(hasMetadata ? &jsonMetadata : nullptr, outMetadata, loadChapters);
+	return true;
+}
 
-	auto& jsonMetadata = json["metadata"];
+void Funscript::serializeMetadata(nlohmann::json& jsonMetadata, const Funscript::Metadata& metadata, const ChapterState* chapterState) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	jsonMetadata = nlohmann::json::object();
 	OFS::Serializer<false>::Serialize(metadata, jsonMetadata);
-	if(includeChapters)
+	if(chapterState)
 	{
-		auto& chapters = ChapterState::StaticStateSlow();
+		auto& chapters = *chapterState;
 		{
 			auto jsonBookmarks = nlohmann::json::array();
 			for(auto& bookmark : chapters.bookmarks)
@@ -853,17 +1038,42 @@ void Funscript::Serialize(nlohmann::json& json, const FunscriptData& funscriptDa
 			jsonMetadata["chapters"] = std::move(jsonChapters);
 		}
 	}
+}
+
+nlohmann::json Funscript::Serialize(const Funscript::Metadata& metadata, bool includeChapters) const noexcept
+{
+	nlohmann::json json;
+	serialize(json, data.Actions, metadata, includeChapters ? &ChapterState::StaticStateSlow() : nullptr);
+	return json;
+}
+
+void Funscript::Serialize(nlohmann::json& json, const FunscriptSnapshot& snapshot, const Funscript::Metadata& metadata, bool includeChapters) noexcept
+{
+	serialize(json, snapshot.Actions, metadata, includeChapters ? snapshot.Chapters.get() : nullptr);
+}
+
+void Funscript::serialize(nlohmann::json& json, const FunscriptArray& actions, const Funscript::Metadata& metadata, const ChapterState* chapters) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	json = nlohmann::json::object();
+	json["actions"] = nlohmann::json::array();
+	json["metadata"] = nlohmann::json::object();
+	json["version"] = "1.0";
+	json["inverted"] = false;
+	json["range"] = 100;
+
+	serializeMetadata(json["metadata"], metadata, chapters);
 
 	auto& jsonActions = json["actions"];
 	jsonActions.clear();
 
 	int64_t lastTimestamp = -1;
-	for (auto action : funscriptData.Actions) {
+	for (auto action : actions) {
 		// a little validation just in case
 		if (action.atS < 0.f)
 			continue;
 			
-		int64_t ts = (int64_t)std::round(action.atS*1000.0);
+		int64_t ts = FunscriptAction::TimeToMilliseconds(action.atS);
 		// make sure timestamps are unique
 		if(ts != lastTimestamp) { 
 			nlohmann::json actionObj = {
@@ -878,4 +1088,35 @@ void Funscript::Serialize(nlohmann::json& json, const FunscriptData& funscriptDa
 			LOG_WARN("Action was ignored since it had the same millisecond timestamp as the previous one.");
 		}
 	}
-}
\ No newline at end of file
+}
+
+void Funscript::SerializeText(FunscriptWriter& writer, const Funscript::Metadata& metadata, bool includeChapters) const noexcept
+{
+	serializeText(writer, data.Actions, metadata, includeChapters ? &ChapterState::StaticStateSlow() : nullptr);
+}
+
+void Funscript::SerializeText(FunscriptWriter& writer, const FunscriptSnapshot& snapshot, const Funscript::Metadata& metadata, bool includeChapters) noexcept
+{
+	serializeText(writer, snapshot.Actions, metadata, includeChapters ? snapshot.Chapters.get() : nullptr);
+}
+
+void Funscript::serializeText(FunscriptWriter& writer, const FunscriptArray& actions, const Funscript::Metadata& metadata, const ChapterState* chapters) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	nlohmann::json jsonMetadata;
+	serializeMetadata(jsonMetadata, metadata, chapters);
+	writer.WriteFunscript(actions, jsonMetadata);
+}
+
+std::shared_ptr<const FunscriptSnapshot> Funscript::PublishSnapshot(const std::shared_ptr<const ChapterState>& chapters) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	if (snapshot && snapshot->Version == editVersion && snapshot->Chapters == chapters) return snapshot;
+	auto newSnapshot = std::make_shared<FunscriptSnapshot>();
+	newSnapshot->Version = editVersion;
+	newSnapshot->Chapters = chapters;
+	newSnapshot->Actions = data.Actions;
+	std::shared_ptr<const FunscriptSnapshot> published(std::move(newSnapshot));
+	std::atomic_store(&snapshot, published);
+	return published;
+}
@@ -2,6 +2,11 @@
 
 #include "nlohmann/json.hpp"
 #include "FunscriptAction.h"
+#include "FunscriptSelection.h"
+#include "FunscriptColumns.h"
+#include "FunscriptStrokes.h"
+#include "FunscriptStatistics.h"
+#include "FunscriptSnapshot.h"
 #include "OFS_Reflection.h"
 #include "OFS_Serialization.h"
 #include "OFS_BinarySerialization.h"
@@ -9,6 +14,8 @@
 #include <string>
 #include <memory>
 #include <chrono>
+#include <limits>
+#include <algorithm>
 
 #include "OFS_Util.h"
 #include "FunscriptSpline.h"
@@ -18,15 +25,54 @@
 #include "OFS_Event.h"
 
 class FunscriptUndoSystem;
+class FunscriptWriter;
+struct ChapterState;
 class Funscript;
 
+// Accumulates every action edit which happened between two FunscriptActionsChangedEvents.
+// Consumers can use the dirty interval to only recompute the affected part of a script.
+struct FunscriptChange
+{
+	uint64_t Version = 0;
+	// exact timestamps, in fixed timebase builds the bounds are ticks like the actions
+	FunscriptTime FromTime = std::numeric_limits<FunscriptTime>::max();
+	FunscriptTime ToTime = std::numeric_limits<FunscriptTime>::lowest();
+	uint32_t Inserted = 0;
+	uint32_t Removed = 0;
+	// the whole script has to be considered dirty
+	bool Full = false;
+	// at least one of the changes was a user edit
+	bool Edit = false;
+
+	inline bool HasRange() const noexcept { return FromTime <= ToTime; }
+	inline bool IsFull() const noexcept { return Full || !HasRange(); }
+
+	inline void Extend(FunscriptTime fromTime, FunscriptTime toTime) noexcept
+	{
+		if (fromTime > toTime) std::swap(fromTime, toTime);
+		FromTime = std::min(FromTime, fromTime);
+		ToTime = std::max(ToTime, toTime);
+	}
+
+	inline void Merge(const FunscriptChange& other) noexcept
+	{
+		Version = std::max(Version, other.Version);
+		Full = Full || other.IsFull();
+		Edit = Edit || other.Edit;
+		if (other.HasRange()) Extend(other.FromTime, other.ToTime);
+		Inserted += other.Inserted;
+		Removed += other.Removed;
+	}
+};
+
 class FunscriptActionsChangedEvent : public OFS_Event<FunscriptActionsChangedEvent>
 {
 	public:
 	// FIXME: get rid of this raw pointer
 	const Funscript* Script = nullptr;
-	FunscriptActionsChangedEvent(const Funscript* changedScript) noexcept
-		: Script(changedScript) {}
+	FunscriptChange Change;
+	FunscriptActionsChangedEvent(const Funscript* changedScript, const FunscriptChange& change) noexcept
+		: Script(changedScript), Change(change) {}
 };
 
 class FunscriptSelectionChangedEvent : public OFS_Event<FunscriptSelectionChangedEvent>
@@ -63,7 +109,7 @@ public:
 	
 	struct FunscriptData {
 		FunscriptArray Actions;
-		FunscriptArray Selection;
+		FunscriptSelection Selection;
 	};
 
 	struct Metadata {
@@ -86,6 +132,7 @@ public:
 		s.ext(*this, bitsery::ext::Growable{},
 			[](S& s, Funscript& o) {
 				s.container(o.data.Actions, std::numeric_limits<uint32_t>::max());
+				o.data.Selection.Resize(o.data.Actions.size());
 				s.text1b(o.currentPathRelative, o.currentPathRelative.max_size());
 				s.text1b(o.title, o.title.max_size());
 				s.boolValue(o.Enabled);
@@ -97,12 +144,46 @@ private:
 	//nlohmann::json JsonOther;
 
 	std::chrono::system_clock::time_point editTime;
+	uint64_t editVersion = 0; // incremented on every change to the actions
+	FunscriptChange pendingChange; // everything which changed since the last event
 	bool funscriptChanged = false; // used to fire only one event every frame a change occurs
 	bool unsavedEdits = false; // used to track if the script has unsaved changes
 	bool selectionChanged = false;
 	FunscriptData data;
+	FunscriptColumns columns; // lazily synced with data.Actions through editVersion
+	FunscriptStrokeIndex strokes; // lazily updated from the dirty intervals of the edits
+	FunscriptStatistics statistics; // same as strokes
+	std::shared_ptr<const FunscriptSnapshot> snapshot; // only swapped atomically, read by other threads
 
-	void checkForInvalidatedActions() noexcept;
+	inline uint32_t actionIndex(FunscriptAction action) const noexcept
+	{
+		auto it = data.Actions.find(action);
+		return it != data.Actions.end() ? (uint32_t)std::distance(data.Actions.begin(), it) : FunscriptSelection::None;
+	}
+
+	// selects exactly the actions contained in the sorted array
+	void restoreSelection(const FunscriptArray& selected) noexcept;
+	void restoreSelection(const FunscriptFrameArray& selected) noexcept;
+	// same as GetSelectedActions but the copy lives in the frame arena
+	FunscriptFrameArray copySelectedActions() const noexcept;
+	// removes all selected actions without notifying, returns the amount removed
+	uint32_t eraseSelectedActions() noexcept;
+
+	// for bulk edits which can't track indices
+	// the selection is remembered by value and restored after the edit
+	template<typename EditFn>
+	inline void preserveSelection(EditFn&& edit) noexcept
+	{
+		if (data.Selection.Empty()) {
+			edit();
+			data.Selection.Resize(data.Actions.size());
+		}
+		else {
+			auto selected = copySelectedActions();
+			edit();
+			restoreSelection(selected);
+		}
+	}
 
 	inline FunscriptAction* getAction(FunscriptAction action) noexcept
 	{
@@ -124,15 +205,12 @@ private:
 		float smallestError = std::numeric_limits<float>::max();
 		FunscriptAction* smallestErrorAction = nullptr;
 
-		int i = 0;
 		auto it = actions.lower_bound(FunscriptAction(time - maxErrorTime, 0));
-		if (it != actions.end()) {
-			i = std::distance(actions.begin(), it);
-			if (i > 0) --i;
-		}
+		if (it == actions.end()) it = actions.begin();
+		else if (it != actions.begin()) --it;
 
-		for (; i < actions.size(); i++) {
-			auto& action = actions[i];
+		for (; it != actions.end(); ++it) {
+			auto& action = *it;
 
 			if (action.atS > (time + (maxErrorTime / 2)))
 				break;
@@ -171,16 +249,27 @@ private:
 	}
 
 	void moveAllActionsTime(float timeOffset);
-	void moveActionsPosition(std::vector<FunscriptAction*> moving, int32_t posOffset);
-	inline void sortSelection() noexcept { sortActions(data.Selection); }
-	inline void sortActions(FunscriptArray& actions) noexcept { std::sort(actions.begin(), actions.end()); }
-	inline void addAction(FunscriptArray& actions, FunscriptAction newAction) noexcept { actions.emplace(newAction); notifyActionsChanged(true); }
+	// pos = clamp(round(pos * scale + offset), 0, 100) for every action
+	void transformAllPositions(float scale, float offset) noexcept;
+	void addAction(FunscriptAction newAction) noexcept;
 	inline void notifySelectionChanged() noexcept { selectionChanged = true; }
 
 	static void loadMetadata(const nlohmann::json& metadataObj, Funscript::Metadata& outMetadata) noexcept;
 	static void saveMetadata(nlohmann::json& outMetadataObj, const Funscript::Metadata& inMetadata) noexcept;
-
-	void notifyActionsChanged(bool isEdit) noexcept; 
+	// adds the bookmarks and chapters found in the metadata object
+	static void loadChapterState(const nlohmann::json& jsonMetadata) noexcept;
+	// chapters can be null
+	static void serializeMetadata(nlohmann::json& jsonMetadata, const Funscript::Metadata& metadata, const ChapterState* chapters) noexcept;
+	static void serialize(nlohmann::json& json, const FunscriptArray& actions, const Funscript::Metadata& metadata, const ChapterState* chapters) noexcept;
+	static void serializeText(FunscriptWriter& writer, const FunscriptArray& actions, const Funscript::Metadata& metadata, const ChapterState* chapters) noexcept;
+	// parses the text into the action array, which ends up sorted and unique
+	bool parseActions(const std::string& jsonText, nlohmann::json& outJsonMetadata, bool* hasMetadata) noexcept;
+	void finishDeserialize(const nlohmann::json* jsonMetadata, Funscript::Metadata* outMetadata, bool loadChapters) noexcept;
+
+	// invalidates the whole script
+	void notifyActionsChanged(bool isEdit) noexcept;
+	// only actions between fromTime and toTime have been touched
+	void notifyActionsChanged(bool isEdit, FunscriptTime fromTime, FunscriptTime toTime, uint32_t inserted, uint32_t removed) noexcept;
 	std::string currentPathRelative;
 	std::string title;
 public:
@@ -202,17 +291,32 @@ public:
 	void Update() noexcept;
 
 	bool Deserialize(const nlohmann::json& json, Funscript::Metadata* outMetadata, bool loadChapters) noexcept;
-	inline nlohmann::json Serialize(const Funscript::Metadata& metadata, bool includeChapters) const noexcept 
-	{ 
-		nlohmann::json json;
-		Serialize(json, data, metadata, includeChapters); 
-		return json;
-	}
-	static void Serialize(nlohmann::json& json, const FunscriptData& funscriptData, const Funscript::Metadata& metadata, bool includeChapters) noexcept;
+	// streams the actions out of the text without building a json document, same result as Deserialize
+	bool DeserializeText(const std::string& jsonText, Funscript::Metadata* outMetadata, bool loadChapters) noexcept;
+	// loads through the binary cache when it's fresh, otherwise parses the file and refreshes the cache
+	bool DeserializeFile(const std::string& path, Funscript::Metadata* outMetadata, bool loadChapters) noexcept;
+	nlohmann::json Serialize(const Funscript::Metadata& metadata, bool includeChapters) const noexcept;
+	// safe to call from any thread, the chapters are the ones published with the snapshot
+	static void Serialize(nlohmann::json& json, const FunscriptSnapshot& snapshot, const Funscript::Metadata& metadata, bool includeChapters) noexcept;
+	// appends the same text as dumping Serialize, the actions are streamed into the writer's buffer
+	void SerializeText(FunscriptWriter& writer, const Funscript::Metadata& metadata, bool includeChapters) const noexcept;
+	static void SerializeText(FunscriptWriter& writer, const FunscriptSnapshot& snapshot, const Funscript::Metadata& metadata, bool includeChapters) noexcept;
+
+	// main thread only, publishes a new snapshot if the actions or the chapters changed since the last one and returns it
+	// nothing publishes per frame, the copy is only made when a consumer asks for it
+	std::shared_ptr<const FunscriptSnapshot> PublishSnapshot(const std::shared_ptr<const ChapterState>& chapters) noexcept;
+	// the last published snapshot, can be called from any thread, may be behind the actions and is null until the first publish
+	inline std::shared_ptr<const FunscriptSnapshot> Snapshot() const noexcept { return std::atomic_load(&snapshot); }
+	// everything which changed since the last Update, gets reset by it
+	inline const FunscriptChange& PendingChange() const noexcept { return pendingChange; }
 	
 	inline const FunscriptData& Data() const noexcept { return data; }
-	inline const auto& Selection() const noexcept { return data.Selection; }
+	inline const FunscriptSelection& Selection() const noexcept { return data.Selection; }
 	inline const auto& Actions() const noexcept { return data.Actions; }
+	const FunscriptStrokeIndex& Strokes() noexcept;
+	const FunscriptStatistics& Statistics(const FunscriptStatistics::Settings& settings) noexcept;
+	// structure of arrays copy of the actions for whole script passes
+	const FunscriptColumns& Columns() noexcept;
 
 	inline const FunscriptAction* GetAction(FunscriptAction action) noexcept { return getAction(action); }
 	inline const FunscriptAction* GetActionAtTime(float time, float errorTime) noexcept { return getActionAtTime(data.Actions, time, errorTime); }
@@ -221,23 +325,45 @@ public:
 	inline const FunscriptAction* GetClosestAction(float time) noexcept { return getActionAtTime(data.Actions, time, std::numeric_limits<float>::max()); }
 
 	float GetPositionAtTime(float time) const noexcept;
+
+	using Interpolation = FunscriptSpline::Interpolation;
+	// batch version of GetPositionAtTime for sorted times, walks the actions once
+	// doesn't touch any cached state so it's safe to call from worker threads
+	void GetPositionsAtTimes(const float* times, uint32_t count, float* outPositions, Interpolation mode = Interpolation::Linear) const noexcept;
+	// samples count positions every step seconds starting at startTime
+	void GetPositionsAtTimes(float startTime, float step, uint32_t count, float* outPositions, Interpolation mode = Interpolation::Linear) const noexcept;
 	
-	inline void AddAction(FunscriptAction newAction) noexcept { addAction(data.Actions, newAction); }
+	inline void AddAction(FunscriptAction newAction) noexcept { addAction(newAction); }
+	// actions need to be sorted
 	void AddMultipleActions(const FunscriptArray& actions) noexcept;
 
 	bool EditAction(FunscriptAction oldAction, FunscriptAction newAction) noexcept;
 	void AddEditAction(FunscriptAction action, float frameTime) noexcept;
-	void RemoveAction(FunscriptAction action, bool checkInvalidSelection = true) noexcept;
+	void RemoveAction(FunscriptAction action) noexcept;
 	void RemoveActions(const FunscriptArray& actions) noexcept;
 
+	// actions of the stroke before the one leading up to the action closest to time, latest first
 	std::vector<FunscriptAction> GetLastStroke(float time) noexcept;
 
 	void SetActions(const FunscriptArray& override_with) noexcept;
 
 	inline bool HasUnsavedEdits() const { return unsavedEdits; }
+	inline uint64_t Version() const noexcept { return editVersion; }
 	inline const std::chrono::system_clock::time_point& EditTime() const { return editTime; }
 
-	void RemoveActionsInInterval(float fromTime, float toTime) noexcept;
+	void RemoveActionsInInterval(FunscriptTime fromTime, FunscriptTime toTime) noexcept;
+	// removes all actions between fromTime and toTime and merges the sorted actions in their place
+	void ReplaceActionsInInterval(FunscriptTime fromTime, FunscriptTime toTime, const FunscriptArray& actions) noexcept;
+#if OFS_FIXED_TIMEBASE
+	inline void RemoveActionsInInterval(float fromTime, float toTime) noexcept
+	{
+		RemoveActionsInInterval(FunscriptTime(fromTime), FunscriptTime(toTime));
+	}
+	inline void ReplaceActionsInInterval(float fromTime, float toTime, const FunscriptArray& actions) noexcept
+	{
+		ReplaceActionsInInterval(FunscriptTime(fromTime), FunscriptTime(toTime), actions);
+	}
+#endif
 
 	// selection api
 	void RangeExtendSelection(int32_t rangeExtend) noexcept;
@@ -256,13 +382,25 @@ public:
 	void RemoveSelectedActions() noexcept;
 	void MoveSelectionTime(float time_offset, float frameTime) noexcept;
 	void MoveSelectionPosition(int32_t pos_offset) noexcept;
-	inline bool HasSelection() const noexcept { return !data.Selection.empty(); }
-	inline uint32_t SelectionSize() const noexcept { return data.Selection.size(); }
-	inline void ClearSelection() noexcept { data.Selection.clear(); }
-	inline const FunscriptAction* GetClosestActionSelection(float time) noexcept { return getActionAtTime(data.Selection, time, std::numeric_limits<float>::max()); }
+	inline bool HasSelection() const noexcept { return !data.Selection.Empty(); }
+	inline uint32_t SelectionSize() const noexcept { return data.Selection.Count(); }
+	inline void ClearSelection() noexcept { data.Selection.Clear(); }
+	inline const FunscriptAction* SelectionFront() const noexcept
+	{
+		auto idx = data.Selection.First();
+		return idx != FunscriptSelection::None ? &data.Actions[idx] : nullptr;
+	}
+	inline const FunscriptAction* SelectionBack() const noexcept
+	{
+		auto idx = data.Selection.Last();
+		return idx != FunscriptSelection::None ? &data.Actions[idx] : nullptr;
+	}
+	const FunscriptAction* GetClosestActionSelection(float time) noexcept;
+	// copies the selected actions, only use this when a copy is actually needed
+	FunscriptArray GetSelectedActions() const noexcept;
 	
 	void SetSelection(const FunscriptArray& actions) noexcept;
-	bool IsSelected(FunscriptAction action) noexcept;
+	bool IsSelected(FunscriptAction action) const noexcept;
 
 	void EqualizeSelection() noexcept;
 	void InvertSelection() noexcept;
@@ -3,16 +3,84 @@
 #include "OFS_BinarySerialization.h"
 
 #include <cstdint>
+#include <cmath>
 #include <limits>
 
 #include "OFS_VectorSet.h"
+#include "OFS_FrameArena.h"
+#if OFS_CHUNKED_ACTIONS
+#include "OFS_ChunkedVectorSet.h"
+#endif
+
+#if OFS_FIXED_TIMEBASE
+// Timestamp stored as integer ticks.
+// Converts to float seconds implicitly so existing time math keeps working,
+// ordering, equality and hashing use the exact tick value.
+struct FunscriptTime
+{
+	// 0.1ms resolution, an int32_t covers ~59 hours
+	static constexpr int32_t TicksPerSecond = 10000;
+	static constexpr int32_t TicksPerMillisecond = TicksPerSecond / 1000;
+
+	int32_t Ticks = 0;
+
+	FunscriptTime() noexcept = default;
+	explicit FunscriptTime(double seconds) noexcept : Ticks(SecondsToTicks(seconds)) {}
+
+	static inline int32_t SecondsToTicks(double seconds) noexcept
+	{
+		double ticks = std::round(seconds * TicksPerSecond);
+		if (ticks >= (double)std::numeric_limits<int32_t>::max()) return std::numeric_limits<int32_t>::max();
+		if (ticks <= (double)std::numeric_limits<int32_t>::min()) return std::numeric_limits<int32_t>::min();
+		return (int32_t)ticks;
+	}
+
+	static inline FunscriptTime FromTicks(int32_t ticks) noexcept
+	{
+		FunscriptTime time;
+		time.Ticks = ticks;
+		return time;
+	}
+
+	inline operator float() const noexcept { return (float)((double)Ticks / TicksPerSecond); }
+
+	inline FunscriptTime& operator=(double seconds) noexcept { Ticks = SecondsToTicks(seconds); return *this; }
+	inline FunscriptTime& operator+=(double seconds) noexcept { Ticks = SecondsToTicks((double)Ticks / TicksPerSecond + seconds); return *this; }
+	inline FunscriptTime& operator-=(double seconds) noexcept { return *this += -seconds; }
+
+	// the difference of two timestamps is computed from the ticks
+	friend inline float operator-(FunscriptTime a, FunscriptTime b) noexcept { return (float)((double)a.Ticks - (double)b.Ticks) / TicksPerSecond; }
+
+	friend inline bool operator==(FunscriptTime a, FunscriptTime b) noexcept { return a.Ticks == b.Ticks; }
+	friend inline bool operator!=(FunscriptTime a, FunscriptTime b) noexcept { return a.Ticks != b.Ticks; }
+	friend inline bool operator<(FunscriptTime a, FunscriptTime b) noexcept { return a.Ticks < b.Ticks; }
+	friend inline bool operator>(FunscriptTime a, FunscriptTime b) noexcept { return a.Ticks > b.Ticks; }
+	friend inline bool operator<=(FunscriptTime a, FunscriptTime b) noexcept { return a.Ticks <= b.Ticks; }
+	friend inline bool operator>=(FunscriptTime a, FunscriptTime b) noexcept { return a.Ticks >= b.Ticks; }
+};
+
+// so code using the limits of a time compiles for both timebases
+namespace std {
+template<>
+class numeric_limits<FunscriptTime>
+{
+public:
+	static constexpr bool is_specialized = true;
+	static inline FunscriptTime min() noexcept { return FunscriptTime::FromTicks(numeric_limits<int32_t>::min()); }
+	static inline FunscriptTime lowest() noexcept { return min(); }
+	static inline FunscriptTime max() noexcept { return FunscriptTime::FromTicks(numeric_limits<int32_t>::max()); }
+};
+}
+#else
+// timestamp as floating point seconds
+// instead of integer milliseconds
+using FunscriptTime = float;
+#endif
 
 struct FunscriptAction
 {
 public:
-	// timestamp as floating point seconds
-	// instead of integer milliseconds
-	float atS;
+	FunscriptTime atS;
 	int16_t pos;
 	uint8_t flags; // unused
 	uint8_t tag;
@@ -22,13 +90,44 @@ public:
 	{
 		s.ext(*this, bitsery::ext::Growable{},
 			[](S& s, FunscriptAction& o) {
+#if OFS_FIXED_TIMEBASE
+				// float seconds first so the data stays readable by float builds,
+				// the exact ticks are appended and are zero in data from float builds
+				float seconds = o.atS;
+				s.value4b(seconds);
+				s.value2b(o.pos);
+				s.value1b(o.flags);
+				s.value1b(o.tag);
+				s.value4b(o.atS.Ticks);
+				if (o.atS.Ticks == 0 && seconds != 0.f) o.atS = seconds;
+#else
 				s.value4b(o.atS);
 				s.value2b(o.pos);
 				s.value1b(o.flags);
 				s.value1b(o.tag);
+#endif
 			});
 	}
 
+	// conversions for the integer millisecond timestamps of .funscript files
+	static inline FunscriptTime TimeFromMilliseconds(double ms) noexcept
+	{
+#if OFS_FIXED_TIMEBASE
+		return FunscriptTime::FromTicks(FunscriptTime::SecondsToTicks(ms / 1000.0));
+#else
+		return (float)(ms / 1000.0);
+#endif
+	}
+
+	static inline int64_t TimeToMilliseconds(FunscriptTime time) noexcept
+	{
+#if OFS_FIXED_TIMEBASE
+		return (int64_t)std::llround((double)time.Ticks / FunscriptTime::TicksPerMillisecond);
+#else
+		return (int64_t)std::round(time * 1000.0);
+#endif
+	}
+
 	FunscriptAction() noexcept
 		: atS(std::numeric_limits<float>::min()), pos(std::numeric_limits<int16_t>::min()), flags(0), tag(0) {
 		static_assert(sizeof(FunscriptAction) == 8);
@@ -43,6 +142,20 @@ public:
 		this->tag = 0;
 	}
 
+#if OFS_FIXED_TIMEBASE
+	FunscriptAction(FunscriptTime at, int32_t pos) noexcept
+		: FunscriptAction(0.f, pos)
+	{
+		this->atS = at;
+	}
+
+	FunscriptAction(FunscriptTime at, int32_t pos, uint8_t tag) noexcept
+		: FunscriptAction(at, pos)
+	{
+		this->tag = tag;
+	}
+#endif
+
 	FunscriptAction(float at, int32_t pos, uint8_t tag) noexcept
 		: FunscriptAction(at, pos)
 	{
@@ -81,4 +194,12 @@ struct ActionLess
 };
 
 
+#if OFS_CHUNKED_ACTIONS
+// scales better for scripts with hundreds of thousands of actions
+using FunscriptArray = chunked_vector_set<FunscriptAction, ActionLess>;
+#else
 using FunscriptArray = vector_set<FunscriptAction, ActionLess>;
+#endif
+
+// scratch copies of actions which are only needed within the current frame
+using FunscriptFrameArray = vector_set<FunscriptAction, ActionLess, OFS_FrameAllocator<FunscriptAction>>;
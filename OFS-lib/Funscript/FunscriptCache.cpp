@@ -0,0 +1,160 @@
+#include "FunscriptCache.h"
+#include "OFS_MappedFile.h"
+#include "OFS_Util.h"
+#include "OFS_Profiling.h"
+
+#include <filesystem>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable_v<FunscriptAction>, "actions are stored as raw bytes");
+static_assert(sizeof(FunscriptCache::Header) % alignof(FunscriptAction) == 0, "actions have to stay aligned");
+
+inline static uint32_t cacheFlags() noexcept
+{
+#if OFS_FIXED_TIMEBASE
+	return FunscriptCache::FixedTimebaseFlag;
+#else
+	return 0;
+#endif
+}
+
+// FNV-1a
+inline static uint64_t hashBytes(const void* data, size_t size) noexcept
+{
+	auto bytes = (const uint8_t*)data;
+	uint64_t hash = 0xcbf29ce484222325;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+std::string FunscriptCache::CachePath(const std::string& sourcePath) noexcept
+{
+	std::error_code ec;
+	auto absolutePath = std::filesystem::absolute(Util::PathFromString(sourcePath), ec).lexically_normal().u8string();
+
+	char name[32];
+	stbsp_snprintf(name, sizeof(name), "%016llx.ofsc", (unsigned long long)hashBytes(absolutePath.data(), absolutePath.size()));
+	return Util::Prefpath("cache/" + std::string(name));
+}
+
+bool FunscriptCache::Load(const std::string& sourcePath, FunscriptArray& actions, nlohmann::json& metadata, bool* hasMetadata) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	Header expected;
+	expected.Flags = cacheFlags();
+
+	auto cachePath = CachePath(sourcePath);
+	OFS_MappedFile file;
+	if (!file.Open(cachePath)) return false;
+	if (file.Size() < sizeof(Header)) return false;
+
+	Header header;
+	std::memcpy(&header, file.Data(), sizeof(Header));
+	if (std::memcmp(header.Magic, expected.Magic, sizeof(header.Magic)) != 0
+		|| header.Version != expected.Version
+		|| header.ActionSize != expected.ActionSize
+		|| header.Flags != expected.Flags) {
+		return false;
+	}
+	{
+		// the size rejects most changes without reading the source
+		OFS_MappedFile source;
+		if (!source.Open(sourcePath) || source.Size() != header.SourceSize) return false;
+		if (hashBytes(source.Data(), source.Size()) != header.SourceHash) return false;
+	}
+	uint64_t actionBytes = header.ActionCount * sizeof(FunscriptAction);
+	if (file.Size() != sizeof(Header) + actionBytes + header.MetadataSize) {
+		LOG_WARN("Ignoring truncated funscript cache.");
+		return false;
+	}
+
+	*hasMetadata = header.MetadataSize > 0;
+	if (*hasMetadata) {
+		auto metadataBytes = file.Data() + sizeof(Header) + actionBytes;
+		metadata = nlohmann::json::from_cbor(metadataBytes, metadataBytes + header.MetadataSize, true, false);
+		if (metadata.is_discarded() || !metadata.is_object()) return false;
+	}
+
+	auto mappedActions = (const FunscriptAction*)(file.Data() + sizeof(Header));
+	// the actions are stored sorted, a single bulk copy out of the mapping
+	actions.assign(mappedActions, mappedActions + header.ActionCount);
+
+	// the mtime marks the last use for pruning
+	std::error_code ec;
+	std::filesystem::last_write_time(Util::PathFromString(cachePath), std::filesystem::file_time_type::clock::now(), ec);
+	return true;
+}
+
+bool FunscriptCache::Store(const std::string& sourcePath, const std::string& sourceText, const FunscriptArray& actions, const nlohmann::json* metadata) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	Header header;
+	header.SourceSize = sourceText.size();
+	header.SourceHash = hashBytes(sourceText.data(), sourceText.size());
+	header.Flags = cacheFlags();
+	header.ActionCount = actions.size();
+
+	std::vector<uint8_t> metadataBytes;
+	if (metadata) {
+		nlohmann::json::to_cbor(*metadata, metadataBytes);
+	}
+	header.MetadataSize = metadataBytes.size();
+
+	std::vector<uint8_t> buffer;
+	buffer.resize(sizeof(Header) + actions.size() * sizeof(FunscriptAction) + metadataBytes.size());
+	std::memcpy(buffer.data(), &header, sizeof(Header));
+	auto outActions = buffer.data() + sizeof(Header);
+	for (auto action : actions) {
+		std::memcpy(outActions, &action, sizeof(FunscriptAction));
+		outActions += sizeof(FunscriptAction);
+	}
+	if (!metadataBytes.empty()) {
+		std::memcpy(outActions, metadataBytes.data(), metadataBytes.size());
+	}
+
+	if (!Util::CreateDirectories(Util::PathFromString(Util::Prefpath("cache")))) return false;
+	if (!Util::WriteFileAtomic(CachePath(sourcePath), buffer.data(), buffer.size())) return false;
+	Prune();
+	return true;
+}
+
+void FunscriptCache::Prune() noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	struct CacheFile {
+		std::filesystem::path Path;
+		uint64_t Size;
+		std::filesystem::file_time_type LastUse;
+	};
+	std::vector<CacheFile> files;
+	std::error_code ec;
+	for (auto it = std::filesystem::directory_iterator(Util::PathFromString(Util::Prefpath("cache")), ec);
+		!ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+		if (it->path().extension() != ".ofsc") continue;
+		std::error_code fileEc;
+		auto size = it->file_size(fileEc);
+		if (fileEc) continue;
+		auto lastUse = it->last_write_time(fileEc);
+		if (fileEc) continue;
+		files.emplace_back(CacheFile{ it->path(), size, lastUse });
+	}
+
+	// most recently used first, everything past the age or size limit goes
+	std::sort(files.begin(), files.end(), [](auto& a, auto& b) noexcept { return a.LastUse > b.LastUse; });
+	auto oldest = std::filesystem::file_time_type::clock::now() - std::chrono::hours(24 * MaxCacheAgeDays);
+	uint64_t totalSize = 0;
+	for (auto& file : files) {
+		totalSize += file.Size;
+		if (totalSize > MaxCacheSize || file.LastUse < oldest) {
+			std::error_code removeEc;
+			std::filesystem::remove(file.Path, removeEc);
+		}
+	}
+}
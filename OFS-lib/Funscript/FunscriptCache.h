@@ -0,0 +1,40 @@
+#pragma once
+
+#include "nlohmann/json.hpp"
+#include "FunscriptAction.h"
+
+#include <string>
+#include <cstdint>
+
+// Binary copy of a parsed .funscript in the pref path.
+// Layout: header, the sorted actions as they are in memory, the metadata object as CBOR.
+// The cache is keyed by the absolute source path and is stale as soon as the size or content hash of the source changes.
+// Loading a cache refreshes its mtime, storing one prunes the least recently used caches beyond MaxCacheSize or MaxCacheAge.
+class FunscriptCache
+{
+public:
+	struct Header {
+		char Magic[4] = { 'O', 'F', 'S', 'C' };
+		uint32_t Version = 2;
+		uint32_t ActionSize = sizeof(FunscriptAction);
+		uint32_t Flags = 0;
+		uint64_t SourceSize = 0;
+		uint64_t SourceHash = 0;
+		uint64_t ActionCount = 0;
+		// zero when the script had no metadata object
+		uint64_t MetadataSize = 0;
+	};
+
+	static constexpr uint32_t FixedTimebaseFlag = 1;
+	static constexpr uint64_t MaxCacheSize = 256 * 1024 * 1024;
+	static constexpr uint32_t MaxCacheAgeDays = 30;
+
+	static std::string CachePath(const std::string& sourcePath) noexcept;
+
+	// maps the cache of sourcePath, returns false if there is none or it's stale
+	static bool Load(const std::string& sourcePath, FunscriptArray& actions, nlohmann::json& metadata, bool* hasMetadata) noexcept;
+	// sourceText is the content the actions were parsed from, actions have to be sorted and unique
+	static bool Store(const std::string& sourcePath, const std::string& sourceText, const FunscriptArray& actions, const nlohmann::json* metadata) noexcept;
+	// removes caches which weren't used for MaxCacheAgeDays and the least recently used ones above MaxCacheSize
+	static void Prune() noexcept;
+};
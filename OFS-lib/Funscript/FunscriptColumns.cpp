@@ -0,0 +1,307 @@
+#include "FunscriptColumns.h"
+#include "OFS_Profiling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define OFS_COLUMNS_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OFS_COLUMNS_SSE 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+static inline uint32_t popcount(uint32_t bits) noexcept { return __popcnt(bits); }
+#else
+static inline uint32_t popcount(uint32_t bits) noexcept { return __builtin_popcount(bits); }
+#endif
+
+// the binary search stops at blocks of this size which are counted with simd compares
+static constexpr uint32_t SearchBlock = 64;
+
+const char* FunscriptColumns::KernelName() noexcept
+{
+#if defined(OFS_COLUMNS_AVX)
+	return "AVX";
+#elif defined(OFS_COLUMNS_SSE)
+	return "SSE2";
+#else
+	return "Scalar";
+#endif
+}
+
+void FunscriptColumns::Rebuild(const FunscriptArray& actions, uint64_t actionsVersion) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	times.resize(actions.size());
+	positions.resize(actions.size());
+	uint32_t i = 0;
+	for (auto& action : actions) {
+		times[i] = action.atS;
+		positions[i] = action.pos;
+		++i;
+	}
+	version = actionsVersion;
+}
+
+// counts the values in [first, last) which are smaller than (or equal to) the value
+template<bool OrEqual>
+static uint32_t countBelow(const float* values, uint32_t first, uint32_t last, float value) noexcept
+{
+	uint32_t count = 0;
+	uint32_t i = first;
+#if defined(OFS_COLUMNS_AVX)
+	__m256 v = _mm256_set1_ps(value);
+	for (; i + 8 <= last; i += 8) {
+		__m256 x = _mm256_loadu_ps(values + i);
+		__m256 mask = OrEqual ? _mm256_cmp_ps(x, v, _CMP_LE_OQ) : _mm256_cmp_ps(x, v, _CMP_LT_OQ);
+		count += popcount((uint32_t)_mm256_movemask_ps(mask));
+	}
+#elif defined(OFS_COLUMNS_SSE)
+	__m128 v = _mm_set1_ps(value);
+	for (; i + 4 <= last; i += 4) {
+		__m128 x = _mm_loadu_ps(values + i);
+		__m128 mask = OrEqual ? _mm_cmple_ps(x, v) : _mm_cmplt_ps(x, v);
+		count += popcount((uint32_t)_mm_movemask_ps(mask));
+	}
+#endif
+	for (; i < last; ++i) {
+		count += OrEqual ? values[i] <= value : values[i] < value;
+	}
+	return count;
+}
+
+template<bool Upper>
+static uint32_t searchColumn(const std::vector<float>& times, float time) noexcept
+{
+	uint32_t lo = 0;
+	uint32_t hi = (uint32_t)times.size();
+	while (hi - lo > SearchBlock) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		bool before = Upper ? times[mid] <= time : times[mid] < time;
+		if (before) lo = mid + 1;
+		else hi = mid;
+	}
+	// the column is sorted so the count is the offset of the bound
+	return lo + countBelow<Upper>(times.data(), lo, hi, time);
+}
+
+uint32_t FunscriptColumns::LowerBound(float time) const noexcept
+{
+	return searchColumn<false>(times, time);
+}
+
+uint32_t FunscriptColumns::UpperBound(float time) const noexcept
+{
+	return searchColumn<true>(times, time);
+}
+
+FunscriptColumns::PositionRange FunscriptColumns::MinMaxPosition(Range range) const noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	PositionRange result;
+	range.Last = std::min(range.Last, Size());
+	if (range.Size() == 0) return result;
+
+	const float* pos = positions.data();
+	float minPos = pos[range.First];
+	float maxPos = pos[range.First];
+	uint32_t i = range.First;
+#if defined(OFS_COLUMNS_AVX)
+	__m256 vMin = _mm256_set1_ps(minPos);
+	__m256 vMax = vMin;
+	for (; i + 8 <= range.Last; i += 8) {
+		__m256 x = _mm256_loadu_ps(pos + i);
+		vMin = _mm256_min_ps(vMin, x);
+		vMax = _mm256_max_ps(vMax, x);
+	}
+	alignas(32) float lanesMin[8];
+	alignas(32) float lanesMax[8];
+	_mm256_store_ps(lanesMin, vMin);
+	_mm256_store_ps(lanesMax, vMax);
+	for (int lane = 0; lane < 8; ++lane) {
+		minPos = std::min(minPos, lanesMin[lane]);
+		maxPos = std::max(maxPos, lanesMax[lane]);
+	}
+#elif defined(OFS_COLUMNS_SSE)
+	__m128 vMin = _mm_set1_ps(minPos);
+	__m128 vMax = vMin;
+	for (; i + 4 <= range.Last; i += 4) {
+		__m128 x = _mm_loadu_ps(pos + i);
+		vMin = _mm_min_ps(vMin, x);
+		vMax = _mm_max_ps(vMax, x);
+	}
+	alignas(16) float lanesMin[4];
+	alignas(16) float lanesMax[4];
+	_mm_store_ps(lanesMin, vMin);
+	_mm_store_ps(lanesMax, vMax);
+	for (int lane = 0; lane < 4; ++lane) {
+		minPos = std::min(minPos, lanesMin[lane]);
+		maxPos = std::max(maxPos, lanesMax[lane]);
+	}
+#endif
+	for (; i < range.Last; ++i) {
+		minPos = std::min(minPos, pos[i]);
+		maxPos = std::max(maxPos, pos[i]);
+	}
+	result.Min = minPos;
+	result.Max = maxPos;
+	return result;
+}
+
+FunscriptColumns::SpeedStats FunscriptColumns::Speed(Range range) const noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	SpeedStats result;
+	range.Last = std::min(range.Last, Size());
+	if (range.Size() < 2) return result;
+
+	const float* t = times.data();
+	const float* pos = positions.data();
+	float maxSpeed = 0.f;
+	float distance = 0.f;
+	// i is the index of the first action of a segment
+	uint32_t i = range.First;
+	uint32_t lastSegment = range.Last - 1;
+#if defined(OFS_COLUMNS_AVX)
+	const __m256 signMask = _mm256_set1_ps(-0.f);
+	const __m256 zero = _mm256_setzero_ps();
+	__m256 vMax = zero;
+	__m256 vDistance = zero;
+	for (; i + 8 <= lastSegment; i += 8) {
+		__m256 dt = _mm256_sub_ps(_mm256_loadu_ps(t + i + 1), _mm256_loadu_ps(t + i));
+		__m256 dp = _mm256_andnot_ps(signMask, _mm256_sub_ps(_mm256_loadu_ps(pos + i + 1), _mm256_loadu_ps(pos + i)));
+		__m256 valid = _mm256_cmp_ps(dt, zero, _CMP_GT_OQ);
+		dp = _mm256_and_ps(valid, dp);
+		__m256 speed = _mm256_and_ps(valid, _mm256_div_ps(dp, dt));
+		vMax = _mm256_max_ps(vMax, speed);
+		vDistance = _mm256_add_ps(vDistance, dp);
+	}
+	alignas(32) float lanesMax[8];
+	alignas(32) float lanesDistance[8];
+	_mm256_store_ps(lanesMax, vMax);
+	_mm256_store_ps(lanesDistance, vDistance);
+	for (int lane = 0; lane < 8; ++lane) {
+		maxSpeed = std::max(maxSpeed, lanesMax[lane]);
+		distance += lanesDistance[lane];
+	}
+#elif defined(OFS_COLUMNS_SSE)
+	const __m128 signMask = _mm_set1_ps(-0.f);
+	const __m128 zero = _mm_setzero_ps();
+	__m128 vMax = zero;
+	__m128 vDistance = zero;
+	for (; i + 4 <= lastSegment; i += 4) {
+		__m128 dt = _mm_sub_ps(_mm_loadu_ps(t + i + 1), _mm_loadu_ps(t + i));
+		__m128 dp = _mm_andnot_ps(signMask, _mm_sub_ps(_mm_loadu_ps(pos + i + 1), _mm_loadu_ps(pos + i)));
+		__m128 valid = _mm_cmpgt_ps(dt, zero);
+		dp = _mm_and_ps(valid, dp);
+		__m128 speed = _mm_and_ps(valid, _mm_div_ps(dp, dt));
+		vMax = _mm_max_ps(vMax, speed);
+		vDistance = _mm_add_ps(vDistance, dp);
+	}
+	alignas(16) float lanesMax[4];
+	alignas(16) float lanesDistance[4];
+	_mm_store_ps(lanesMax, vMax);
+	_mm_store_ps(lanesDistance, vDistance);
+	for (int lane = 0; lane < 4; ++lane) {
+		maxSpeed = std::max(maxSpeed, lanesMax[lane]);
+		distance += lanesDistance[lane];
+	}
+#endif
+	for (; i < lastSegment; ++i) {
+		float dt = t[i + 1] - t[i];
+		float dp = std::abs(pos[i + 1] - pos[i]);
+		if (dt <= 0.f) continue;
+		maxSpeed = std::max(maxSpeed, dp / dt);
+		distance += dp;
+	}
+
+	result.MaxSpeed = maxSpeed;
+	result.TotalDistance = distance;
+	result.TotalTime = t[range.Last - 1] - t[range.First];
+	result.AverageSpeed = result.TotalTime > 0.f ? distance / result.TotalTime : 0.f;
+	return result;
+}
+
+void FunscriptColumns::TransformPositions(Range range, float scale, float offset) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	range.Last = std::min(range.Last, Size());
+	float* pos = positions.data();
+	uint32_t i = range.First;
+#if defined(OFS_COLUMNS_AVX)
+	const __m256 vScale = _mm256_set1_ps(scale);
+	const __m256 vOffset = _mm256_set1_ps(offset);
+	const __m256 vMin = _mm256_setzero_ps();
+	const __m256 vMax = _mm256_set1_ps(100.f);
+	for (; i + 8 <= range.Last; i += 8) {
+		__m256 x = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(pos + i), vScale), vOffset);
+		x = _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		x = _mm256_min_ps(_mm256_max_ps(x, vMin), vMax);
+		_mm256_storeu_ps(pos + i, x);
+	}
+#elif defined(OFS_COLUMNS_SSE)
+	const __m128 vScale = _mm_set1_ps(scale);
+	const __m128 vOffset = _mm_set1_ps(offset);
+	const __m128 vMin = _mm_setzero_ps();
+	const __m128 vMax = _mm_set1_ps(100.f);
+	for (; i + 4 <= range.Last; i += 4) {
+		__m128 x = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(pos + i), vScale), vOffset);
+		// clamp first so the conversion can't overflow, the round trip rounds to nearest even
+		x = _mm_min_ps(_mm_max_ps(x, vMin), vMax);
+		x = _mm_cvtepi32_ps(_mm_cvtps_epi32(x));
+		_mm_storeu_ps(pos + i, x);
+	}
+#endif
+	for (; i < range.Last; ++i) {
+		float x = std::nearbyint(pos[i] * scale + offset);
+		pos[i] = std::min(std::max(x, 0.f), 100.f);
+	}
+}
+
+void FunscriptColumns::EvaluateCubic(const float* times, uint32_t count, float* out,
+	float startTime, float invDuration, float c0, float c1, float c2, float c3) noexcept
+{
+	uint32_t i = 0;
+#if defined(OFS_COLUMNS_AVX)
+	const __m256 vStart = _mm256_set1_ps(startTime);
+	const __m256 vInv = _mm256_set1_ps(invDuration);
+	const __m256 v0 = _mm256_set1_ps(c0);
+	const __m256 v1 = _mm256_set1_ps(c1);
+	const __m256 v2 = _mm256_set1_ps(c2);
+	const __m256 v3 = _mm256_set1_ps(c3);
+	const __m256 vMin = _mm256_setzero_ps();
+	const __m256 vMax = _mm256_set1_ps(100.f);
+	for (; i + 8 <= count; i += 8) {
+		__m256 u = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(times + i), vStart), vInv);
+		__m256 x = _mm256_add_ps(_mm256_mul_ps(v3, u), v2);
+		x = _mm256_add_ps(_mm256_mul_ps(x, u), v1);
+		x = _mm256_add_ps(_mm256_mul_ps(x, u), v0);
+		_mm256_storeu_ps(out + i, _mm256_min_ps(_mm256_max_ps(x, vMin), vMax));
+	}
+#elif defined(OFS_COLUMNS_SSE)
+	const __m128 vStart = _mm_set1_ps(startTime);
+	const __m128 vInv = _mm_set1_ps(invDuration);
+	const __m128 v0 = _mm_set1_ps(c0);
+	const __m128 v1 = _mm_set1_ps(c1);
+	const __m128 v2 = _mm_set1_ps(c2);
+	const __m128 v3 = _mm_set1_ps(c3);
+	const __m128 vMin = _mm_setzero_ps();
+	const __m128 vMax = _mm_set1_ps(100.f);
+	for (; i + 4 <= count; i += 4) {
+		__m128 u = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(times + i), vStart), vInv);
+		__m128 x = _mm_add_ps(_mm_mul_ps(v3, u), v2);
+		x = _mm_add_ps(_mm_mul_ps(x, u), v1);
+		x = _mm_add_ps(_mm_mul_ps(x, u), v0);
+		_mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(x, vMin), vMax));
+	}
+#endif
+	for (; i < count; ++i) {
+		float u = (times[i] - startTime) * invDuration;
+		float x = ((c3 * u + c2) * u + c1) * u + c0;
+		out[i] = std::min(std::max(x, 0.f), 100.f);
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "FunscriptAction.h"
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+// Structure of arrays mirror of Funscript::FunscriptData::Actions, kept in sync by Funscript.
+// Statistics, the heatmap and whole script position transforms stream through the time or position
+// column only. The kernels use AVX when OFS_AVX is enabled, SSE2 on x86 and plain loops everywhere else.
+// Times are float seconds in both timebases, bounds are compared against the column as floats.
+class FunscriptColumns
+{
+public:
+	// [First, Last) indices into the actions
+	struct Range {
+		uint32_t First = 0;
+		uint32_t Last = 0;
+		inline uint32_t Size() const noexcept { return Last > First ? Last - First : 0; }
+	};
+
+	struct PositionRange {
+		float Min = 0.f;
+		float Max = 0.f;
+	};
+
+	struct SpeedStats {
+		// units per second
+		float MaxSpeed = 0.f;
+		float AverageSpeed = 0.f;
+		// sum of all position changes
+		float TotalDistance = 0.f;
+		float TotalTime = 0.f;
+	};
+
+private:
+	std::vector<float> times;
+	std::vector<float> positions;
+	uint64_t version = std::numeric_limits<uint64_t>::max();
+
+public:
+	static const char* KernelName() noexcept;
+
+	void Rebuild(const FunscriptArray& actions, uint64_t actionsVersion) noexcept;
+	inline bool IsSynced(uint64_t actionsVersion) const noexcept { return version == actionsVersion; }
+	inline void MarkSynced(uint64_t actionsVersion) noexcept { version = actionsVersion; }
+
+	inline uint32_t Size() const noexcept { return (uint32_t)times.size(); }
+	inline Range All() const noexcept { return Range{ 0, Size() }; }
+	inline const float* Times() const noexcept { return times.data(); }
+	inline const float* Positions() const noexcept { return positions.data(); }
+
+	// first index with a time >= time
+	uint32_t LowerBound(float time) const noexcept;
+	// first index with a time > time
+	uint32_t UpperBound(float time) const noexcept;
+	// all actions with fromTime <= atS <= toTime
+	inline Range WindowRange(float fromTime, float toTime) const noexcept { return Range{ LowerBound(fromTime), UpperBound(toTime) }; }
+
+	PositionRange MinMaxPosition(Range range) const noexcept;
+	// speeds between consecutive actions inside of the range, segments without duration are skipped
+	SpeedStats Speed(Range range) const noexcept;
+
+	// pos = clamp(round(pos * scale + offset), 0, 100)
+	void TransformPositions(Range range, float scale, float offset) noexcept;
+
+	// out[i] = clamp(c0 + c1*u + c2*u^2 + c3*u^3, 0, 100) with u = (times[i] - startTime) * invDuration
+	// works on caller provided arrays and can be used from any thread
+	static void EvaluateCubic(const float* times, uint32_t count, float* out,
+		float startTime, float invDuration, float c0, float c1, float c2, float c3) noexcept;
+};
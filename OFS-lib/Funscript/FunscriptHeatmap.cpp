@@ -149,56 +149,112 @@ FunscriptHeatmap::FunscriptHeatmap() noexcept
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void FunscriptHeatmap::Update(float totalDuration, const FunscriptArray& actions) noexcept
+void FunscriptHeatmap::Update(float totalDuration, const FunscriptColumns& columns) noexcept
 {
     OFS_PROFILE(__FUNCTION__);
-    std::vector<float> speedBuffer; 
-    speedBuffer.resize(SpeedTextureResolution, 0.f);
-    std::vector<uint16_t> sampleCountBuffer;
-    sampleCountBuffer.resize(SpeedTextureResolution, 0);
+    duration = totalDuration;
+    lastColumns = &columns;
+    speedSums.assign(SpeedTextureResolution, 0.f);
+    sampleCounts.assign(SpeedTextureResolution, 0);
 
+    accumulate(columns, 0, SpeedTextureResolution - 1);
+    upload(0, SpeedTextureResolution - 1);
+}
+
+void FunscriptHeatmap::UpdateRange(float totalDuration, const FunscriptColumns& columns, float fromTime, float toTime) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    if (totalDuration != duration || lastColumns != &columns || speedSums.size() != SpeedTextureResolution) {
+        Update(totalDuration, columns);
+        return;
+    }
+    if (totalDuration <= 0.f) return;
+
+    // the segments connecting the edited range with the
+    // untouched actions on either side changed as well
     float timeStep = totalDuration / SpeedTextureResolution;
+    uint32_t firstSample = 0;
+    uint32_t lastSample = SpeedTextureResolution - 1;
+
+    const float* times = columns.Times();
+    uint32_t before = columns.LowerBound(fromTime);
+    if (before > 0) {
+        firstSample = Util::Min<uint32_t>(times[before - 1] / timeStep, SpeedTextureResolution - 1);
+    }
+    uint32_t after = columns.UpperBound(toTime);
+    if (after < columns.Size()) {
+        lastSample = Util::Min<uint32_t>(times[after] / timeStep, SpeedTextureResolution - 1);
+    }
 
-    for(uint32_t i = 0, j = 1, size = actions.size(); j < size; i = j++)
+    std::fill(speedSums.begin() + firstSample, speedSums.begin() + lastSample + 1, 0.f);
+    std::fill(sampleCounts.begin() + firstSample, sampleCounts.begin() + lastSample + 1, 0);
+    accumulate(columns, firstSample, lastSample);
+    upload(firstSample, lastSample);
+}
+
+void FunscriptHeatmap::accumulate(const FunscriptColumns& columns, uint32_t firstSample, uint32_t lastSample) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    if (columns.Size() < 2 || duration <= 0.f) return;
+    float timeStep = duration / SpeedTextureResolution;
+
+    // start with the segment which overlaps the first sample
+    uint32_t startIdx = columns.LowerBound(firstSample * timeStep);
+    if (startIdx > 0) startIdx -= 1;
+    float endTime = (lastSample + 1) * timeStep;
+
+    const float* times = columns.Times();
+    const float* positions = columns.Positions();
+    for(uint32_t i = startIdx, j = startIdx + 1, size = columns.Size(); j < size; i = j++)
     {
-        auto prev = actions[i];
-        auto next = actions[j];
+        float prevTime = times[i];
+        float nextTime = times[j];
+        if (prevTime >= endTime) break;
 
-        float strokeDuration = next.atS - prev.atS;
-        float speed = std::abs(prev.pos - next.pos) / strokeDuration;
+        float strokeDuration = nextTime - prevTime;
+        if (strokeDuration <= 0.f) continue;
+        float speed = std::abs(positions[i] - positions[j]) / strokeDuration;
     
-        uint32_t prevSampleIdx = prev.atS / timeStep;
-        uint32_t nextSampleIdx = next.atS / timeStep;
+        uint32_t prevSampleIdx = prevTime / timeStep;
+        uint32_t nextSampleIdx = nextTime / timeStep;
         if(prevSampleIdx == nextSampleIdx)
         {
-            if(prevSampleIdx < SpeedTextureResolution)
+            if(prevSampleIdx < SpeedTextureResolution && prevSampleIdx >= firstSample && prevSampleIdx <= lastSample)
             {
-                sampleCountBuffer[prevSampleIdx] += 1;
-                speedBuffer[prevSampleIdx] += speed;
+                sampleCounts[prevSampleIdx] += 1;
+                speedSums[prevSampleIdx] += speed;
             }
         }
         else
         {
             if(prevSampleIdx < SpeedTextureResolution && nextSampleIdx < SpeedTextureResolution)
             {
-                for(int x = prevSampleIdx; x < nextSampleIdx; x += 1)
+                uint32_t from = Util::Max(prevSampleIdx, firstSample);
+                uint32_t to = Util::Min(nextSampleIdx, lastSample + 1);
+                for(uint32_t x = from; x < to; x += 1)
                 {
-                    sampleCountBuffer[x] += 1;
-                    speedBuffer[x] += speed;
+                    sampleCounts[x] += 1;
+                    speedSums[x] += speed;
                 }
             }
         }
     }
+}
 
-    for(uint32_t i=0; i < SpeedTextureResolution; i += 1)
+void FunscriptHeatmap::upload(uint32_t firstSample, uint32_t lastSample) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    OFS_FrameVector<float> speedBuffer(lastSample - firstSample + 1);
+    for(uint32_t i = firstSample; i <= lastSample; i += 1)
     {
-        speedBuffer[i] /= sampleCountBuffer[i] > 0 ? (float)sampleCountBuffer[i] : 1.f;
-        speedBuffer[i] /= MaxSpeedPerSecond;
-        speedBuffer[i] = Util::Clamp(speedBuffer[i], 0.f, 1.f);
+        float speed = speedSums[i];
+        speed /= sampleCounts[i] > 0 ? (float)sampleCounts[i] : 1.f;
+        speed /= MaxSpeedPerSecond;
+        speedBuffer[i - firstSample] = Util::Clamp(speed, 0.f, 1.f);
     }
 
     glBindTexture(GL_TEXTURE_2D, speedTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, SpeedTextureResolution, 1, 0, GL_RED, GL_FLOAT, speedBuffer.data());
+    glTexSubImage2D(GL_TEXTURE_2D, 0, firstSample, 0, speedBuffer.size(), 1, GL_RED, GL_FLOAT, speedBuffer.data());
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
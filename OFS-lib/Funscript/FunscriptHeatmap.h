@@ -18,7 +18,17 @@ public:
 	FunscriptHeatmap() noexcept;
 
 	void DrawHeatmap(ImDrawList* drawList, const ImVec2& min, const ImVec2& max) noexcept;
-	void Update(float totalDuration , const FunscriptArray& actions) noexcept;
+	void Update(float totalDuration, const FunscriptColumns& columns) noexcept;
+	// only recomputes the part of the heatmap affected by changes between fromTime and toTime
+	void UpdateRange(float totalDuration, const FunscriptColumns& columns, float fromTime, float toTime) noexcept;
 
 	std::vector<uint8_t> RenderToBitmap(int16_t width, int16_t height) noexcept;
+private:
+	float duration = 0.f;
+	const FunscriptColumns* lastColumns = nullptr;
+	std::vector<float> speedSums;
+	std::vector<uint16_t> sampleCounts;
+
+	void accumulate(const FunscriptColumns& columns, uint32_t firstSample, uint32_t lastSample) noexcept;
+	void upload(uint32_t firstSample, uint32_t lastSample) noexcept;
 };
@@ -0,0 +1,178 @@
+#include "FunscriptReader.h"
+#include "OFS_Util.h"
+#include "OFS_Profiling.h"
+
+bool FunscriptSaxReader::Parse(const char* text, size_t size) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	bool succ = false;
+	try {
+		succ = json::sax_parse(text, text + size, this, json::input_format_t::json, true, true);
+	}
+	catch (const std::exception& ex) {
+		LOGF_ERROR("Failed to parse funscript. %s", ex.what());
+		return false;
+	}
+	if (succ && !HasActions) {
+		LOG_ERROR("Failed to load Funscript. No action array found.");
+	}
+	return succ && HasActions;
+}
+
+void FunscriptSaxReader::actionNumber(double value) noexcept
+{
+	switch (field) {
+		case ActionField::At:
+			actionAt = value;
+			hasAt = true;
+			break;
+		case ActionField::Pos:
+			actionPos = (int32_t)value;
+			hasPos = true;
+			break;
+		default:
+			break;
+	}
+}
+
+FunscriptSaxReader::json* FunscriptSaxReader::captureValue(json&& value) noexcept
+{
+	auto& container = *metadataStack.back();
+	if (container.is_array()) {
+		container.emplace_back(std::move(value));
+		return &container.back();
+	}
+	auto& slot = container[metadataKey];
+	slot = std::move(value);
+	return &slot;
+}
+
+bool FunscriptSaxReader::null()
+{
+	if (capturing()) captureValue(json());
+	return true;
+}
+
+bool FunscriptSaxReader::boolean(bool val)
+{
+	if (capturing()) captureValue(json(val));
+	return true;
+}
+
+bool FunscriptSaxReader::number_integer(number_integer_t val)
+{
+	if (inAction()) actionNumber((double)val);
+	else if (capturing()) captureValue(json(val));
+	return true;
+}
+
+bool FunscriptSaxReader::number_unsigned(number_unsigned_t val)
+{
+	if (inAction()) actionNumber((double)val);
+	else if (capturing()) captureValue(json(val));
+	return true;
+}
+
+bool FunscriptSaxReader::number_float(number_float_t val, const string_t& s)
+{
+	if (inAction()) actionNumber(val);
+	else if (capturing()) captureValue(json(val));
+	return true;
+}
+
+bool FunscriptSaxReader::string(string_t& val)
+{
+	if (capturing()) captureValue(json(std::move(val)));
+	return true;
+}
+
+bool FunscriptSaxReader::binary(binary_t& val)
+{
+	return true;
+}
+
+bool FunscriptSaxReader::start_object(std::size_t elements)
+{
+	++depth;
+	if (capturing()) {
+		metadataStack.emplace_back(captureValue(json::object()));
+	}
+	else if (depth == 2 && rootKey == "metadata") {
+		Metadata = json::object();
+		HasMetadata = true;
+		metadataStack.emplace_back(&Metadata);
+	}
+	else if (inAction()) {
+		field = ActionField::None;
+		hasAt = false;
+		hasPos = false;
+	}
+	return true;
+}
+
+bool FunscriptSaxReader::key(string_t& val)
+{
+	if (depth == 1) {
+		rootKey = val;
+	}
+	else if (capturing()) {
+		metadataKey = std::move(val);
+	}
+	else if (inAction()) {
+		field = val == "at" ? ActionField::At
+			: val == "pos" ? ActionField::Pos
+			: ActionField::None;
+	}
+	return true;
+}
+
+bool FunscriptSaxReader::end_object()
+{
+	if (capturing()) {
+		metadataStack.pop_back();
+	}
+	else if (inAction() && hasAt && hasPos && actionAt >= 0.0) {
+		FunscriptAction action(FunscriptAction::TimeFromMilliseconds(actionAt), Util::Clamp(actionPos, 0, 100));
+		if (Sorted && !Actions.empty() && !ActionLess()(Actions.back(), action)) {
+			Sorted = false;
+		}
+		Actions.emplace_back_unsorted(action);
+	}
+	--depth;
+	return true;
+}
+
+bool FunscriptSaxReader::start_array(std::size_t elements)
+{
+	++depth;
+	if (capturing()) {
+		metadataStack.emplace_back(captureValue(json::array()));
+	}
+	else if (depth == 1) {
+		LOG_ERROR("Failed to load Funscript. The root isn't an object.");
+		return false;
+	}
+	else if (depth == 2 && rootKey == "actions") {
+		inActions = true;
+		HasActions = true;
+	}
+	return true;
+}
+
+bool FunscriptSaxReader::end_array()
+{
+	if (capturing()) {
+		metadataStack.pop_back();
+	}
+	else if (depth == 2) {
+		inActions = false;
+	}
+	--depth;
+	return true;
+}
+
+bool FunscriptSaxReader::parse_error(std::size_t position, const std::string& lastToken, const nlohmann::detail::exception& ex)
+{
+	LOGF_ERROR("Failed to parse funscript at byte %zu. %s", position, ex.what());
+	return false;
+}
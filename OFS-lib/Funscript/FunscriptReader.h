@@ -0,0 +1,72 @@
+#pragma once
+
+#include "nlohmann/json.hpp"
+#include "FunscriptAction.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// SAX handler for .funscript files.
+// Actions are appended straight into the array without building a json document for them,
+// only the small metadata object gets materialized.
+class FunscriptSaxReader : public nlohmann::json::json_sax_t
+{
+public:
+	using json = nlohmann::json;
+
+	FunscriptArray& Actions;
+	json Metadata;
+	bool HasActions = false;
+	bool HasMetadata = false;
+	// false when the timestamps weren't ascending and the actions still need sorting
+	bool Sorted = true;
+
+	explicit FunscriptSaxReader(FunscriptArray& actions) noexcept
+		: Actions(actions) {}
+
+	// parses the whole text, returns false on malformed json or a missing action array
+	bool Parse(const char* text, size_t size) noexcept;
+
+	bool null() override;
+	bool boolean(bool val) override;
+	bool number_integer(number_integer_t val) override;
+	bool number_unsigned(number_unsigned_t val) override;
+	bool number_float(number_float_t val, const string_t& s) override;
+	bool string(string_t& val) override;
+	bool binary(binary_t& val) override;
+	bool start_object(std::size_t elements) override;
+	bool key(string_t& val) override;
+	bool end_object() override;
+	bool start_array(std::size_t elements) override;
+	bool end_array() override;
+	bool parse_error(std::size_t position, const std::string& lastToken, const nlohmann::detail::exception& ex) override;
+
+private:
+	enum class ActionField : uint8_t {
+		None,
+		At,
+		Pos
+	};
+
+	// the root object is depth 1
+	uint32_t depth = 0;
+	std::string rootKey;
+	bool inActions = false;
+
+	ActionField field = ActionField::None;
+	double actionAt = 0.0;
+	int32_t actionPos = 0;
+	bool hasAt = false;
+	bool hasPos = false;
+
+	// containers of the metadata object which are still open
+	std::vector<json*> metadataStack;
+	std::string metadataKey;
+
+	inline bool inAction() const noexcept { return inActions && depth == 3; }
+	inline bool capturing() const noexcept { return !metadataStack.empty(); }
+
+	void actionNumber(double value) noexcept;
+	json* captureValue(json&& value) noexcept;
+};
@@ -0,0 +1,143 @@
+#include "FunscriptSelection.h"
+#include "OFS_Profiling.h"
+
+uint64_t FunscriptSelection::read64(int64_t pos) const noexcept
+{
+	int64_t w = pos >= 0 ? pos / 64 : (pos - 63) / 64;
+	int64_t offset = pos - w * 64;
+	int64_t size = words.size();
+	uint64_t lo = w >= 0 && w < size ? words[w] : 0;
+	uint64_t hi = w + 1 >= 0 && w + 1 < size ? words[w + 1] : 0;
+	if (offset == 0) return lo;
+	return (lo >> offset) | (hi << (64 - offset));
+}
+
+void FunscriptSelection::maskTail() noexcept
+{
+	if (words.empty()) return;
+	uint32_t last = words.size() - 1;
+	words[last] &= rangeMask((int64_t)last * 64, 0, bitCount);
+}
+
+void FunscriptSelection::Resize(uint32_t actionCount) noexcept
+{
+	if (actionCount < bitCount) {
+		selectedCount -= CountRange(actionCount, bitCount);
+	}
+	bitCount = actionCount;
+	words.resize(wordCount(bitCount), 0);
+	maskTail();
+}
+
+void FunscriptSelection::SetRange(uint32_t first, uint32_t last, bool selected) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	if (last > bitCount) last = bitCount;
+	if (first >= last) return;
+	for (uint32_t w = first / 64, end = wordCount(last); w < end; w += 1) {
+		uint64_t mask = rangeMask((int64_t)w * 64, first, last);
+		uint64_t before = words[w];
+		words[w] = selected ? before | mask : before & ~mask;
+		selectedCount += popcount(words[w]);
+		selectedCount -= popcount(before);
+	}
+}
+
+void FunscriptSelection::ToggleRange(uint32_t first, uint32_t last) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	if (last > bitCount) last = bitCount;
+	if (first >= last) return;
+	for (uint32_t w = first / 64, end = wordCount(last); w < end; w += 1) {
+		uint64_t mask = rangeMask((int64_t)w * 64, first, last);
+		uint64_t before = words[w];
+		words[w] = before ^ mask;
+		selectedCount += popcount(words[w]);
+		selectedCount -= popcount(before);
+	}
+}
+
+uint32_t FunscriptSelection::CountRange(uint32_t first, uint32_t last) const noexcept
+{
+	if (last > bitCount) last = bitCount;
+	if (first >= last) return 0;
+	uint32_t count = 0;
+	for (uint32_t w = first / 64, end = wordCount(last); w < end; w += 1) {
+		count += popcount(words[w] & rangeMask((int64_t)w * 64, first, last));
+	}
+	return count;
+}
+
+void FunscriptSelection::Insert(uint32_t idx, uint32_t count) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	if (count == 0) return;
+	if (idx > bitCount) idx = bitCount;
+	uint32_t newBitCount = bitCount + count;
+	words.resize(wordCount(newBitCount), 0);
+
+	// high to low, the source bits are always at or below the written word
+	int64_t keepEnd = idx;
+	int64_t shiftStart = (int64_t)idx + count;
+	for (int64_t w = (int64_t)words.size() - 1, first = idx / 64; w >= first; w -= 1) {
+		int64_t base = w * 64;
+		uint64_t kept = words[w] & rangeMask(base, 0, keepEnd);
+		uint64_t shifted = read64(base - count) & rangeMask(base, shiftStart, newBitCount);
+		words[w] = kept | shifted;
+	}
+	bitCount = newBitCount;
+}
+
+void FunscriptSelection::Erase(uint32_t idx, uint32_t count) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	if (idx >= bitCount || count == 0) return;
+	if (count > bitCount - idx) count = bitCount - idx;
+	selectedCount -= CountRange(idx, idx + count);
+	uint32_t newBitCount = bitCount - count;
+
+	// low to high, the source bits are always at or above the written word
+	for (int64_t w = idx / 64, size = wordCount(newBitCount); w < size; w += 1) {
+		int64_t base = w * 64;
+		uint64_t kept = words[w] & rangeMask(base, 0, idx);
+		uint64_t shifted = read64(base + count) & rangeMask(base, idx, newBitCount);
+		words[w] = kept | shifted;
+	}
+	bitCount = newBitCount;
+	words.resize(wordCount(bitCount));
+	maskTail();
+}
+
+void FunscriptSelection::Subtract(const FunscriptSelection& other) noexcept
+{
+	selectedCount = 0;
+	for (uint32_t w = 0, size = words.size(); w < size; w += 1) {
+		if (w < other.words.size()) words[w] &= ~other.words[w];
+		selectedCount += popcount(words[w]);
+	}
+}
+
+uint32_t FunscriptSelection::FindNext(uint32_t idx) const noexcept
+{
+	if (idx >= bitCount) return None;
+	uint32_t w = idx / 64;
+	uint64_t bits = words[w] & rangeMask((int64_t)w * 64, idx, bitCount);
+	for (uint32_t size = words.size();;) {
+		if (bits) return w * 64 + ctz(bits);
+		if (++w >= size) return None;
+		bits = words[w];
+	}
+}
+
+uint32_t FunscriptSelection::FindPrev(uint32_t idx) const noexcept
+{
+	if (idx > bitCount) idx = bitCount;
+	if (idx == 0) return None;
+	int64_t w = (idx - 1) / 64;
+	uint64_t bits = words[w] & rangeMask(w * 64, 0, idx);
+	for (;;) {
+		if (bits) return w * 64 + (63 - clz(bits));
+		if (--w < 0) return None;
+		bits = words[w];
+	}
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Selection stored as a bitmap parallel to Funscript::FunscriptData::Actions.
+// Bit i is set when Actions[i] is selected.
+// The Funscript mutators keep it in sync with the actions.
+class FunscriptSelection
+{
+public:
+	static constexpr uint32_t None = std::numeric_limits<uint32_t>::max();
+
+private:
+	std::vector<uint64_t> words;
+	uint32_t bitCount = 0;
+	uint32_t selectedCount = 0;
+
+	static inline uint32_t wordCount(uint32_t bits) noexcept { return (bits + 63) / 64; }
+
+	static inline uint32_t popcount(uint64_t w) noexcept
+	{
+#if defined(_MSC_VER)
+		return (uint32_t)__popcnt64(w);
+#else
+		return (uint32_t)__builtin_popcountll(w);
+#endif
+	}
+
+	static inline uint32_t ctz(uint64_t w) noexcept
+	{
+#if defined(_MSC_VER)
+		unsigned long idx;
+		_BitScanForward64(&idx, w);
+		return idx;
+#else
+		return (uint32_t)__builtin_ctzll(w);
+#endif
+	}
+
+	static inline uint32_t clz(uint64_t w) noexcept
+	{
+#if defined(_MSC_VER)
+		unsigned long idx;
+		_BitScanReverse64(&idx, w);
+		return 63 - idx;
+#else
+		return (uint32_t)__builtin_clzll(w);
+#endif
+	}
+
+	// mask of all bits in the word starting at base which are inside [from, to)
+	static inline uint64_t rangeMask(int64_t base, int64_t from, int64_t to) noexcept
+	{
+		int64_t lo = from - base;
+		int64_t hi = to - base;
+		if (lo < 0) lo = 0;
+		if (hi > 64) hi = 64;
+		if (lo >= hi) return 0;
+		uint64_t upper = hi == 64 ? ~0ull : ((1ull << hi) - 1);
+		uint64_t lower = (1ull << lo) - 1;
+		return upper & ~lower;
+	}
+
+	// reads 64 bits starting at an arbitrary (possibly negative) bit position
+	uint64_t read64(int64_t pos) const noexcept;
+	void maskTail() noexcept;
+
+public:
+	inline uint32_t ActionCount() const noexcept { return bitCount; }
+	inline uint32_t Count() const noexcept { return selectedCount; }
+	inline bool Empty() const noexcept { return selectedCount == 0; }
+	inline size_t ByteSize() const noexcept { return words.size() * sizeof(uint64_t); }
+
+	inline bool Test(uint32_t idx) const noexcept
+	{
+		if (idx >= bitCount) return false;
+		return (words[idx >> 6] >> (idx & 63)) & 1ull;
+	}
+
+	inline void Set(uint32_t idx, bool selected) noexcept
+	{
+		if (idx >= bitCount) return;
+		uint64_t& w = words[idx >> 6];
+		uint64_t bit = 1ull << (idx & 63);
+		bool wasSelected = w & bit;
+		if (wasSelected == selected) return;
+		if (selected) { w |= bit; selectedCount += 1; }
+		else { w &= ~bit; selectedCount -= 1; }
+	}
+
+	inline bool Toggle(uint32_t idx) noexcept
+	{
+		bool selected = !Test(idx);
+		Set(idx, selected);
+		return selected;
+	}
+
+	inline void Clear() noexcept
+	{
+		std::fill(words.begin(), words.end(), 0);
+		selectedCount = 0;
+	}
+
+	inline void SelectAll() noexcept { SetRange(0, bitCount, true); }
+
+	// resizes the bitmap to match the number of actions
+	// new bits are not selected
+	void Resize(uint32_t actionCount) noexcept;
+
+	// [first, last)
+	void SetRange(uint32_t first, uint32_t last, bool selected) noexcept;
+	void ToggleRange(uint32_t first, uint32_t last) noexcept;
+	uint32_t CountRange(uint32_t first, uint32_t last) const noexcept;
+
+	// inserts unselected bits at idx, bits behind idx are shifted up
+	void Insert(uint32_t idx, uint32_t count) noexcept;
+	// removes bits [idx, idx + count), bits behind are shifted down
+	void Erase(uint32_t idx, uint32_t count) noexcept;
+
+	// keeps only bits which are not set in other
+	void Subtract(const FunscriptSelection& other) noexcept;
+
+	// first selected index >= idx or None
+	uint32_t FindNext(uint32_t idx) const noexcept;
+	// last selected index < idx or None
+	uint32_t FindPrev(uint32_t idx) const noexcept;
+
+	inline uint32_t First() const noexcept { return FindNext(0); }
+	inline uint32_t Last() const noexcept { return FindPrev(bitCount); }
+
+	template<typename Fn>
+	inline void ForEach(Fn&& fn) const noexcept
+	{
+		for (uint32_t w = 0, size = words.size(); w < size; w += 1) {
+			uint64_t bits = words[w];
+			while (bits) {
+				uint32_t idx = (w << 6) + ctz(bits);
+				fn(idx);
+				bits &= bits - 1;
+			}
+		}
+	}
+
+	// calls fn with the selected actions in [first, last) in order
+	// the iterator only moves forward, indexing a chunked action array would walk its index for every action
+	template<typename Array, typename Fn>
+	inline void ForEachAction(Array& actions, uint32_t first, uint32_t last, Fn&& fn) const noexcept
+	{
+		uint32_t itIdx = FindNext(first);
+		if (itIdx >= last) return;
+		auto it = actions.begin() + itIdx;
+		for (uint32_t idx = itIdx; idx < last; idx = FindNext(idx + 1)) {
+			it += idx - itIdx;
+			itIdx = idx;
+			fn(*it);
+		}
+	}
+
+	template<typename Array, typename Fn>
+	inline void ForEachAction(Array& actions, Fn&& fn) const noexcept
+	{
+		ForEachAction(actions, 0, bitCount, std::forward<Fn>(fn));
+	}
+
+	inline bool operator==(const FunscriptSelection& other) const noexcept
+	{
+		return bitCount == other.bitCount && words == other.words;
+	}
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "FunscriptAction.h"
+
+#include <memory>
+#include <cstdint>
+
+struct ChapterState;
+
+// Immutable copy of a script's actions published by the main thread when a consumer asks for one.
+// Any thread can hold on to one, a newer snapshot replaces it for new readers
+// and the old one stays valid until its last holder lets go.
+struct FunscriptSnapshot
+{
+	// editVersion of the script at the time of publishing
+	uint64_t Version = 0;
+	FunscriptArray Actions;
+	// bookmarks and chapters of the project, shared by the snapshots of every script, can be null
+	std::shared_ptr<const ChapterState> Chapters;
+};
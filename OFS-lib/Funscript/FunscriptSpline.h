@@ -1,7 +1,9 @@
 #pragma once
 #include "OFS_Profiling.h"
 #include "FunscriptAction.h"
+#include "FunscriptColumns.h"
 #include <vector>
+#include <algorithm>
 #include "glm/gtx/spline.hpp"
 
 
@@ -9,6 +11,95 @@ class FunscriptSpline
 {
 	int32_t cacheIdx = 0;
 public:
+	enum class Interpolation : uint8_t {
+		Linear,
+		Spline
+	};
+
+	// Positions (0-100, clamped) at sorted times in one pass over the actions.
+	// Every segment is evaluated as a single cubic, the spline matches catmul_rom_spline_alt.
+	// Stateless so it can be used from worker threads and for several scripts at once.
+	static inline void SampleTimes(const FunscriptArray& actions, const float* times, uint32_t count, float* outPositions, Interpolation mode) noexcept
+	{
+		OFS_PROFILE(__FUNCTION__);
+		if (count == 0) return;
+		if (actions.size() < 2) {
+			std::fill(outPositions, outPositions + count, actions.empty() ? 0.f : (float)actions.front().pos);
+			return;
+		}
+
+		// clamp to the first action before the script starts
+		uint32_t i = 0;
+		const float firstTime = actions.front().atS;
+		for (; i < count && times[i] <= firstTime; ++i) {
+			outPositions[i] = actions.front().pos;
+		}
+
+		auto it = actions.begin();
+		const auto last = actions.end() - 1;
+		while (i < count) {
+			// find the segment [it, it+1) which contains times[i]
+			if (!(times[i] < (it + 1)->atS)) {
+				auto next = it + 2;
+				if (next <= last && times[i] < next->atS) {
+					++it;
+				}
+				else {
+					// compared as float seconds, an action key would round the time to a tick
+					it = std::upper_bound(it + 1, actions.end(), times[i],
+						[](float time, const FunscriptAction& action) noexcept { return time < (float)action.atS; }) - 1;
+				}
+			}
+			if (it == last) break;
+
+			auto& a = *it;
+			auto& b = *(it + 1);
+			const float endTime = b.atS;
+			uint32_t end = i + 1;
+			while (end < count && times[end] < endTime) ++end;
+
+			const float p1 = a.pos;
+			const float p2 = b.pos;
+			float c0 = p1, c1 = p2 - p1, c2 = 0.f, c3 = 0.f;
+			if (mode == Interpolation::Spline && a.pos != b.pos) {
+				const float p0 = it == actions.begin() ? p1 : (float)(it - 1)->pos;
+				const float p3 = it + 1 == last ? p2 : (float)(it + 2)->pos;
+				c1 = 0.5f * (p2 - p0);
+				c2 = 0.5f * (2.f * p0 - 5.f * p1 + 4.f * p2 - p3);
+				c3 = 0.5f * (-p0 + 3.f * p1 - 3.f * p2 + p3);
+			}
+			FunscriptColumns::EvaluateCubic(times + i, end - i, outPositions + i,
+				a.atS, 1.f / (b.atS - a.atS), c0, c1, c2, c3);
+			i = end;
+		}
+
+		// clamp to the last action after the script ends
+		for (; i < count; ++i) {
+			outPositions[i] = actions.back().pos;
+		}
+	}
+
+	// count positions every step seconds starting at startTime
+	static inline void SampleSteps(const FunscriptArray& actions, float startTime, float step, uint32_t count, float* outPositions, Interpolation mode) noexcept
+	{
+		constexpr uint32_t BlockSize = 256;
+		float times[BlockSize];
+		for (uint32_t offset = 0; offset < count; offset += BlockSize) {
+			uint32_t blockCount = std::min(BlockSize, count - offset);
+			for (uint32_t i = 0; i < blockCount; ++i) {
+				times[i] = (float)(startTime + (double)step * (offset + i));
+			}
+			SampleTimes(actions, times, blockCount, outPositions + offset, mode);
+		}
+	}
+
+	// count spline positions evenly spaced from fromTime to toTime, both included
+	static inline void SampleRange(const FunscriptArray& actions, float fromTime, float toTime, uint32_t count, float* outPositions) noexcept
+	{
+		float step = count > 1 ? (toTime - fromTime) / (count - 1) : 0.f;
+		SampleSteps(actions, fromTime, step, count, outPositions, Interpolation::Spline);
+	}
+
 	static inline float catmull_rom_spline(const FunscriptArray& actions, int32_t i, float time) noexcept
 	{
 		OFS_PROFILE(__FUNCTION__);
@@ -0,0 +1,194 @@
+#include "FunscriptStatistics.h"
+#include "OFS_Profiling.h"
+
+#include <cmath>
+
+void FunscriptStatistics::Summary::Add(const Summary& other) noexcept
+{
+	Segments += other.Segments;
+	Gaps += other.Gaps;
+	Duration += other.Duration;
+	GapTime += other.GapTime;
+	Distance += other.Distance;
+	GapDistance += other.GapDistance;
+	MaxSpeed = std::max(MaxSpeed, other.MaxSpeed);
+	TimeAboveLimit += other.TimeAboveLimit;
+	for (uint32_t i = 0; i < HistogramBuckets; ++i) {
+		SpeedHistogram[i] += other.SpeedHistogram[i];
+	}
+}
+
+FunscriptStatistics::Summary FunscriptStatistics::summarizeSegments(const FunscriptColumns& columns, uint32_t first, uint32_t last) const noexcept
+{
+	Summary sum;
+	if (last <= first) return sum;
+	// the peak speed and the distance come from the speed reduction,
+	// the rest depends on the duration of every single segment
+	auto speed = columns.Speed(FunscriptColumns::Range{ first, last + 1 });
+	sum.MaxSpeed = speed.MaxSpeed;
+	sum.Distance = speed.TotalDistance;
+
+	const float* times = columns.Times();
+	const float* positions = columns.Positions();
+	for (uint32_t i = first; i < last; ++i) {
+		float duration = times[i + 1] - times[i];
+		if (duration <= 0.f) continue;
+		sum.Segments += 1;
+		sum.Duration += duration;
+		if (duration >= settings.GapThreshold) {
+			sum.Gaps += 1;
+			sum.GapTime += duration;
+			sum.GapDistance += std::abs(positions[i + 1] - positions[i]);
+			continue;
+		}
+		float segmentSpeed = std::abs(positions[i + 1] - positions[i]) / duration;
+		uint32_t bucket = std::min((uint32_t)(segmentSpeed / HistogramBucketWidth), HistogramBuckets - 1);
+		sum.SpeedHistogram[bucket] += duration;
+		if (segmentSpeed > settings.SpeedLimit) sum.TimeAboveLimit += duration;
+	}
+	return sum;
+}
+
+void FunscriptStatistics::buildBlocks(const FunscriptColumns& columns, uint32_t first, uint32_t last, float firstStartTime, std::vector<Block>& outBlocks) const noexcept
+{
+	// spread the segments evenly so a small edit doesn't leave tiny blocks behind
+	uint32_t segments = last - first;
+	uint32_t blockCount = std::max<uint32_t>(1, (segments + BlockSize - 1) / BlockSize);
+	uint32_t perBlock = (segments + blockCount - 1) / blockCount;
+
+	const float* times = columns.Times();
+	float startTime = firstStartTime;
+	uint32_t blockFirst = first;
+	for (uint32_t i = first; i < last; ++i) {
+		// segments starting at the same time have to stay in one block
+		if (i - blockFirst >= perBlock && times[i - 1] < times[i]) {
+			outBlocks.emplace_back(Block{ startTime, summarizeSegments(columns, blockFirst, i) });
+			startTime = times[i];
+			blockFirst = i;
+		}
+	}
+	outBlocks.emplace_back(Block{ startTime, summarizeSegments(columns, blockFirst, last) });
+}
+
+void FunscriptStatistics::buildTree() noexcept
+{
+	leafOffset = 1;
+	while (leafOffset < blocks.size()) leafOffset <<= 1;
+	tree.assign(leafOffset * 2, Summary());
+	for (uint32_t i = 0; i < blocks.size(); ++i) {
+		tree[leafOffset + i] = blocks[i].Sum;
+	}
+	for (uint32_t i = leafOffset - 1; i > 0; --i) {
+		tree[i] = tree[i * 2];
+		tree[i].Add(tree[i * 2 + 1]);
+	}
+}
+
+void FunscriptStatistics::updateLeaf(uint32_t blockIdx) noexcept
+{
+	uint32_t node = leafOffset + blockIdx;
+	tree[node] = blocks[blockIdx].Sum;
+	for (node >>= 1; node > 0; node >>= 1) {
+		tree[node] = tree[node * 2];
+		tree[node].Add(tree[node * 2 + 1]);
+	}
+}
+
+void FunscriptStatistics::rebuild(const FunscriptColumns& columns) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	blocks.clear();
+	uint32_t segments = columns.Size() > 1 ? columns.Size() - 1 : 0;
+	buildBlocks(columns, 0, segments, std::numeric_limits<float>::lowest(), blocks);
+	buildTree();
+}
+
+uint32_t FunscriptStatistics::blockAt(float time) const noexcept
+{
+	auto it = std::upper_bound(blocks.begin(), blocks.end(), time,
+		[](float time, const Block& block) noexcept { return time < block.StartTime; });
+	return it == blocks.begin() ? 0 : (uint32_t)std::distance(blocks.begin(), it) - 1;
+}
+
+void FunscriptStatistics::update(const FunscriptColumns& columns, float fromTime, float toTime) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	if (columns.Size() < 2 || blocks.empty()) {
+		rebuild(columns);
+		return;
+	}
+	// the segment leading into the dirty interval changed as well
+	uint32_t firstDirty = columns.LowerBound(fromTime);
+	float startTime = firstDirty > 0 ? columns.Times()[firstDirty - 1] : std::numeric_limits<float>::lowest();
+
+	uint32_t firstBlock = blockAt(startTime);
+	uint32_t lastBlock = blockAt(toTime);
+	uint32_t segments = columns.Size() - 1;
+	uint32_t first = std::min(columns.LowerBound(blocks[firstBlock].StartTime), segments);
+	uint32_t last = lastBlock + 1 < blocks.size()
+		? std::min(columns.LowerBound(blocks[lastBlock + 1].StartTime), segments)
+		: segments;
+
+	std::vector<Block> replacement;
+	buildBlocks(columns, first, std::max(first, last), blocks[firstBlock].StartTime, replacement);
+
+	uint32_t replacedCount = lastBlock - firstBlock + 1;
+	if (replacement.size() == replacedCount) {
+		for (uint32_t i = 0; i < replacedCount; ++i) {
+			blocks[firstBlock + i] = replacement[i];
+			updateLeaf(firstBlock + i);
+		}
+	}
+	else {
+		auto insertAt = blocks.erase(blocks.begin() + firstBlock, blocks.begin() + lastBlock + 1);
+		blocks.insert(insertAt, replacement.begin(), replacement.end());
+		buildTree();
+	}
+}
+
+void FunscriptStatistics::Sync(const FunscriptColumns& columns, uint64_t actionsVersion) noexcept
+{
+	if (version == actionsVersion) return;
+	bool hasRange = dirtyFrom <= dirtyTo;
+	if (dirtyAll || !hasRange) {
+		rebuild(columns);
+	}
+	else {
+		update(columns, dirtyFrom, dirtyTo);
+	}
+	dirtyAll = false;
+	dirtyFrom = std::numeric_limits<float>::max();
+	dirtyTo = std::numeric_limits<float>::lowest();
+	version = actionsVersion;
+}
+
+FunscriptStatistics::Summary FunscriptStatistics::summarize(const FunscriptColumns& columns, float fromTime, float toTime) const noexcept
+{
+	if (columns.Size() < 2) return Summary();
+	uint32_t segments = columns.Size() - 1;
+	uint32_t first = std::min(columns.LowerBound(fromTime), segments);
+	uint32_t last = std::min(columns.LowerBound(toTime), segments);
+	return summarizeSegments(columns, first, last);
+}
+
+FunscriptStatistics::Summary FunscriptStatistics::Range(const FunscriptColumns& columns, float fromTime, float toTime) const noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	if (fromTime >= toTime || blocks.empty()) return Summary();
+	uint32_t firstBlock = blockAt(fromTime);
+	uint32_t lastBlock = blockAt(toTime);
+	if (firstBlock == lastBlock) return summarize(columns, fromTime, toTime);
+
+	// partial blocks on both ends, whole blocks in between from the tree
+	Summary sum = summarize(columns, fromTime, blocks[firstBlock + 1].StartTime);
+	uint32_t left = leafOffset + firstBlock + 1;
+	uint32_t right = leafOffset + lastBlock;
+	while (left < right) {
+		if (left & 1) sum.Add(tree[left++]);
+		if (right & 1) sum.Add(tree[--right]);
+		left >>= 1;
+		right >>= 1;
+	}
+	sum.Add(summarize(columns, blocks[lastBlock].StartTime, toTime));
+	return sum;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "FunscriptColumns.h"
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+// Whole-script aggregates over the segments between consecutive actions, computed from FunscriptColumns.
+// The segments are grouped into blocks of up to BlockSize by the time of their first action,
+// a segment tree over the block summaries answers the totals and time range queries.
+// Edits only recompute the blocks which overlap their dirty interval.
+class FunscriptStatistics
+{
+public:
+	static constexpr uint32_t BlockSize = 256;
+	static constexpr uint32_t HistogramBuckets = 12;
+	// units per second per bucket, the last bucket holds everything faster
+	static constexpr float HistogramBucketWidth = 50.f;
+
+	struct Settings {
+		// units per second a device can follow
+		float SpeedLimit = 400.f;
+		// segments at least this long in seconds are pauses and not counted as movement
+		float GapThreshold = 10.f;
+
+		inline bool operator==(const Settings& other) const noexcept { return SpeedLimit == other.SpeedLimit && GapThreshold == other.GapThreshold; }
+		inline bool operator!=(const Settings& other) const noexcept { return !(*this == other); }
+	};
+
+	struct Summary {
+		uint32_t Segments = 0;
+		uint32_t Gaps = 0;
+		float Duration = 0.f;
+		float GapTime = 0.f;
+		float Distance = 0.f;
+		// part of Distance covered during pauses
+		float GapDistance = 0.f;
+		float MaxSpeed = 0.f;
+		float TimeAboveLimit = 0.f;
+		// seconds spent moving in each speed bucket
+		std::array<float, HistogramBuckets> SpeedHistogram = {};
+
+		void Add(const Summary& other) noexcept;
+		inline float MovingTime() const noexcept { return Duration - GapTime; }
+		inline float MovingDistance() const noexcept { return Distance - GapDistance; }
+		// units per second while moving
+		inline float AverageSpeed() const noexcept { float moving = MovingTime(); return moving > 0.f ? MovingDistance() / moving : 0.f; }
+	};
+
+private:
+	struct Block {
+		// the block owns the segments starting at or after this time up to the next block
+		float StartTime;
+		Summary Sum;
+	};
+
+	std::vector<Block> blocks;
+	// implicit binary tree, leafs start at leafOffset
+	std::vector<Summary> tree;
+	uint32_t leafOffset = 0;
+	Settings settings;
+
+	uint64_t version = std::numeric_limits<uint64_t>::max();
+	float dirtyFrom = std::numeric_limits<float>::max();
+	float dirtyTo = std::numeric_limits<float>::lowest();
+	bool dirtyAll = true;
+
+	void buildBlocks(const FunscriptColumns& columns, uint32_t first, uint32_t last, float firstStartTime, std::vector<Block>& outBlocks) const noexcept;
+	void buildTree() noexcept;
+	void updateLeaf(uint32_t blockIdx) noexcept;
+	void rebuild(const FunscriptColumns& columns) noexcept;
+	void update(const FunscriptColumns& columns, float fromTime, float toTime) noexcept;
+	uint32_t blockAt(float time) const noexcept;
+	// the segments starting at the actions [first, last)
+	Summary summarizeSegments(const FunscriptColumns& columns, uint32_t first, uint32_t last) const noexcept;
+	Summary summarize(const FunscriptColumns& columns, float fromTime, float toTime) const noexcept;
+
+public:
+	inline void Invalidate() noexcept { dirtyAll = true; }
+	inline void Invalidate(float fromTime, float toTime) noexcept
+	{
+		if (fromTime > toTime) std::swap(fromTime, toTime);
+		dirtyFrom = std::min(dirtyFrom, fromTime);
+		dirtyTo = std::max(dirtyTo, toTime);
+	}
+	inline void SetSettings(const Settings& newSettings) noexcept
+	{
+		if (newSettings != settings) {
+			settings = newSettings;
+			dirtyAll = true;
+			version = std::numeric_limits<uint64_t>::max();
+		}
+	}
+	inline const Settings& GetSettings() const noexcept { return settings; }
+
+	// applies everything invalidated since the last sync
+	void Sync(const FunscriptColumns& columns, uint64_t actionsVersion) noexcept;
+
+	inline const Summary& Total() const noexcept { static Summary empty; return tree.empty() ? empty : tree[1]; }
+	// segments starting in [fromTime, toTime), the columns have to be the ones of the last sync
+	Summary Range(const FunscriptColumns& columns, float fromTime, float toTime) const noexcept;
+};
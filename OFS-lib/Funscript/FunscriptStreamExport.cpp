@@ -0,0 +1,75 @@
+#include "FunscriptStreamExport.h"
+#include "OFS_Util.h"
+#include "OFS_Profiling.h"
+
+#include <cmath>
+#include <cstring>
+
+static_assert(sizeof(FunscriptStreamExport::Header) == 32, "the header is part of the file format");
+
+template<typename T>
+inline static void interleave(const float* positions, uint32_t count, float scale, uint32_t axisIdx, uint32_t axisCount, T* outFrames) noexcept
+{
+	// positions are already clamped to 0-100
+	for (uint32_t i = 0; i < count; ++i) {
+		outFrames[i * axisCount + axisIdx] = (T)(positions[i] * scale + 0.5f);
+	}
+}
+
+bool FunscriptStreamExport::Write(const std::string& path, const std::vector<Axis>& axes, float duration, const Settings& settings) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	if (axes.empty() || axes.size() > UINT16_MAX || settings.SampleRate == 0 || duration < 0.f) return false;
+
+	Header header;
+	header.SampleRate = settings.SampleRate;
+	header.AxisCount = (uint16_t)axes.size();
+	header.Format = settings.Format;
+	header.Mode = settings.Mode;
+	header.FrameCount = (uint64_t)std::ceil((double)duration * settings.SampleRate) + 1;
+
+	std::vector<uint8_t> names;
+	for (auto& axis : axes) {
+		uint16_t length = (uint16_t)std::min<size_t>(axis.Name.size(), UINT16_MAX);
+		auto offset = names.size();
+		names.resize(offset + sizeof(length) + length);
+		std::memcpy(names.data() + offset, &length, sizeof(length));
+		std::memcpy(names.data() + offset + sizeof(length), axis.Name.data(), length);
+	}
+	header.DataOffset = sizeof(Header) + names.size();
+
+	auto file = Util::OpenFile(path.c_str(), "wb", path.size());
+	if (!file) {
+		LOGF_ERROR("Failed to open \"%s\" for writing.", path.c_str());
+		return false;
+	}
+	bool succ = SDL_RWwrite(file, &header, sizeof(Header), 1) == 1
+		&& SDL_RWwrite(file, names.data(), 1, names.size()) == names.size();
+
+	constexpr uint32_t ChunkFrames = 4096;
+	uint32_t sampleSize = settings.Format == SampleFormat::U16 ? sizeof(uint16_t) : sizeof(uint8_t);
+	float scale = settings.Format == SampleFormat::U16 ? 65535.f / 100.f : 255.f / 100.f;
+	std::vector<float> positions(ChunkFrames);
+	std::vector<uint8_t> chunk((size_t)ChunkFrames * axes.size() * sampleSize);
+	double step = 1.0 / settings.SampleRate;
+
+	for (uint64_t frame = 0; succ && frame < header.FrameCount; frame += ChunkFrames) {
+		uint32_t frameCount = (uint32_t)std::min<uint64_t>(ChunkFrames, header.FrameCount - frame);
+		float startTime = (float)(frame * step);
+		for (uint32_t axisIdx = 0; axisIdx < axes.size(); ++axisIdx) {
+			FunscriptSpline::SampleSteps(*axes[axisIdx].Actions, startTime, (float)step, frameCount, positions.data(), settings.Mode);
+			if (settings.Format == SampleFormat::U16) {
+				interleave(positions.data(), frameCount, scale, axisIdx, header.AxisCount, (uint16_t*)chunk.data());
+			}
+			else {
+				interleave(positions.data(), frameCount, scale, axisIdx, header.AxisCount, chunk.data());
+			}
+		}
+		size_t chunkSize = (size_t)frameCount * axes.size() * sampleSize;
+		succ = SDL_RWwrite(file, chunk.data(), 1, chunkSize) == chunkSize;
+	}
+	SDL_RWclose(file);
+
+	if (!succ) LOGF_ERROR("Failed to write \"%s\".", path.c_str());
+	return succ;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "FunscriptAction.h"
+#include "FunscriptSpline.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Fixed-rate sample stream of one or more axes for players which can't afford interpolating at runtime.
+// Layout (little endian):
+//   Header
+//   AxisCount names, each a uint16 byte length followed by utf-8
+//   FrameCount frames starting at DataOffset, a frame holds one sample per axis in axis order
+// Frame i is at i / SampleRate seconds, so a player only has to index the array.
+class FunscriptStreamExport
+{
+public:
+	enum class SampleFormat : uint8_t {
+		U8,  // 0-255
+		U16, // 0-65535
+	};
+
+	struct Settings {
+		uint32_t SampleRate = 1000;
+		SampleFormat Format = SampleFormat::U8;
+		FunscriptSpline::Interpolation Mode = FunscriptSpline::Interpolation::Linear;
+	};
+
+	struct Axis {
+		std::string Name;
+		const FunscriptArray* Actions = nullptr;
+	};
+
+	struct Header {
+		char Magic[4] = { 'O', 'F', 'S', 'R' };
+		uint32_t Version = 1;
+		uint32_t SampleRate = 0;
+		uint16_t AxisCount = 0;
+		SampleFormat Format = SampleFormat::U8;
+		FunscriptSpline::Interpolation Mode = FunscriptSpline::Interpolation::Linear;
+		uint64_t FrameCount = 0;
+		uint64_t DataOffset = 0;
+	};
+
+	// samples every axis from 0 to duration seconds (both included) and writes the stream in chunks
+	static bool Write(const std::string& path, const std::vector<Axis>& axes, float duration, const Settings& settings) noexcept;
+};
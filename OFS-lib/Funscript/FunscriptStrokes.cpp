@@ -0,0 +1,103 @@
+#include "FunscriptStrokes.h"
+#include "OFS_Profiling.h"
+
+inline static int32_t direction(const FunscriptAction& from, const FunscriptAction& to) noexcept
+{
+	return (to.pos > from.pos) - (to.pos < from.pos);
+}
+
+// float seconds lookups, FunscriptAction(time, 0) would round the time to a tick in fixed timebase builds
+template<typename Container>
+inline static auto lowerBound(const Container& actions, float time) noexcept
+{
+	return std::lower_bound(actions.begin(), actions.end(), time,
+		[](const FunscriptAction& action, float time) noexcept { return (float)action.atS < time; });
+}
+
+template<typename Container>
+inline static auto upperBound(const Container& actions, float time) noexcept
+{
+	return std::upper_bound(actions.begin(), actions.end(), time,
+		[](float time, const FunscriptAction& action) noexcept { return time < (float)action.atS; });
+}
+
+// appends the turning points of actions [first, last) which is part of the whole array
+static void collectTurningPoints(const FunscriptArray& actions, size_t first, size_t last, std::vector<FunscriptAction>& out) noexcept
+{
+	if (first >= last) return;
+	auto it = actions.begin() + first;
+	int32_t prevDirection = first > 0 ? direction(*(it - 1), *it) : 0;
+	for (size_t i = first; i < last; ++i, ++it) {
+		if (i == 0 || i + 1 == actions.size()) {
+			out.emplace_back(*it);
+			if (i + 1 < actions.size()) prevDirection = direction(*it, *(it + 1));
+			continue;
+		}
+		int32_t nextDirection = direction(*it, *(it + 1));
+		if (nextDirection != prevDirection) {
+			out.emplace_back(*it);
+		}
+		prevDirection = nextDirection;
+	}
+}
+
+void FunscriptStrokeIndex::rebuild(const FunscriptArray& actions) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	turningPoints.clear();
+	collectTurningPoints(actions, 0, actions.size(), turningPoints);
+}
+
+void FunscriptStrokeIndex::update(const FunscriptArray& actions, float fromTime, float toTime) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	if (actions.empty()) {
+		turningPoints.clear();
+		return;
+	}
+	// the turning state of an action depends on its neighbours
+	// so one action on each side of the dirty interval gets re-derived as well
+	size_t first = std::distance(actions.begin(), lowerBound(actions, fromTime));
+	size_t last = std::distance(actions.begin(), upperBound(actions, toTime));
+	if (first > 0) --first;
+	if (last < actions.size()) ++last;
+
+	float removeFrom = std::min<float>(fromTime, actions[first].atS);
+	float removeTo = std::max<float>(toTime, actions[last - 1].atS);
+	// actions sharing the time of the outer neighbours belong to the window too
+	first = std::distance(actions.begin(), lowerBound(actions, removeFrom));
+	last = std::distance(actions.begin(), upperBound(actions, removeTo));
+	auto removeBegin = lowerBound(turningPoints, removeFrom);
+	auto removeEnd = upperBound(turningPoints, removeTo);
+
+	std::vector<FunscriptAction> replacement;
+	collectTurningPoints(actions, first, last, replacement);
+
+	auto insertAt = turningPoints.erase(removeBegin, removeEnd);
+	turningPoints.insert(insertAt, replacement.begin(), replacement.end());
+}
+
+void FunscriptStrokeIndex::Sync(const FunscriptArray& actions, uint64_t actionsVersion) noexcept
+{
+	if (version == actionsVersion) return;
+	bool hasRange = dirtyFrom <= dirtyTo;
+	if (dirtyAll || !hasRange) {
+		rebuild(actions);
+	}
+	else {
+		update(actions, dirtyFrom, dirtyTo);
+	}
+	dirtyAll = false;
+	dirtyFrom = std::numeric_limits<float>::max();
+	dirtyTo = std::numeric_limits<float>::lowest();
+	version = actionsVersion;
+}
+
+uint32_t FunscriptStrokeIndex::StrokeAt(float time) const noexcept
+{
+	if (Count() == 0) return None;
+	// first turning point at or after time is the end of the stroke
+	auto it = lowerBound(turningPoints, time);
+	if (it == turningPoints.begin() || it == turningPoints.end()) return None;
+	return (uint32_t)std::distance(turningPoints.begin(), it) - 1;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "FunscriptAction.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+
+// Turning points of a script: peaks, troughs, both ends of flat runs and the first and last action.
+// Between two consecutive turning points the position only moves in one direction, that's a stroke.
+// Edits only re-derive the turning points around their dirty interval.
+class FunscriptStrokeIndex
+{
+public:
+	static constexpr uint32_t None = std::numeric_limits<uint32_t>::max();
+
+	struct Stroke {
+		FunscriptAction From;
+		FunscriptAction To;
+
+		inline float Duration() const noexcept { return To.atS - From.atS; }
+		inline int32_t Min() const noexcept { return std::min<int32_t>(From.pos, To.pos); }
+		inline int32_t Max() const noexcept { return std::max<int32_t>(From.pos, To.pos); }
+		inline int32_t Distance() const noexcept { return std::abs(To.pos - From.pos); }
+		// units per second
+		inline float Speed() const noexcept { float duration = Duration(); return duration > 0.f ? Distance() / duration : 0.f; }
+		inline bool IsUp() const noexcept { return To.pos > From.pos; }
+	};
+
+private:
+	// sorted by time
+	std::vector<FunscriptAction> turningPoints;
+
+	uint64_t version = std::numeric_limits<uint64_t>::max();
+	float dirtyFrom = std::numeric_limits<float>::max();
+	float dirtyTo = std::numeric_limits<float>::lowest();
+	bool dirtyAll = true;
+
+	void rebuild(const FunscriptArray& actions) noexcept;
+	void update(const FunscriptArray& actions, float fromTime, float toTime) noexcept;
+
+public:
+	inline void Invalidate() noexcept { dirtyAll = true; }
+	inline void Invalidate(float fromTime, float toTime) noexcept
+	{
+		if (fromTime > toTime) std::swap(fromTime, toTime);
+		dirtyFrom = std::min(dirtyFrom, fromTime);
+		dirtyTo = std::max(dirtyTo, toTime);
+	}
+	// applies everything invalidated since the last sync
+	void Sync(const FunscriptArray& actions, uint64_t actionsVersion) noexcept;
+
+	inline uint32_t Count() const noexcept { return turningPoints.size() < 2 ? 0 : (uint32_t)turningPoints.size() - 1; }
+	inline Stroke operator[](uint32_t idx) const noexcept { return Stroke{ turningPoints[idx], turningPoints[idx + 1] }; }
+	inline const std::vector<FunscriptAction>& TurningPoints() const noexcept { return turningPoints; }
+
+	// the stroke with From.atS < time <= To.atS, None outside of the script
+	uint32_t StrokeAt(float time) const noexcept;
+};
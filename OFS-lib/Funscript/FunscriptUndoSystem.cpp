@@ -1,19 +1,126 @@
 #include "FunscriptUndoSystem.h"
 
+#include <cstring>
+
+size_t ScriptStateStack::totalByteSize = 0;
+
+inline static bool sameAction(const FunscriptAction& a, const FunscriptAction& b) noexcept
+{
+	// the tag has to survive undo as well
+	return std::memcmp(&a, &b, sizeof(FunscriptAction)) == 0;
+}
+
+void ScriptStateStack::addBytes(int64_t bytes) noexcept
+{
+	byteSize += bytes;
+	totalByteSize += bytes;
+}
+
+void ScriptStateStack::Push(int32_t type, const Funscript::FunscriptData& data) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	auto& actions = data.Actions;
+	if (!states.empty()) {
+		// turn the old top into the difference to the new state
+		auto& top = states.back();
+		size_t oldSize = top.Actions.size();
+		size_t newSize = actions.size();
+		size_t prefix = 0;
+		auto newIt = actions.begin();
+		while (prefix < oldSize && prefix < newSize && sameAction(top.Actions[prefix], *newIt)) {
+			++prefix;
+			++newIt;
+		}
+		size_t suffix = 0;
+		newIt = actions.end();
+		while (suffix < oldSize - prefix && suffix < newSize - prefix
+			&& sameAction(top.Actions[oldSize - 1 - suffix], *--newIt)) ++suffix;
+
+		top.ReplaceStart = prefix;
+		top.ReplaceCount = newSize - prefix - suffix;
+		if (prefix > 0 || suffix > 0) {
+			int64_t bytesBefore = top.ByteSize();
+			top.Actions = std::vector<FunscriptAction>(top.Actions.begin() + prefix, top.Actions.end() - suffix);
+			addBytes((int64_t)top.ByteSize() - bytesBefore);
+		}
+	}
+
+	auto& state = states.emplace_back(type);
+	state.Actions.reserve(actions.size());
+	for (auto action : actions) state.Actions.emplace_back(action);
+	data.Selection.ForEach([&](uint32_t idx) noexcept {
+		if (!state.SelectionRuns.empty() && state.SelectionRuns.back() == idx) {
+			state.SelectionRuns.back() = idx + 1;
+		}
+		else {
+			state.SelectionRuns.emplace_back(idx);
+			state.SelectionRuns.emplace_back(idx + 1);
+		}
+	});
+	state.SelectionRuns.shrink_to_fit();
+	addBytes(state.ByteSize());
+}
+
+void ScriptStateStack::Pop(Funscript::FunscriptData& outData) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	FUN_ASSERT(!states.empty(), "nothing to pop");
+	auto state = std::move(states.back());
+	states.pop_back();
+	addBytes(-(int64_t)state.ByteSize());
+
+	if (!states.empty()) {
+		// the new top has to be complete again
+		auto& top = states.back();
+		int64_t bytesBefore = top.ByteSize();
+		std::vector<FunscriptAction> actions;
+		actions.reserve(state.Actions.size() - top.ReplaceCount + top.Actions.size());
+		actions.insert(actions.end(), state.Actions.begin(), state.Actions.begin() + top.ReplaceStart);
+		actions.insert(actions.end(), top.Actions.begin(), top.Actions.end());
+		actions.insert(actions.end(), state.Actions.begin() + top.ReplaceStart + top.ReplaceCount, state.Actions.end());
+		top.Actions = std::move(actions);
+		top.ReplaceStart = 0;
+		top.ReplaceCount = 0;
+		addBytes((int64_t)top.ByteSize() - bytesBefore);
+	}
+
+	outData.Actions.clear();
+	outData.Actions.reserve(state.Actions.size());
+	for (auto action : state.Actions) outData.Actions.emplace_back_unsorted(action);
+	outData.Selection.Clear();
+	outData.Selection.Resize(state.Actions.size());
+	for (size_t i = 0; i + 1 < state.SelectionRuns.size(); i += 2) {
+		outData.Selection.SetRange(state.SelectionRuns[i], state.SelectionRuns[i + 1], true);
+	}
+}
+
+void ScriptStateStack::DropOldest() noexcept
+{
+	if (states.empty()) return;
+	addBytes(-(int64_t)states.front().ByteSize());
+	states.pop_front();
+}
+
+void ScriptStateStack::Clear() noexcept
+{
+	addBytes(-(int64_t)byteSize);
+	states.clear();
+}
+
 void FunscriptUndoSystem::ClearRedo() noexcept
 {
-	RedoStack.clear();
+	RedoStack.Clear();
 }
 
 void FunscriptUndoSystem::SnapshotRedo(int32_t type) noexcept
 {
-	RedoStack.emplace_back(std::move(ScriptState(type, script->Data())));
+	RedoStack.Push(type, script->Data());
 }
 
 void FunscriptUndoSystem::Snapshot(int32_t type, bool clearRedo) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	UndoStack.emplace_back(std::move(ScriptState(type, script->Data())));
+	UndoStack.Push(type, script->Data());
 
 	// redo gets cleared after every snapshot
 	if (clearRedo)
@@ -22,20 +129,22 @@ void FunscriptUndoSystem::Snapshot(int32_t type, bool clearRedo) noexcept
 
 bool FunscriptUndoSystem::Undo() noexcept
 {
-	if (UndoStack.empty()) return false;
+	if (UndoStack.Empty()) return false;
 	OFS_PROFILE(__FUNCTION__);
-	SnapshotRedo(UndoStack.back().type); // copy data to redo
-	script->Rollback(std::move(UndoStack.back().Data())); // move data
-	UndoStack.pop_back(); // pop of the stack
+	SnapshotRedo(UndoStack.TopType()); // current data to redo
+	Funscript::FunscriptData data;
+	UndoStack.Pop(data);
+	script->Rollback(std::move(data));
 	return true;
 }
 
 bool FunscriptUndoSystem::Redo() noexcept
 {
-	if (RedoStack.empty()) return false;
+	if (RedoStack.Empty()) return false;
 	OFS_PROFILE(__FUNCTION__);
-	Snapshot(RedoStack.back().type, false); // copy data to undo
-	script->Rollback(std::move(RedoStack.back().Data())); // move data
-	RedoStack.pop_back(); // pop of the stack
+	Snapshot(RedoStack.TopType(), false); // current data to undo
+	Funscript::FunscriptData data;
+	RedoStack.Pop(data);
+	script->Rollback(std::move(data));
 	return true;
-}
\ No newline at end of file
+}
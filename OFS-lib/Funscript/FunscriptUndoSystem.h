@@ -2,19 +2,55 @@
 
 #include "Funscript.h"
 #include <vector>
+#include <deque>
 
 class ScriptState {
-private:
-	Funscript::FunscriptData data;
 public:
-	inline Funscript::FunscriptData& Data() { return data; }
 	int32_t type;
+	// the newest state of a stack holds every action,
+	// older states hold the actions which replace [ReplaceStart, ReplaceStart + ReplaceCount) of the next newer state
+	uint32_t ReplaceStart = 0;
+	uint32_t ReplaceCount = 0;
+	std::vector<FunscriptAction> Actions;
+	// [first, last) pairs of selected indices
+	std::vector<uint32_t> SelectionRuns;
+
 	const char* Description() const noexcept;
+	inline size_t ByteSize() const noexcept
+	{
+		return sizeof(ScriptState) + Actions.capacity() * sizeof(FunscriptAction) + SelectionRuns.capacity() * sizeof(uint32_t);
+	}
+
+	ScriptState(int32_t type) noexcept
+		: type(type) {}
+};
+
+// Undo states stored as deltas against their newer neighbour.
+// Only the top is complete, so the oldest states can be dropped without touching the others.
+class ScriptStateStack
+{
+	std::deque<ScriptState> states;
+	size_t byteSize = 0;
+	// every stack of every script
+	static size_t totalByteSize;
+
+	void addBytes(int64_t bytes) noexcept;
+public:
+	ScriptStateStack() noexcept {}
+	ScriptStateStack(const ScriptStateStack&) = delete;
+	ScriptStateStack& operator=(const ScriptStateStack&) = delete;
+	~ScriptStateStack() noexcept { Clear(); }
 
-	ScriptState() noexcept 
-		: type(-1) {}
-	ScriptState(int32_t type, const Funscript::FunscriptData& data) noexcept
-		: type(type), data(data) {}
+	void Push(int32_t type, const Funscript::FunscriptData& data) noexcept;
+	// rebuilds the top state into outData and removes it
+	void Pop(Funscript::FunscriptData& outData) noexcept;
+	void DropOldest() noexcept;
+	void Clear() noexcept;
+
+	inline bool Empty() const noexcept { return states.empty(); }
+	inline int32_t TopType() const noexcept { return states.back().type; }
+	inline size_t ByteSize() const noexcept { return byteSize; }
+	static inline size_t TotalByteSize() noexcept { return totalByteSize; }
 };
 
 class FunscriptUndoSystem
@@ -23,22 +59,24 @@ class FunscriptUndoSystem
 
 	Funscript* script = nullptr;
 	void SnapshotRedo(int32_t type) noexcept;
-	
-	std::vector<ScriptState> UndoStack;
-	std::vector<ScriptState> RedoStack;
+
+	ScriptStateStack UndoStack;
+	ScriptStateStack RedoStack;
 
 	void Snapshot(int32_t type, bool clearRedo = true) noexcept;
 	bool Undo() noexcept;
 	bool Redo() noexcept;
 	void ClearRedo() noexcept;
+	// the UndoSystem evicts the same step from every script of a context
+	inline void DropOldestUndo() noexcept { UndoStack.DropOldest(); }
 public:
 	FunscriptUndoSystem(Funscript* script) : script(script) {
 		FUN_ASSERT(script != nullptr, "no script");
-		UndoStack.reserve(1000);
-		RedoStack.reserve(100);
 	}
 
-	inline bool MatchUndoTop(int32_t type) const noexcept { return !UndoEmpty() && UndoStack.back().type == type; }
-	inline bool UndoEmpty() const noexcept { return UndoStack.empty(); }
-	inline bool RedoEmpty() const noexcept { return RedoStack.empty(); }
+	inline bool MatchUndoTop(int32_t type) const noexcept { return !UndoEmpty() && UndoStack.TopType() == type; }
+	inline bool UndoEmpty() const noexcept { return UndoStack.Empty(); }
+	inline bool RedoEmpty() const noexcept { return RedoStack.Empty(); }
+	// bytes used by the undo and redo states of every script
+	static inline size_t MemoryUsage() noexcept { return ScriptStateStack::TotalByteSize(); }
 };
@@ -0,0 +1,63 @@
+#include "FunscriptWriter.h"
+#include "OFS_Util.h"
+#include "OFS_Profiling.h"
+
+#include <charconv>
+
+void FunscriptWriter::writeInt(int64_t value) noexcept
+{
+	char digits[24];
+	auto result = std::to_chars(digits, digits + sizeof(digits), value);
+	buffer.append(digits, result.ptr - digits);
+}
+
+void FunscriptWriter::WriteJson(const nlohmann::json& value) noexcept
+{
+	nlohmann::detail::serializer<nlohmann::json> serializer(
+		nlohmann::detail::output_adapter<char>(buffer), ' ', nlohmann::json::error_handler_t::replace);
+	serializer.dump(value, false, false, 0);
+}
+
+void FunscriptWriter::WriteActions(const FunscriptArray& actions) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	// {"at":<ms>,"pos":<pos>} is at most ~35 bytes
+	buffer.reserve(buffer.size() + actions.size() * 35 + 2);
+	buffer.push_back('[');
+
+	int64_t lastTimestamp = -1;
+	bool first = true;
+	for (auto action : actions) {
+		// a little validation just in case
+		if (action.atS < 0.f)
+			continue;
+
+		int64_t ts = FunscriptAction::TimeToMilliseconds(action.atS);
+		// make sure timestamps are unique
+		if (ts == lastTimestamp) {
+			LOG_WARN("Action was ignored since it had the same millisecond timestamp as the previous one.");
+			continue;
+		}
+		lastTimestamp = ts;
+
+		if (!first) buffer.push_back(',');
+		first = false;
+		WriteRaw("{\"at\":");
+		writeInt(ts);
+		WriteRaw(",\"pos\":");
+		writeInt(Util::Clamp<int32_t>(action.pos, 0, 100));
+		buffer.push_back('}');
+	}
+	buffer.push_back(']');
+}
+
+void FunscriptWriter::WriteFunscript(const FunscriptArray& actions, const nlohmann::json& metadata) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	// keys in the same order nlohmann sorts them
+	WriteRaw("{\"actions\":");
+	WriteActions(actions);
+	WriteRaw(",\"inverted\":false,\"metadata\":");
+	WriteJson(metadata);
+	WriteRaw(",\"range\":100,\"version\":\"1.0\"}");
+}
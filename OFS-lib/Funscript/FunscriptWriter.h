@@ -0,0 +1,34 @@
+#pragma once
+
+#include "nlohmann/json.hpp"
+#include "FunscriptAction.h"
+
+#include <string>
+#include <cstdint>
+
+// Streams funscript json into a reusable buffer.
+// The text is identical to dumping the nlohmann document Funscript::Serialize builds,
+// but the actions get formatted in place instead of allocating a json object each.
+class FunscriptWriter
+{
+private:
+	std::string buffer;
+
+	void writeInt(int64_t value) noexcept;
+
+public:
+	inline void Clear() noexcept { buffer.clear(); }
+	inline const std::string& Text() const noexcept { return buffer; }
+	inline std::string& Text() noexcept { return buffer; }
+
+	inline void WriteRaw(const char* text, size_t size) noexcept { buffer.append(text, size); }
+	template<size_t N>
+	inline void WriteRaw(const char (&text)[N]) noexcept { buffer.append(text, N - 1); }
+
+	// dumps a (small) json value
+	void WriteJson(const nlohmann::json& value) noexcept;
+	// writes the action array, negative times are skipped and duplicate millisecond timestamps are dropped
+	void WriteActions(const FunscriptArray& actions) noexcept;
+	// writes a whole funscript object, metadata has to be a json object
+	void WriteFunscript(const FunscriptArray& actions, const nlohmann::json& metadata) noexcept;
+};
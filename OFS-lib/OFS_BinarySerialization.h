@@ -15,6 +15,7 @@
 
 
 #include "OFS_VectorSet.h"
+#include "OFS_ChunkedVectorSet.h"
 
 namespace bitsery {
     namespace traits {
@@ -28,6 +29,12 @@ namespace bitsery {
         struct BufferAdapterTraits<vector_set<T, Allocator>>
         : public StdContainerForBufferAdapter<vector_set<T, Allocator>> {
         };
+
+        // chunked_vector_set
+        template<typename T, typename Comparison, size_t ChunkBytes>
+        struct ContainerTraits<chunked_vector_set<T, Comparison, ChunkBytes>>
+        : public StdContainer<chunked_vector_set<T, Comparison, ChunkBytes>, true, false> {
+        };
     }
 }
 
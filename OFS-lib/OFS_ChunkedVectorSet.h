@@ -0,0 +1,606 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "OFS_VectorSet.h"
+
+// Drop-in alternative to vector_set for very large sets.
+// Elements are stored in fixed size cache line aligned chunks,
+// so an insert or erase only moves the elements of a single chunk.
+// A fenwick tree over the chunk sizes maps indices to chunks in O(log n),
+// which keeps random access iterators and operator[] working like on a vector.
+// operator[] walks the tree on every call, sequential passes should use iterators.
+template<typename T, typename Comparison = DefaultComparison<T>, size_t ChunkBytes = 2048>
+class chunked_vector_set {
+public:
+    static constexpr size_t CacheLineSize = 64;
+    static constexpr uint32_t ChunkCapacity = ChunkBytes / sizeof(T);
+    // bulk rebuilds leave some room in every chunk for following inserts
+    static constexpr uint32_t ChunkFill = ChunkCapacity - ChunkCapacity / 4;
+
+    static_assert(ChunkBytes % CacheLineSize == 0, "chunks have to be a multiple of the cache line size");
+    static_assert(ChunkCapacity >= 8, "chunks are too small");
+    static_assert(std::is_trivially_copyable<T>::value, "elements are moved with memmove");
+
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+
+private:
+    struct alignas(CacheLineSize) Chunk {
+        T items[ChunkCapacity];
+    };
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::vector<uint32_t> counts;
+    // fenwick tree over counts, 1 based
+    std::vector<size_t> tree;
+    size_t count = 0;
+
+    static inline size_t lowBit(size_t i) noexcept { return i & (~i + 1); }
+
+    inline void rebuildIndex() noexcept { rebuildIndexFrom(0); }
+
+    // recomputes the nodes of chunk and everything behind it, the nodes in front
+    // only cover chunks in front of it and stay valid when chunks are inserted or removed there
+    inline void rebuildIndexFrom(size_t chunk) noexcept
+    {
+        size_t size = chunks.size();
+        tree.resize(size + 1);
+        for (size_t i = chunk + 1; i <= size; ++i) {
+            // a node is its own count plus the nodes of its children i - 1, i - 2, i - 4, ...
+            size_t sum = counts[i - 1];
+            for (size_t step = 1, low = lowBit(i); step < low; step <<= 1) sum += tree[i - step];
+            tree[i] = sum;
+        }
+    }
+
+    inline void addToIndex(size_t chunk, ptrdiff_t delta) noexcept
+    {
+        for (size_t i = chunk + 1, size = tree.size(); i < size; i += lowBit(i)) {
+            tree[i] += delta;
+        }
+    }
+
+    // number of elements in front of the chunk
+    inline size_t chunkBase(size_t chunk) const noexcept
+    {
+        size_t sum = 0;
+        for (size_t i = chunk; i > 0; i -= lowBit(i)) sum += tree[i];
+        return sum;
+    }
+
+    // returns the chunk containing idx and turns idx into the offset inside of it
+    inline size_t locate(size_t& idx) const noexcept
+    {
+        size_t pos = 0;
+        size_t step = 1;
+        while (step * 2 < tree.size()) step *= 2;
+        for (; step > 0; step >>= 1) {
+            if (pos + step < tree.size() && tree[pos + step] <= idx) {
+                pos += step;
+                idx -= tree[pos];
+            }
+        }
+        return pos;
+    }
+
+    inline const T& lastOf(size_t chunk) const noexcept { return chunks[chunk]->items[counts[chunk] - 1]; }
+
+    inline void insertChunk(size_t at) noexcept
+    {
+        chunks.insert(chunks.begin() + at, std::make_unique<Chunk>());
+        counts.insert(counts.begin() + at, 0);
+    }
+
+    inline void removeChunk(size_t at) noexcept
+    {
+        chunks.erase(chunks.begin() + at);
+        counts.erase(counts.begin() + at);
+    }
+
+    // moves the upper half of a full chunk into a new chunk behind it
+    inline void split(size_t chunk) noexcept
+    {
+        insertChunk(chunk + 1);
+        uint32_t keep = counts[chunk] / 2;
+        uint32_t move = counts[chunk] - keep;
+        std::memcpy(chunks[chunk + 1]->items, chunks[chunk]->items + keep, move * sizeof(T));
+        counts[chunk] = keep;
+        counts[chunk + 1] = move;
+        rebuildIndexFrom(chunk);
+    }
+
+    // merges a chunk with its successor when both are mostly empty
+    inline bool coalesce(size_t chunk) noexcept
+    {
+        if (chunk + 1 >= chunks.size()) return false;
+        if (counts[chunk] + counts[chunk + 1] > ChunkCapacity / 2) return false;
+        std::memcpy(chunks[chunk]->items + counts[chunk], chunks[chunk + 1]->items, counts[chunk + 1] * sizeof(T));
+        counts[chunk] += counts[chunk + 1];
+        removeChunk(chunk + 1);
+        return true;
+    }
+
+    template<typename InputIt>
+    inline void rebuildFrom(InputIt first, InputIt last) noexcept
+    {
+        chunks.clear();
+        counts.clear();
+        count = 0;
+        for (; first != last; ++first) {
+            if (chunks.empty() || counts.back() == ChunkFill) insertChunk(chunks.size());
+            chunks.back()->items[counts.back()++] = *first;
+            count += 1;
+        }
+        rebuildIndex();
+    }
+
+    static inline bool equivalent(const T& a, const T& b) noexcept
+    {
+        Comparison comp;
+        return !comp(a, b) && !comp(b, a);
+    }
+
+public:
+    template<bool Const>
+    class basic_iterator {
+        using Owner = std::conditional_t<Const, const chunked_vector_set, chunked_vector_set>;
+        Owner* owner = nullptr;
+        size_t chunk = 0;
+        uint32_t offset = 0;
+        size_t index = 0;
+
+        friend class chunked_vector_set;
+        template<bool> friend class basic_iterator;
+
+        basic_iterator(Owner* owner, size_t chunk, uint32_t offset, size_t index) noexcept
+            : owner(owner), chunk(chunk), offset(offset), index(index) {}
+
+        inline void seek(size_t newIndex) noexcept
+        {
+            ptrdiff_t newOffset = (ptrdiff_t)offset + ((ptrdiff_t)newIndex - (ptrdiff_t)index);
+            if (newIndex == index) return;
+            if (newOffset >= 0 && chunk < owner->counts.size() && newOffset < (ptrdiff_t)owner->counts[chunk]) {
+                offset = (uint32_t)newOffset;
+                index = newIndex;
+            }
+            else {
+                *this = owner->iteratorAt(newIndex);
+            }
+        }
+
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+
+        basic_iterator() noexcept = default;
+
+        template<bool C = Const, typename = std::enable_if_t<C>>
+        basic_iterator(const basic_iterator<false>& other) noexcept
+            : owner(other.owner), chunk(other.chunk), offset(other.offset), index(other.index) {}
+
+        inline size_t Index() const noexcept { return index; }
+
+        inline reference operator*() const noexcept { return owner->chunks[chunk]->items[offset]; }
+        inline pointer operator->() const noexcept { return &owner->chunks[chunk]->items[offset]; }
+        inline reference operator[](difference_type n) const noexcept { return *(*this + n); }
+
+        inline basic_iterator& operator++() noexcept
+        {
+            index += 1;
+            if (++offset == owner->counts[chunk] && chunk + 1 < owner->chunks.size()) {
+                chunk += 1;
+                offset = 0;
+            }
+            return *this;
+        }
+
+        inline basic_iterator& operator--() noexcept
+        {
+            index -= 1;
+            if (offset == 0) {
+                chunk -= 1;
+                offset = owner->counts[chunk] - 1;
+            }
+            else {
+                offset -= 1;
+            }
+            return *this;
+        }
+
+        inline basic_iterator operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+        inline basic_iterator operator--(int) noexcept { auto tmp = *this; --*this; return tmp; }
+
+        inline basic_iterator& operator+=(difference_type n) noexcept { seek(index + n); return *this; }
+        inline basic_iterator& operator-=(difference_type n) noexcept { seek(index - n); return *this; }
+        inline basic_iterator operator+(difference_type n) const noexcept { auto tmp = *this; tmp += n; return tmp; }
+        inline basic_iterator operator-(difference_type n) const noexcept { auto tmp = *this; tmp -= n; return tmp; }
+        friend inline basic_iterator operator+(difference_type n, const basic_iterator& it) noexcept { return it + n; }
+
+        template<bool C>
+        inline difference_type operator-(const basic_iterator<C>& other) const noexcept { return (difference_type)index - (difference_type)other.index; }
+
+        template<bool C> inline bool operator==(const basic_iterator<C>& other) const noexcept { return index == other.index; }
+        template<bool C> inline bool operator!=(const basic_iterator<C>& other) const noexcept { return index != other.index; }
+        template<bool C> inline bool operator<(const basic_iterator<C>& other) const noexcept { return index < other.index; }
+        template<bool C> inline bool operator>(const basic_iterator<C>& other) const noexcept { return index > other.index; }
+        template<bool C> inline bool operator<=(const basic_iterator<C>& other) const noexcept { return index <= other.index; }
+        template<bool C> inline bool operator>=(const basic_iterator<C>& other) const noexcept { return index >= other.index; }
+    };
+
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+private:
+    template<typename Self>
+    static inline auto iteratorAtImpl(Self* self, size_t idx) noexcept
+    {
+        using It = std::conditional_t<std::is_const<Self>::value, const_iterator, iterator>;
+        if (idx >= self->count) {
+            // canonical end position is behind the last element of the last chunk
+            if (self->chunks.empty()) return It(self, 0, 0, self->count);
+            return It(self, self->chunks.size() - 1, self->counts.back(), self->count);
+        }
+        size_t offset = idx;
+        size_t chunk = self->locate(offset);
+        return It(self, chunk, (uint32_t)offset, idx);
+    }
+
+    template<typename Self, bool Upper>
+    static inline auto boundImpl(Self* self, const T& a) noexcept
+    {
+        using It = std::conditional_t<std::is_const<Self>::value, const_iterator, iterator>;
+        Comparison comp;
+        // first chunk which can contain the bound
+        size_t lo = 0, hi = self->chunks.size();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            bool before = Upper ? !comp(a, self->lastOf(mid)) : comp(self->lastOf(mid), a);
+            if (before) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == self->chunks.size()) return iteratorAtImpl(self, self->count);
+
+        auto items = self->chunks[lo]->items;
+        auto end = items + self->counts[lo];
+        auto it = Upper
+            ? std::upper_bound(items, end, a, [](auto& a, auto& b) noexcept { Comparison comp; return comp(a, b); })
+            : std::lower_bound(items, end, a, [](auto& a, auto& b) noexcept { Comparison comp; return comp(a, b); });
+        uint32_t offset = (uint32_t)std::distance(items, it);
+        return It(self, lo, offset, self->chunkBase(lo) + offset);
+    }
+
+public:
+    chunked_vector_set() noexcept = default;
+    chunked_vector_set(chunked_vector_set&&) noexcept = default;
+    chunked_vector_set& operator=(chunked_vector_set&&) noexcept = default;
+
+    chunked_vector_set(const chunked_vector_set& other) noexcept
+        : counts(other.counts), tree(other.tree), count(other.count)
+    {
+        chunks.reserve(other.chunks.size());
+        for (auto& chunk : other.chunks) {
+            chunks.emplace_back(std::make_unique<Chunk>(*chunk));
+        }
+    }
+
+    chunked_vector_set& operator=(const chunked_vector_set& other) noexcept
+    {
+        if (this != &other) {
+            chunked_vector_set copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    inline iterator iteratorAt(size_t idx) noexcept { return iteratorAtImpl(this, idx); }
+    inline const_iterator iteratorAt(size_t idx) const noexcept { return iteratorAtImpl(this, idx); }
+
+    inline iterator begin() noexcept { return iteratorAt(0); }
+    inline iterator end() noexcept { return iteratorAt(count); }
+    inline const_iterator begin() const noexcept { return iteratorAt(0); }
+    inline const_iterator end() const noexcept { return iteratorAt(count); }
+    inline const_iterator cbegin() const noexcept { return iteratorAt(0); }
+    inline const_iterator cend() const noexcept { return iteratorAt(count); }
+
+    inline size_t size() const noexcept { return count; }
+    inline bool empty() const noexcept { return count == 0; }
+    inline size_t chunk_count() const noexcept { return chunks.size(); }
+
+    inline T& operator[](size_t idx) noexcept { size_t offset = idx; size_t chunk = locate(offset); return chunks[chunk]->items[offset]; }
+    inline const T& operator[](size_t idx) const noexcept { size_t offset = idx; size_t chunk = locate(offset); return chunks[chunk]->items[offset]; }
+
+    inline T& front() noexcept { return chunks.front()->items[0]; }
+    inline const T& front() const noexcept { return chunks.front()->items[0]; }
+    inline T& back() noexcept { return chunks.back()->items[counts.back() - 1]; }
+    inline const T& back() const noexcept { return lastOf(chunks.size() - 1); }
+
+    inline void clear() noexcept
+    {
+        chunks.clear();
+        counts.clear();
+        tree.clear();
+        count = 0;
+    }
+
+    // chunks are allocated on demand, this only sizes the chunk tables for a bulk fill
+    inline void reserve(size_t size) noexcept
+    {
+        size_t chunkCount = (size + ChunkFill - 1) / ChunkFill;
+        chunks.reserve(chunkCount);
+        counts.reserve(chunkCount);
+        tree.reserve(chunkCount + 1);
+    }
+
+    inline void resize(size_t size) noexcept
+    {
+        if (size < count) erase(iteratorAt(size), end());
+        while (count < size) emplace_back_unsorted(T());
+    }
+
+    inline void sort() noexcept
+    {
+        std::vector<T> tmp(cbegin(), cend());
+        std::sort(tmp.begin(), tmp.end());
+        rebuildFrom(tmp.begin(), tmp.end());
+    }
+
+    inline iterator insert(const_iterator pos, const T& value) noexcept
+    {
+        if (chunks.empty()) {
+            insertChunk(0);
+            rebuildIndexFrom(0);
+        }
+        size_t chunk = pos.chunk;
+        uint32_t offset = pos.offset;
+        if (counts[chunk] == ChunkCapacity) {
+            split(chunk);
+            if (offset > counts[chunk]) {
+                offset -= counts[chunk];
+                chunk += 1;
+            }
+        }
+        auto items = chunks[chunk]->items;
+        std::memmove(items + offset + 1, items + offset, (counts[chunk] - offset) * sizeof(T));
+        items[offset] = value;
+        counts[chunk] += 1;
+        count += 1;
+        addToIndex(chunk, 1);
+        return iterator(this, chunk, offset, pos.index);
+    }
+
+    // the range is copied into the chunk of pos and new chunks behind it in one pass
+    template<typename InputIt>
+    inline iterator insert(const_iterator pos, InputIt first, InputIt last) noexcept
+    {
+        size_t idx = pos.index;
+        if (first == last) return iteratorAt(idx);
+        if (chunks.empty()) insertChunk(0);
+
+        size_t chunk = pos.chunk;
+        uint32_t offset = pos.offset;
+        // the elements behind pos are appended again after the range
+        auto items = chunks[chunk]->items;
+        std::vector<T> tail(items + offset, items + counts[chunk]);
+        uint32_t filled = offset;
+        std::vector<std::unique_ptr<Chunk>> newChunks;
+        std::vector<uint32_t> newCounts;
+        auto push = [&](const T& value) noexcept {
+            // the chunk of pos can be filled up, new chunks keep room for later inserts
+            if (filled == (newChunks.empty() ? ChunkCapacity : ChunkFill)) {
+                if (newChunks.empty()) counts[chunk] = filled;
+                else newCounts.back() = filled;
+                newChunks.emplace_back(std::make_unique<Chunk>());
+                newCounts.emplace_back(0);
+                items = newChunks.back()->items;
+                filled = 0;
+            }
+            items[filled++] = value;
+            count += 1;
+        };
+        count -= tail.size();
+        for (; first != last; ++first) push(*first);
+        for (auto& value : tail) push(value);
+        if (newChunks.empty()) counts[chunk] = filled;
+        else newCounts.back() = filled;
+
+        chunks.insert(chunks.begin() + chunk + 1, std::make_move_iterator(newChunks.begin()), std::make_move_iterator(newChunks.end()));
+        counts.insert(counts.begin() + chunk + 1, newCounts.begin(), newCounts.end());
+        rebuildIndexFrom(chunk);
+        return iteratorAt(idx);
+    }
+
+    inline iterator erase(const_iterator pos) noexcept
+    {
+        size_t chunk = pos.chunk;
+        uint32_t offset = pos.offset;
+        auto items = chunks[chunk]->items;
+        std::memmove(items + offset, items + offset + 1, (counts[chunk] - offset - 1) * sizeof(T));
+        counts[chunk] -= 1;
+        count -= 1;
+        if (counts[chunk] == 0) {
+            removeChunk(chunk);
+            rebuildIndexFrom(chunk);
+        }
+        else if (coalesce(chunk) || (chunk > 0 && coalesce(chunk - 1))) {
+            rebuildIndexFrom(chunk > 0 ? chunk - 1 : 0);
+        }
+        else {
+            addToIndex(chunk, -1);
+        }
+        return iteratorAt(pos.index);
+    }
+
+    inline iterator erase(const_iterator first, const_iterator last) noexcept
+    {
+        size_t from = first.index;
+        size_t remaining = last.index - first.index;
+        if (remaining == 0) return iteratorAt(from);
+
+        size_t chunk = first.chunk;
+        uint32_t offset = first.offset;
+        while (remaining > 0) {
+            uint32_t take = (uint32_t)std::min<size_t>(remaining, counts[chunk] - offset);
+            auto items = chunks[chunk]->items;
+            std::memmove(items + offset, items + offset + take, (counts[chunk] - offset - take) * sizeof(T));
+            counts[chunk] -= take;
+            count -= take;
+            remaining -= take;
+            if (counts[chunk] == 0) {
+                removeChunk(chunk);
+            }
+            else {
+                chunk += 1;
+            }
+            offset = 0;
+        }
+        // the chunks around the erased range might be almost empty now
+        if (chunk > 0) coalesce(chunk - 1);
+        rebuildIndexFrom(std::min<size_t>(first.chunk, chunk > 0 ? chunk - 1 : 0));
+        return iteratorAt(from);
+    }
+
+    template<typename... Args>
+    inline bool emplace(Args&&... args) noexcept
+    {
+        T obj(std::forward<Args>(args)...);
+        auto it = lower_bound(obj);
+        if (it != end() && equivalent(*it, obj)) {
+            return false;
+        }
+        insert(it, obj);
+        return true;
+    }
+
+    inline void emplace_back_unsorted(const T& a) noexcept
+    {
+        if (chunks.empty() || counts.back() == ChunkCapacity) {
+            insertChunk(chunks.size());
+            chunks.back()->items[0] = a;
+            counts.back() = 1;
+            count += 1;
+            rebuildIndexFrom(chunks.size() - 1);
+        }
+        else {
+            chunks.back()->items[counts.back()++] = a;
+            count += 1;
+            addToIndex(chunks.size() - 1, 1);
+        }
+    }
+
+    template<typename InputIt>
+    inline void assign(InputIt first, InputIt last) noexcept
+    {
+        rebuildFrom(first, last);
+    }
+
+    // Same semantics as vector_set::merge.
+    // Small ranges are inserted one by one, large ones rebuild the chunks in a single pass.
+    template<typename InputIt>
+    inline size_t merge(InputIt first, InputIt last) noexcept
+    {
+        if (first == last) return 0;
+        size_t mergeCount = std::distance(first, last);
+        size_t sizeBefore = count;
+        if (mergeCount * 8 < count) {
+            for (; first != last; ++first) emplace(*first);
+            return count - sizeBefore;
+        }
+
+        std::vector<T> merged;
+        merged.reserve(count + mergeCount);
+        std::merge(cbegin(), cend(), first, last, std::back_inserter(merged),
+            [](auto& a, auto& b) noexcept {
+                Comparison comp;
+                return comp(a, b);
+            });
+        // only the merged interval can contain new duplicates
+        Comparison comp;
+        auto lo = std::lower_bound(merged.begin(), merged.end(), *first, comp);
+        auto hi = std::upper_bound(lo, merged.end(), *std::prev(last), comp);
+        auto it = std::unique(lo, hi,
+            [](auto& a, auto& b) noexcept { return equivalent(a, b); });
+        merged.erase(it, hi);
+        rebuildFrom(merged.begin(), merged.end());
+        return count - sizeBefore;
+    }
+
+    // Same semantics as vector_set::erase_sorted.
+    template<typename InputIt>
+    inline size_t erase_sorted(InputIt first, InputIt last) noexcept
+    {
+        if (first == last || empty()) return 0;
+        size_t eraseCount = std::distance(first, last);
+        size_t sizeBefore = count;
+        if (eraseCount * 8 < count) {
+            for (; first != last; ++first) {
+                auto it = find(*first);
+                if (it != end()) erase(it);
+            }
+            return sizeBefore - count;
+        }
+
+        Comparison comp;
+        std::vector<T> kept;
+        kept.reserve(count);
+        for (auto it = cbegin(), itEnd = cend(); it != itEnd; ++it) {
+            while (first != last && comp(*first, *it)) ++first;
+            if (first != last && *first == *it) continue;
+            kept.emplace_back(*it);
+        }
+        rebuildFrom(kept.begin(), kept.end());
+        return sizeBefore - count;
+    }
+
+    // Same semantics as vector_set::replace_interval.
+    template<typename InputIt>
+    inline size_t replace_interval(const T& from, const T& to, InputIt first, InputIt last) noexcept
+    {
+        auto startIt = lower_bound(from);
+        auto endIt = upper_bound(to);
+        size_t removed = std::distance(startIt, endIt);
+        erase(startIt, endIt);
+        merge(first, last);
+        return removed;
+    }
+
+    inline iterator find(const T& a) noexcept
+    {
+        auto it = lower_bound(a);
+        if (it != end() && *it == a) {
+            return it;
+        }
+        return end();
+    }
+
+    inline const_iterator find(const T& a) const noexcept
+    {
+        auto it = lower_bound(a);
+        if (it != cend() && *it == a) {
+            return it;
+        }
+        return cend();
+    }
+
+    inline iterator lower_bound(const T& a) noexcept { return boundImpl<chunked_vector_set, false>(this, a); }
+    inline const_iterator lower_bound(const T& a) const noexcept { return boundImpl<const chunked_vector_set, false>(this, a); }
+    inline iterator upper_bound(const T& a) noexcept { return boundImpl<chunked_vector_set, true>(this, a); }
+    inline const_iterator upper_bound(const T& a) const noexcept { return boundImpl<const chunked_vector_set, true>(this, a); }
+
+    inline bool operator==(const chunked_vector_set& other) const noexcept
+    {
+        return count == other.count && std::equal(cbegin(), cend(), other.cbegin());
+    }
+};
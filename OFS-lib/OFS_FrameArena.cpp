@@ -0,0 +1,90 @@
+#include "OFS_FrameArena.h"
+#include "OFS_Util.h"
+#include "OFS_Profiling.h"
+
+#include <cstdlib>
+#include <algorithm>
+
+static thread_local OFS_FrameArena* CurrentArena = nullptr;
+
+OFS_FrameArena::OFS_FrameArena(size_t capacity) noexcept
+    : minCapacity(capacity)
+{
+    addBlock(capacity);
+}
+
+OFS_FrameArena::~OFS_FrameArena() noexcept
+{
+    if (CurrentArena == this) CurrentArena = nullptr;
+    for (auto& block : blocks) std::free(block.Data);
+}
+
+void OFS_FrameArena::addBlock(size_t size) noexcept
+{
+    Block block;
+    block.Data = (uint8_t*)std::malloc(size);
+    block.Size = size;
+    FUN_ASSERT(block.Data, "out of memory");
+    blocks.emplace_back(block);
+    stats.Capacity += size;
+}
+
+void* OFS_FrameArena::Allocate(size_t size, size_t alignment) noexcept
+{
+    stats.Allocations += 1;
+    stats.LiveAllocations += 1;
+    for (;;) {
+        auto& block = blocks[blockIdx];
+        size_t start = (((uintptr_t)block.Data + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - (uintptr_t)block.Data;
+        if (start + size <= block.Size) {
+            offset = start + size;
+            stats.BytesUsed += size;
+            return block.Data + start;
+        }
+        if (blockIdx + 1 == blocks.size()) {
+            addBlock(std::max(minCapacity, size + alignment));
+        }
+        blockIdx += 1;
+        offset = 0;
+    }
+}
+
+void OFS_FrameArena::Deallocate(void* ptr, size_t size) noexcept
+{
+    FUN_ASSERT(stats.LiveAllocations > 0, "deallocating more than was allocated");
+    if (stats.LiveAllocations > 0) stats.LiveAllocations -= 1;
+    auto& block = blocks[blockIdx];
+    if ((uint8_t*)ptr + size == block.Data + offset) {
+        offset -= size;
+    }
+}
+
+void OFS_FrameArena::Reset() noexcept
+{
+    OFS_PROFILE_PLOT("Frame arena allocations", (int64_t)stats.Allocations);
+    OFS_PROFILE_PLOT("Frame arena bytes", (int64_t)stats.BytesUsed);
+    FUN_ASSERT(stats.LiveAllocations == 0, "frame allocations outlived the frame");
+
+    if (blocks.size() > 1) {
+        // the next frame probably needs the same amount again
+        size_t capacity = stats.Capacity;
+        for (auto& block : blocks) std::free(block.Data);
+        blocks.clear();
+        stats.Capacity = 0;
+        addBlock(capacity);
+    }
+    blockIdx = 0;
+    offset = 0;
+    stats.Allocations = 0;
+    stats.BytesUsed = 0;
+}
+
+OFS_FrameArena* OFS_FrameArena::Current() noexcept
+{
+    return CurrentArena;
+}
+
+void OFS_FrameArena::MakeCurrent() noexcept
+{
+    CurrentArena = this;
+}
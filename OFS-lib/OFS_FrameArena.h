@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+// Bump allocator for scratch memory which doesn't outlive the current frame.
+// Everything is released at once by Reset at the start of the next frame.
+// When a frame needs more than the capacity extra blocks are chained
+// and merged into a single bigger block on the next reset.
+class OFS_FrameArena
+{
+public:
+    static constexpr size_t DefaultCapacity = 1024 * 1024;
+
+    struct Stats {
+        uint32_t Allocations = 0;
+        uint32_t LiveAllocations = 0;
+        size_t BytesUsed = 0;
+        size_t Capacity = 0;
+    };
+
+private:
+    struct Block {
+        uint8_t* Data = nullptr;
+        size_t Size = 0;
+    };
+
+    std::vector<Block> blocks;
+    uint32_t blockIdx = 0;
+    size_t offset = 0;
+    size_t minCapacity = 0;
+    Stats stats;
+
+    void addBlock(size_t size) noexcept;
+
+public:
+    explicit OFS_FrameArena(size_t capacity = DefaultCapacity) noexcept;
+    OFS_FrameArena(const OFS_FrameArena&) = delete;
+    OFS_FrameArena& operator=(const OFS_FrameArena&) = delete;
+    ~OFS_FrameArena() noexcept;
+
+    void* Allocate(size_t size, size_t alignment) noexcept;
+    // only the most recent allocation actually gives memory back
+    void Deallocate(void* ptr, size_t size) noexcept;
+    // invalidates everything allocated since the last reset
+    void Reset() noexcept;
+
+    inline const Stats& FrameStats() const noexcept { return stats; }
+
+    // the arena used by OFS_FrameAllocator on the calling thread, can be null
+    static OFS_FrameArena* Current() noexcept;
+    void MakeCurrent() noexcept;
+};
+
+// Allocator adapter for containers which are only used within a frame.
+// Falls back to the heap on threads without a current arena.
+template<typename T>
+class OFS_FrameAllocator
+{
+public:
+    using value_type = T;
+    OFS_FrameArena* arena;
+
+    OFS_FrameAllocator() noexcept : arena(OFS_FrameArena::Current()) {}
+    template<typename U>
+    OFS_FrameAllocator(const OFS_FrameAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    inline T* allocate(size_t n) noexcept
+    {
+        if (!arena) return std::allocator<T>().allocate(n);
+        return (T*)arena->Allocate(n * sizeof(T), alignof(T));
+    }
+
+    inline void deallocate(T* ptr, size_t n) noexcept
+    {
+        if (!arena) std::allocator<T>().deallocate(ptr, n);
+        else arena->Deallocate(ptr, n * sizeof(T));
+    }
+
+    template<typename U>
+    inline bool operator==(const OFS_FrameAllocator<U>& other) const noexcept { return arena == other.arena; }
+    template<typename U>
+    inline bool operator!=(const OFS_FrameAllocator<U>& other) const noexcept { return arena != other.arena; }
+};
+
+template<typename T>
+using OFS_FrameVector = std::vector<T, OFS_FrameAllocator<T>>;
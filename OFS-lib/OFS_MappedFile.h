@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file.
+class OFS_MappedFile
+{
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+public:
+    OFS_MappedFile() noexcept {}
+    OFS_MappedFile(const OFS_MappedFile&) = delete;
+    OFS_MappedFile& operator=(const OFS_MappedFile&) = delete;
+    ~OFS_MappedFile() noexcept { Close(); }
+
+    bool Open(const std::string& path) noexcept;
+    void Close() noexcept;
+
+    inline bool IsOpen() const noexcept { return data != nullptr; }
+    inline const uint8_t* Data() const noexcept { return data; }
+    inline size_t Size() const noexcept { return size; }
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "SDL_thread.h"
+#include "SDL_cpuinfo.h"
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+namespace OFS
+{
+    // runs fn(idx) for every index, the calling thread and one worker per additional core pick up indices
+    template<typename Fn>
+    inline void ParallelFor(uint32_t count, Fn fn, const char* threadName = "OFS_ParallelFor") noexcept
+    {
+        struct Worker {
+            Fn* fn = nullptr;
+            std::atomic<uint32_t>* next = nullptr;
+            uint32_t count = 0;
+            SDL_Thread* thread = nullptr;
+        };
+        auto workerMain = [](void* user) -> int {
+            auto worker = static_cast<Worker*>(user);
+            uint32_t idx;
+            while ((idx = worker->next->fetch_add(1)) < worker->count) {
+                (*worker->fn)(idx);
+            }
+            return 0;
+        };
+
+        std::atomic<uint32_t> next = 0;
+        uint32_t workerCount = std::min<uint32_t>(std::max(SDL_GetCPUCount(), 1) - 1, count);
+        std::vector<Worker> workers(workerCount, Worker{ &fn, &next, count });
+        for (auto& worker : workers) {
+            // a worker which fails to start is covered by the others
+            worker.thread = SDL_CreateThread(workerMain, threadName, &worker);
+        }
+        Worker self{ &fn, &next, count };
+        workerMain(&self);
+        for (auto& worker : workers) {
+            if (worker.thread) SDL_WaitThread(worker.thread, nullptr);
+        }
+    }
+}
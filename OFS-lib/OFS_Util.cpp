@@ -13,6 +13,9 @@
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #include <shellapi.h>
+#include <io.h>
+#else
+#include <unistd.h>
 #endif
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -26,6 +29,7 @@
 #include <string>
 #include <locale>
 #include <codecvt>
+#include <cstdio>
 
 #define SDEFL_IMPLEMENTATION
 #include "sdefl.h"
@@ -311,6 +315,41 @@ void Util::MessageBoxAlert(const std::string& title, const std::string& message)
     SDL_DetachThread(handle);
 }
 
+bool Util::WriteFileAtomic(const std::string& path, const void* buffer, size_t size) noexcept
+{
+    auto targetPath = Util::PathFromString(path);
+    auto tmpPath = targetPath;
+    tmpPath += ".tmp";
+#ifdef WIN32
+    FILE* file = _wfopen(tmpPath.c_str(), L"wb");
+#else
+    FILE* file = std::fopen(tmpPath.c_str(), "wb");
+#endif
+    if (!file) {
+        LOGF_ERROR("Failed to open \"%s\"", tmpPath.u8string().c_str());
+        return false;
+    }
+    bool written = std::fwrite(buffer, 1, size, file) == size && std::fflush(file) == 0;
+#ifdef WIN32
+    written = written && _commit(_fileno(file)) == 0;
+#else
+    written = written && fsync(fileno(file)) == 0;
+#endif
+    written = std::fclose(file) == 0 && written;
+
+    std::error_code ec;
+    if (written) {
+        std::filesystem::rename(tmpPath, targetPath, ec);
+        if (!ec) return true;
+        LOGF_ERROR("Failed to replace \"%s\": %s", path.c_str(), ec.message().c_str());
+    }
+    else {
+        LOGF_ERROR("Failed to write \"%s\"", tmpPath.u8string().c_str());
+    }
+    std::filesystem::remove(tmpPath, ec);
+    return false;
+}
+
 std::string Util::Resource(const std::string& path) noexcept
 {
     auto base = Util::Basepath() / L"data" / Util::Utf8ToUtf16(path);
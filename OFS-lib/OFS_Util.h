@@ -183,6 +183,10 @@ public:
         return 0;
     }
 
+    // writes to a temporary file next to path, syncs it and renames it over path
+    // readers either see the old or the new file, never a partial one
+    static bool WriteFileAtomic(const std::string& path, const void* buffer, size_t size) noexcept;
+
     inline static nlohmann::json ParseJson(const std::string& jsonText, bool* success) noexcept
     {
         nlohmann::json json;
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <algorithm>
+#include <vector>
+#include <iterator>
 
 template<typename T>
 struct DefaultComparison {
@@ -43,6 +45,103 @@ public:
         this->emplace_back(a);
     }
 
+    // Merges a sorted range into the set in a single linear pass.
+    // Elements which compare equal to an existing element are dropped,
+    // same as with emplace. Returns the number of inserted elements.
+    template<typename InputIt>
+    inline size_t merge(InputIt first, InputIt last) noexcept
+    {
+        if (first == last) return 0;
+        Comparison comp;
+        size_t sizeBefore = this->size();
+
+        // fast path: the whole range goes to the end
+        if (this->empty() || comp(this->back(), *first)) {
+            this->insert(this->end(), first, last);
+        }
+        else {
+            this->insert(this->end(), first, last);
+            // stable, existing elements stay in front of equal new ones
+            std::inplace_merge(this->begin(), this->begin() + sizeBefore, this->end(),
+                [](auto& a, auto& b) noexcept {
+                    Comparison comp;
+                    return comp(a, b);
+                });
+        }
+        // only the merged interval can contain new duplicates
+        auto lo = lower_bound(*first);
+        auto hi = upper_bound(*std::prev(last));
+        auto it = std::unique(lo, hi,
+            [](auto& a, auto& b) noexcept {
+                Comparison comp;
+                return !comp(a, b) && !comp(b, a);
+            });
+        this->erase(it, hi);
+        return this->size() - sizeBefore;
+    }
+
+    // Erases every element which is also part of the sorted range in a single pass.
+    // Returns the number of erased elements.
+    template<typename InputIt>
+    inline size_t erase_sorted(InputIt first, InputIt last) noexcept
+    {
+        if (first == last || this->empty()) return 0;
+        Comparison comp;
+        auto out = lower_bound(*first);
+        for (auto it = out, end = this->end(); it != end; ++it) {
+            while (first != last && comp(*first, *it)) ++first;
+            if (first != last && *first == *it) continue;
+            if (out != it) *out = std::move(*it);
+            ++out;
+        }
+        size_t erased = std::distance(out, this->end());
+        this->erase(out, this->end());
+        return erased;
+    }
+
+    // Removes every element between from and to (both inclusive)
+    // and merges the sorted range in its place.
+    // Returns the number of removed elements.
+    template<typename InputIt>
+    inline size_t replace_interval(const T& from, const T& to, InputIt first, InputIt last) noexcept
+    {
+        auto startIt = lower_bound(from);
+        auto endIt = upper_bound(to);
+        size_t startIdx = std::distance(this->begin(), startIt);
+        size_t removed = std::distance(startIt, endIt);
+
+        Comparison comp;
+        bool fitsGap = first == last 
+            || ((startIt == this->begin() || comp(*(startIt - 1), *first))
+                && (endIt == this->end() || comp(*std::prev(last), *endIt)));
+
+        if (fitsGap) {
+            // overwrite the removed elements and only shift the tail once
+            size_t count = std::distance(first, last);
+            size_t overlap = std::min(count, removed);
+            auto src = first;
+            std::advance(src, overlap);
+            std::copy(first, src, this->begin() + startIdx);
+            if (count > removed) {
+                this->insert(this->begin() + startIdx + overlap, src, last);
+            }
+            else {
+                this->erase(this->begin() + startIdx + overlap, this->begin() + startIdx + removed);
+            }
+            auto it = std::unique(this->begin() + startIdx, this->begin() + startIdx + count,
+                [](auto& a, auto& b) noexcept {
+                    Comparison comp;
+                    return !comp(a, b) && !comp(b, a);
+                });
+            this->erase(it, this->begin() + startIdx + count);
+        }
+        else {
+            this->erase(startIt, endIt);
+            merge(first, last);
+        }
+        return removed;
+    }
+
     inline auto find(const T& a) noexcept
     {
         auto it = lower_bound(a);
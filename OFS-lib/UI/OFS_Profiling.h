@@ -23,9 +23,11 @@ public:
 #define OFS_PROFILE(name) ZoneScopedN(name)
 #define OFS_BEGINPROFILING() OFS_Profiler::BeginProfiling()
 #define OFS_ENDPROFILING() OFS_Profiler::EndProfiling();
+#define OFS_PROFILE_PLOT(name, value) TracyPlot(name, value)
 #else
 #define OFS_PROFILE(name)
 #define OFS_BEGINPROFILING()
 #define OFS_ENDPROFILING()
+#define OFS_PROFILE_PLOT(name, value)
 #endif
 
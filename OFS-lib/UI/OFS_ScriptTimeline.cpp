@@ -49,11 +49,15 @@ void ScriptTimeline::updateSelection(const OverlayDrawingCtx& ctx, bool clear) n
 
 void ScriptTimeline::FfmpegAudioProcessingFinished(const WaveformProcessingFinishedEvent* ev) noexcept
 {
+	// the video changed while processing
+	if (ev->videoPath != videoPath) return;
 	ShowAudioWaveform = true;
 	// Update cache
 	auto& waveCache = WaveformState::StaticStateSlow();
-	waveCache.Filename = videoPath;
-	waveCache.SetSamples(Wave.data.Samples());
+	waveCache.Filename = ev->videoPath;
+	if (auto pyramid = Wave.data.Pyramid()) {
+		waveCache.SetPyramid(std::move(pyramid));
+	}
 	LOG_INFO("Audio processing complete.");
 }
 
@@ -98,12 +102,13 @@ void ScriptTimeline::Update() noexcept
 void ScriptTimeline::videoLoaded(const VideoLoadedEvent* ev) noexcept
 {
 	if(ev->playerType != VideoplayerType::Main) return;
+	Wave.data.Cancel();
 	videoPath = ev->videoPath;
 	auto& waveCache = WaveformState::StaticStateSlow();
-	auto samples = waveCache.GetSamples();
-	if(waveCache.Filename == videoPath && !samples.empty())
+	auto pyramid = waveCache.GetPyramid();
+	if(waveCache.Filename == videoPath && pyramid)
 	{
-		Wave.data.SetSamples(std::move(samples));
+		Wave.data.SetPyramid(std::move(pyramid));
 		ShowAudioWaveform = true;
 	}
 	else 
@@ -321,16 +326,15 @@ void ScriptTimeline::ShowScriptPositions(
 
 		if(script->HasSelection())
 		{
-			auto startIt = script->Selection().lower_bound(FunscriptAction(drawingCtx.offsetTime, 0));
-			if (startIt != script->Selection().begin())
-				startIt -= 1;
-
-			auto endIt = script->Selection().lower_bound(FunscriptAction(drawingCtx.offsetTime + drawingCtx.visibleTime, 0));
-			if (endIt != script->Selection().end())
-				endIt += 1;
-
-			drawingCtx.selectionFromIdx = std::distance(script->Selection().begin(), startIt);
-			drawingCtx.selectionToIdx = std::distance(script->Selection().begin(), endIt);
+			// action indices enclosing the visible selection plus one selected action on each side
+			auto& selection = script->Selection();
+			uint32_t visibleFromIdx = std::distance(script->Actions().begin(), script->Actions().lower_bound(FunscriptAction(drawingCtx.offsetTime, 0)));
+			uint32_t visibleToIdx = std::distance(script->Actions().begin(), script->Actions().lower_bound(FunscriptAction(drawingCtx.offsetTime + drawingCtx.visibleTime, 0)));
+
+			uint32_t fromIdx = selection.FindPrev(visibleFromIdx);
+			uint32_t toIdx = selection.FindNext(visibleToIdx);
+			drawingCtx.selectionFromIdx = fromIdx != FunscriptSelection::None ? fromIdx : visibleFromIdx;
+			drawingCtx.selectionToIdx = toIdx != FunscriptSelection::None ? toIdx + 1 : selection.ActionCount();
 		}
 		else 
 		{
@@ -459,18 +463,17 @@ void ScriptTimeline::ShowScriptPositions(
 				ImGui::EndMenu();
 			}
 
+			struct WaveformThreadData {
+				ScriptTimeline* timeline;
+				std::string videoPath;
+			};
 			auto updateAudioWaveformThread = [](void* userData) -> int {
-				auto& ctx = *((ScriptTimeline*)userData);
-				std::error_code ec;
+				auto data = (WaveformThreadData*)userData;
 				auto ffmpegPath = Util::FfmpegPath();
-				auto outputPath = Util::Prefpath("tmp");
-				if (!Util::CreateDirectories(outputPath)) {
-					return 0;
+				if (data->timeline->Wave.data.Generate(ffmpegPath.u8string(), data->videoPath)) {
+					EV::Enqueue<WaveformProcessingFinishedEvent>(data->videoPath);
 				}
-				
-				outputPath = (Util::PathFromString(outputPath) / "audio.flac").u8string();
-				bool succ = ctx.Wave.data.GenerateAndLoadFlac(ffmpegPath.u8string(), ctx.videoPath, outputPath);
-				EV::Enqueue<WaveformProcessingFinishedEvent>();
+				delete data;
 				return 0;
 			};
 			if (ImGui::BeginMenu(TR_ID("WAVEFORM", Tr::WAVEFORM))) {
@@ -478,6 +481,7 @@ void ScriptTimeline::ShowScriptPositions(
 					ImGui::SetNextItemWidth(ImGui::GetFontSize()*5.f);
 					ImGui::DragFloat(TR(SCALE), &ScaleAudio, 0.01f, 0.01f, 10.f, "%.3f", ImGuiSliderFlags_AlwaysClamp);
 					ImGui::ColorEdit3(TR(COLOR), &Wave.WaveformColor.Value.x, ImGuiColorEditFlags_NoInputs);
+					ImGui::Checkbox(TR(SPECTRAL_COLORS), &Wave.SpectralColors);
 					ImGui::EndMenu();
 				}
 				if (ImGui::MenuItem(TR(ENABLE_WAVEFORM), NULL, &ShowAudioWaveform, !Wave.data.BusyGenerating())) {}
@@ -489,18 +493,20 @@ void ScriptTimeline::ShowScriptPositions(
 				}
 				else if(ImGui::MenuItem(TR(UPDATE_WAVEFORM), NULL, false, !Wave.data.BusyGenerating() && !videoPath.empty())) {
 					if (!Wave.data.BusyGenerating()) {
-						ShowAudioWaveform = false; // gets switched true after processing
+						// the waveform fills in while processing
+						ShowAudioWaveform = true;
 
 						auto& waveCache = WaveformState::StaticStateSlow();
-						auto samples = waveCache.GetSamples();
-						if(waveCache.Filename == videoPath && !samples.empty())
+						auto pyramid = waveCache.GetPyramid();
+						if(waveCache.Filename == videoPath && pyramid)
 						{
-							Wave.data.SetSamples(std::move(samples));
-							ShowAudioWaveform = true;
+							Wave.data.SetPyramid(std::move(pyramid));
 						}
 						else 
 						{
-							auto handle = SDL_CreateThread(updateAudioWaveformThread, "OFS_GenWaveform", this);
+							Wave.data.Clear();
+							auto threadData = new WaveformThreadData{ this, videoPath };
+							auto handle = SDL_CreateThread(updateAudioWaveformThread, "OFS_GenWaveform", threadData);
 							SDL_DetachThread(handle);
 						}
 					}
@@ -552,8 +558,10 @@ void ScriptTimeline::DrawAudioWaveform(const OverlayDrawingCtx& ctx) noexcept
 				ctx->Wave.WaveShader->ProjMtx(&orthoProjection[0][0]);
 				ctx->Wave.WaveShader->AudioData(1);
 				ctx->Wave.WaveShader->SampleOffset(ctx->Wave.samplingOffset);
+				ctx->Wave.WaveShader->SampleScale(ctx->Wave.samplingScale);
 				ctx->Wave.WaveShader->ScaleFactor(ctx->ScaleAudio);
 				ctx->Wave.WaveShader->Color(&ctx->Wave.WaveformColor.Value.x);
+				ctx->Wave.WaveShader->SpectralMix(ctx->Wave.spectralMix);
 			}, timeline);
 
 			ctx.drawList->AddImage(0, ctx.canvasPos, ctx.canvasPos + ctx.canvasSize);
@@ -52,6 +52,9 @@ class ShouldChangeActiveScriptEvent : public OFS_Event<ShouldChangeActiveScriptE
 class WaveformProcessingFinishedEvent : public OFS_Event<WaveformProcessingFinishedEvent>
 {
     public:
+    std::string videoPath;
+    WaveformProcessingFinishedEvent(const std::string& videoPath) noexcept
+        : videoPath(videoPath) {}
 };
 
 class FunscriptShouldSelectTimeEvent : public OFS_Event<FunscriptShouldSelectTimeEvent>
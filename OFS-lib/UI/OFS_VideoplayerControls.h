@@ -36,9 +36,14 @@ public:
 
 	void Init(class OFS_Videoplayer* player, bool hwAccel) noexcept;
 
-	inline void UpdateHeatmap(float totalDuration, const FunscriptArray& actions) noexcept
+	inline void UpdateHeatmap(float totalDuration, const FunscriptColumns& columns) noexcept
 	{
-		Heatmap->Update(totalDuration, actions);
+		Heatmap->Update(totalDuration, columns);
+	}
+
+	inline void UpdateHeatmapRange(float totalDuration, const FunscriptColumns& columns, float fromTime, float toTime) noexcept
+	{
+		Heatmap->UpdateRange(totalDuration, columns, fromTime, toTime);
 	}
 
 	void DrawTimeline() noexcept;
@@ -3,105 +3,168 @@
 #include "OFS_Profiling.h"
 #include "OFS_GL.h"
 #include "OFS_ScriptTimeline.h"
-
-#define DR_FLAC_IMPLEMENTATION
-#include "dr_flac.h"
+#include "OFS_WaveformSpectrum.h"
 
 #include "subprocess.h"
 
-bool OFS_Waveform::LoadFlac(const std::string& output) noexcept
+#include <array>
+
+void OFS_Waveform::Cancel() noexcept
 {
-	drflac* flac = drflac_open_file(output.c_str(), NULL);
-	if (!flac) return false;
-
-	std::vector<drflac_int16> ChunkSamples; ChunkSamples.resize(48000);
-	constexpr int SamplesPerLine = 300; 
-
-	float minSample = 0.f;
-	float maxSample = 0.f;
-
-	uint32_t sampleCount = 0;
-	float avgSample = 0.f;
-	Clear();
-	samples.reserve(flac->totalPCMFrameCount / SamplesPerLine);
-	while ((sampleCount = drflac_read_pcm_frames_s16(flac, ChunkSamples.size(), ChunkSamples.data())) > 0) {
-		for (int sampleIdx = 0; sampleIdx < sampleCount; sampleIdx += SamplesPerLine) {
-			int samplesInThisLine = std::min(SamplesPerLine, (int)sampleCount - sampleIdx);
-			for (int i = 0; i < samplesInThisLine; i += 1) {
-				drflac_int16 sample = ChunkSamples[sampleIdx + i];
-				sample = std::abs(sample);
-				auto floatSample = sample / 32768.f;
-				avgSample += floatSample;
-			}
-			avgSample /= (float)SamplesPerLine;
-			minSample = Util::Min(minSample, avgSample);
-			maxSample = Util::Max(maxSample, avgSample);
-			samples.emplace_back(avgSample);
-			avgSample = 0.f;
-		}
-	}
-	drflac_close(flac);
-	samples.shrink_to_fit();
+	SDL_AtomicLock(&publishLock);
+	generation += 1;
+	SDL_AtomicUnlock(&publishLock);
+	generating = false;
+}
 
-	if(std::abs(minSample) > std::abs(maxSample)) {
-		maxSample = std::abs(minSample);
-	}
-	else {
-		minSample = -maxSample;
+void OFS_Waveform::publish(const std::vector<float>& lines, float maxLine,
+	const std::vector<OFS_WaveformPyramid::Bands>& bands, const OFS_WaveformPyramid::Bands& maxBands, uint32_t id) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	// normalized by the loudest line so far, the last publish uses the loudest of the whole track
+	std::vector<float> samples;
+	samples.reserve(lines.size());
+	float scale = maxLine > 0.f ? 1.f / maxLine : 0.f;
+	for (auto line : lines) {
+		samples.emplace_back(line * scale);
 	}
 
-	for(auto& sample : samples) {
-		sample = Util::MapRange(sample, minSample, maxSample, -1.f, 1.f);
+	// every band is normalized on its own, otherwise the bass would dominate most music
+	std::vector<OFS_WaveformPyramid::Bands> normalizedBands;
+	normalizedBands.reserve(bands.size());
+	float lowScale = maxBands.Low > 0.f ? 1.f / maxBands.Low : 0.f;
+	float midScale = maxBands.Mid > 0.f ? 1.f / maxBands.Mid : 0.f;
+	float highScale = maxBands.High > 0.f ? 1.f / maxBands.High : 0.f;
+	for (auto& band : bands) {
+		normalizedBands.emplace_back(OFS_WaveformPyramid::Bands{ band.Low * lowScale, band.Mid * midScale, band.High * highScale });
 	}
+	// while streaming the windows of the newest lines aren't complete yet
+	normalizedBands.resize(samples.size(), normalizedBands.empty() ? OFS_WaveformPyramid::Bands{} : normalizedBands.back());
+	auto newPyramid = std::make_shared<const OFS_WaveformPyramid>(std::move(samples), (float)PcmSampleRate / SamplesPerLine, std::move(normalizedBands));
 
-	return true;
+	SDL_AtomicLock(&publishLock);
+	if (generation == id) SetPyramid(std::move(newPyramid));
+	SDL_AtomicUnlock(&publishLock);
 }
 
-bool OFS_Waveform::GenerateAndLoadFlac(const std::string& ffmpegPath, const std::string& videoPath, const std::string& output) noexcept
+bool OFS_Waveform::Generate(const std::string& ffmpegPath, const std::string& videoPath, uint32_t id) noexcept
 {
+	OFS_PROFILE(__FUNCTION__);
+	if (generation != id) return false;
 	generating = true;
 
-	std::array<const char*, 11> args =
+	auto sampleRate = std::to_string(PcmSampleRate);
+	std::array<const char*, 16> args =
 	{
 		ffmpegPath.c_str(),
-		"-y",
+		"-nostdin",
 		"-loglevel",
 		"quiet",
 		"-i", videoPath.c_str(),
 		"-vn",
 		"-ac", "1",
-		output.c_str(),
+		"-ar", sampleRate.c_str(),
+		"-f", "s16le",
+		"-",
 		nullptr
 	};
 	struct subprocess_s proc;
 	if(subprocess_create(args.data(), subprocess_option_no_window, &proc) != 0) {
-		generating = false; 
-		return false; 
+		if (generation == id) generating = false;
+		return false;
 	}
 
-	if(proc.stdout_file) 
-	{
-		fclose(proc.stdout_file);
-		proc.stdout_file = nullptr;
-	}
-	
 	if(proc.stderr_file) 
 	{
 		fclose(proc.stderr_file);
 		proc.stderr_file = nullptr;
 	}
 
+	// one second of audio per read
+	std::vector<int16_t> chunk(PcmSampleRate);
+	std::vector<float> lines;
+	float lineSum = 0.f;
+	int32_t lineSamples = 0;
+	float maxLine = 0.f;
+
+	OFS_WaveformSpectrum spectrum(PcmSampleRate);
+	std::vector<OFS_WaveformPyramid::Bands> bands;
+	OFS_WaveformPyramid::Bands maxBands;
+	// the last FftSize samples twice in a row so a window is always contiguous
+	std::vector<float> history(2 * OFS_WaveformSpectrum::FftSize, 0.f);
+	int32_t historyPos = 0;
+	auto pushSample = [&](float sample) noexcept {
+		history[historyPos] = history[historyPos + OFS_WaveformSpectrum::FftSize] = sample;
+		historyPos = (historyPos + 1) % OFS_WaveformSpectrum::FftSize;
+	};
+	// a window is centred this many lines before the line which completes it
+	constexpr int32_t BandDelayLines = (OFS_WaveformSpectrum::FftSize / 2) / SamplesPerLine;
+	int32_t analyzedWindows = 0;
+	auto analyzeWindow = [&]() noexcept {
+		auto band = spectrum.Analyze(history.data() + historyPos);
+		if (analyzedWindows++ < BandDelayLines) return;
+		maxBands.Low = Util::Max(maxBands.Low, band.Low);
+		maxBands.Mid = Util::Max(maxBands.Mid, band.Mid);
+		maxBands.High = Util::Max(maxBands.High, band.High);
+		bands.emplace_back(band);
+	};
+	auto addLine = [&](float line) noexcept {
+		maxLine = Util::Max(maxLine, line);
+		lines.emplace_back(line);
+		analyzeWindow();
+	};
+
+	uint32_t lastPublish = SDL_GetTicks();
+	bool cancelled = false;
+
+	size_t readCount;
+	while ((readCount = fread(chunk.data(), sizeof(int16_t), chunk.size(), proc.stdout_file)) > 0) {
+		if (generation != id) {
+			cancelled = true;
+			break;
+		}
+		for (size_t i = 0; i < readCount; i += 1) {
+			float sample = chunk[i] / 32768.f;
+			lineSum += std::abs(sample);
+			pushSample(sample);
+			if (++lineSamples == SamplesPerLine) {
+				addLine(lineSum / SamplesPerLine);
+				lineSum = 0.f;
+				lineSamples = 0;
+			}
+		}
+		if (SDL_GetTicks() - lastPublish >= PublishIntervalMs) {
+			publish(lines, maxLine, bands, maxBands, id);
+			lastPublish = SDL_GetTicks();
+		}
+	}
+
+	if (cancelled) {
+		subprocess_terminate(&proc);
+	}
+	// subprocess_destroy only expects stderr to be open if stdout is
+	fclose(proc.stdout_file);
+	proc.stdout_file = nullptr;
 	int return_code;
 	subprocess_join(&proc, &return_code);
 	subprocess_destroy(&proc);
-
-	if (!LoadFlac(output)) {
-		generating = false;
+	if (cancelled || generation != id) {
+		LOG_INFO("Waveform generation was cancelled.");
 		return false;
 	}
 
-	generating = false;
-	return true;
+	if (lineSamples > 0) {
+		addLine(lineSum / SamplesPerLine);
+	}
+	// the windows of the last lines only complete with the silence after the track
+	while (bands.size() < lines.size()) {
+		for (int32_t i = 0; i < SamplesPerLine; i += 1) pushSample(0.f);
+		analyzeWindow();
+	}
+	bool succ = !lines.empty();
+	if (succ) publish(lines, maxLine, bands, maxBands, id);
+	if (generation == id) generating = false;
+	return succ;
 }
 
 void OFS_WaveformLOD::Init() noexcept
@@ -118,85 +181,44 @@ void OFS_WaveformLOD::Init() noexcept
 void OFS_WaveformLOD::Update(const OverlayDrawingCtx& ctx) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
-	const float relStart = ctx.offsetTime / ctx.totalDuration;
-	const float relDuration = ctx.visibleTime / ctx.totalDuration;
-	
-	const auto& samples = data.Samples();
-	const float totalSampleCount = samples.size();
-
-	float startIndexF = relStart * totalSampleCount;
-	float endIndexF = (relStart* totalSampleCount) + (totalSampleCount * relDuration);
-
-	float visibleSampleCountF = endIndexF - startIndexF;
-
-	const float desiredSamples = ctx.canvasSize.x/3.f;
-	const float everyNth = SDL_ceilf(visibleSampleCountF / desiredSamples);
-
-	auto& lineBuf = WaveformLineBuffer;		
-	if((int32_t)lastMultiple != (int32_t)(startIndexF / everyNth)) {
-		int32_t scrollBy = (startIndexF/everyNth) - lastMultiple;
-
-		if(lastVisibleDuration == ctx.visibleTime
-		&& lastCanvasX == ctx.canvasSize.x
-		&& scrollBy > 0 && scrollBy < lineBuf.size()) {
-			OFS_PROFILE("WaveformScrolling");
-			std::memcpy(lineBuf.data(), lineBuf.data() + scrollBy, sizeof(float) * (lineBuf.size() - scrollBy));
-			lineBuf.resize(lineBuf.size() - scrollBy);
-			
-			int addedCount = 0;
-			float maxSample;
-			for(int32_t i = endIndexF - (everyNth*scrollBy); i <= endIndexF; i += everyNth) {
-				maxSample = 0.f;
-				for(int32_t j=0; j < everyNth; j += 1) {
-					int32_t currentIndex = i + j;
-					if(currentIndex >= 0 && currentIndex < totalSampleCount) {
-						float s = std::abs(samples[currentIndex]);
-						maxSample = Util::Max(maxSample, s);
-					}
-				}
-				lineBuf.emplace_back(maxSample);
-				addedCount += 1; 
-				if(addedCount == scrollBy) break;
-			}
-			assert(addedCount == scrollBy);
-		} else if(scrollBy != 0) {
-			OFS_PROFILE("WaveformUpdate");
-			lineBuf.clear();
-			float maxSample;
-			for(int32_t i = startIndexF; i <= endIndexF; i += everyNth) {
-				maxSample = 0.f;
-				for(int32_t j=0; j < everyNth; j += 1) {
-					int32_t currentIndex = i + j;
-					if(currentIndex >= 0 && currentIndex < totalSampleCount) {
-						float s = std::abs(samples[currentIndex]);
-						maxSample = Util::Max(maxSample, s);
-					}
-				}
-				lineBuf.emplace_back(maxSample);
-			}
-		}
+	auto pyramid = data.Pyramid();
+	if (!pyramid || pyramid->SampleCount() == 0) return;
+
+	// a partially generated waveform only covers the start of the media
+	const float samplesPerSecond = pyramid->SamplesPerSecond() > 0.f
+		? pyramid->SamplesPerSecond()
+		: pyramid->SampleCount() / ctx.totalDuration;
+	const float startIndexF = ctx.offsetTime * samplesPerSecond;
+	const float visibleSampleCountF = ctx.visibleTime * samplesPerSecond;
+
+	// the coarsest level which still has a bin for every 3 pixels
+	// so no more than twice that many bins are uploaded at any zoom
+	const float desiredSamples = ctx.canvasSize.x / 3.f;
+	uint32_t level = 0;
+	while (level + 1 < pyramid->LevelCount()
+		&& visibleSampleCountF / (float)(1u << (level + 1)) >= desiredSamples) {
+		level += 1;
+	}
 
-		
-		lastMultiple = SDL_floorf(startIndexF / everyNth);
-		lastCanvasX = ctx.canvasSize.x;
-		lastVisibleDuration = ctx.visibleTime;
+	const float binSize = (float)(1u << level);
+	const float startBinF = startIndexF / binSize;
+	const float visibleBinsF = visibleSampleCountF / binSize;
+	const int64_t firstBin = (int64_t)SDL_floorf(startBinF);
+	const uint32_t binCount = (uint32_t)SDL_ceilf(visibleBinsF) + 1;
+
+	if (pyramid != uploadedPyramid || level != lastLevel
+		|| firstBin != lastFirstBin || binCount * OFS_WaveformPyramid::TexelComponents != WaveformLineBuffer.size()) {
+		WaveformLineBuffer.resize(binCount * OFS_WaveformPyramid::TexelComponents);
+		pyramid->Texels(level, firstBin, binCount, WaveformLineBuffer.data());
+		uploadedPyramid = std::move(pyramid);
+		lastLevel = level;
+		lastFirstBin = firstBin;
 		Upload();
 	}
 
-	samplingOffset = (1.f / lineBuf.size()) * ((startIndexF/everyNth) - lastMultiple);
-
-#if 0
-	ImGui::Begin("Waveform Debug");
-	ImGui::Text("Audio samples: %lld", lineBuf.size());
-	ImGui::Text("Expected samples: %f", (endIndexF - startIndexF)/everyNth);
-	ImGui::Text("Samples in view: %f", (endIndexF - startIndexF));
-	ImGui::Text("Start: %f", startIndexF);
-	ImGui::Text("End: %f", endIndexF);
-	ImGui::Text("Every nth: %f", everyNth);
-	ImGui::Text("Last multiple: %f", lastMultiple);
-	ImGui::SliderFloat("Offset", &samplingOffset, 0.f, 1.f/lineBuf.size(), "%f");
-	ImGui::End();
-#endif
+	spectralMix = SpectralColors && uploadedPyramid->HasBands() ? 1.f : 0.f;
+	samplingScale = visibleBinsF / textureWidth;
+	samplingOffset = (startBinF - firstBin) / textureWidth;
 }
 
 void OFS_WaveformLOD::Upload() noexcept
@@ -204,5 +226,12 @@ void OFS_WaveformLOD::Upload() noexcept
 	OFS_PROFILE(__FUNCTION__);
 	glActiveTexture(GL_TEXTURE1);
 	glBindTexture(GL_TEXTURE_2D, WaveformTex);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, WaveformLineBuffer.size(), 1, 0, GL_RED, GL_FLOAT, WaveformLineBuffer.data());
-}
\ No newline at end of file
+	uint32_t texelCount = WaveformLineBuffer.size() / OFS_WaveformPyramid::TexelComponents;
+	if (texelCount > textureWidth) {
+		// only reallocated when the canvas gets wider
+		textureWidth = 256;
+		while (textureWidth < texelCount) textureWidth *= 2;
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, textureWidth, 1, 0, GL_RGBA, GL_FLOAT, nullptr);
+	}
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texelCount, 1, GL_RGBA, GL_FLOAT, WaveformLineBuffer.data());
+}
@@ -3,52 +3,83 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <atomic>
 
 #include "OFS_BinarySerialization.h"
 #include "OFS_Shader.h"
+#include "OFS_WaveformPyramid.h"
 #include "imgui.h"
+#include "SDL_atomic.h"
 
 
 
 // helper class to render audio waves
 class OFS_Waveform
 {
-	bool generating = false;
-	std::vector<float> samples;
+	std::atomic<bool> generating = false;
+	// bumped by Cancel, a generation only publishes while it is the latest one
+	std::atomic<uint32_t> generation = 0;
+	SDL_SpinLock publishLock = 0;
+	// replaced by the generating thread, read by the main thread
+	std::shared_ptr<const OFS_WaveformPyramid> pyramid;
+
+	void publish(const std::vector<float>& lines, float maxLine,
+		const std::vector<OFS_WaveformPyramid::Bands>& bands, const OFS_WaveformPyramid::Bands& maxBands, uint32_t id) noexcept;
 public:
+	// ffmpeg resamples to this rate and every waveform sample averages SamplesPerLine of them
+	static constexpr int32_t PcmSampleRate = 16000;
+	static constexpr int32_t SamplesPerLine = 100;
+	static constexpr uint32_t PublishIntervalMs = 500;
 
-	inline bool BusyGenerating() noexcept { return generating; }
-	bool GenerateAndLoadFlac(const std::string& ffmpegPath, const std::string& videoPath, const std::string& output) noexcept;
-	bool LoadFlac(const std::string& path) noexcept;
+	inline bool BusyGenerating() const noexcept { return generating; }
+	// streams the audio of the video from ffmpeg and blocks until it's done or cancelled
+	// the partial waveform is published every PublishIntervalMs so it can be drawn while decoding
+	// every line also gets its band amplitudes from an OFS_WaveformSpectrum window ending at the line
+	inline bool Generate(const std::string& ffmpegPath, const std::string& videoPath) noexcept
+	{
+		return Generate(ffmpegPath, videoPath, BeginGeneration());
+	}
+	// id has to come from BeginGeneration, a Cancel after it was taken stops the generation
+	// even when it happens before Generate runs on another thread
+	bool Generate(const std::string& ffmpegPath, const std::string& videoPath, uint32_t id) noexcept;
+	inline uint32_t BeginGeneration() noexcept { return ++generation; }
+	// stops a running Generate, can be called from any thread
+	void Cancel() noexcept;
 
 	inline void Clear() noexcept {
-		samples.clear();
+		SetPyramid(nullptr);
 	}
 
-	inline void SetSamples(std::vector<float>&& samples) noexcept
+	inline void SetPyramid(std::shared_ptr<const OFS_WaveformPyramid> newPyramid) noexcept
 	{
-		this->samples = std::move(samples);
+		std::atomic_store(&pyramid, std::move(newPyramid));
 	}
 
-	inline const std::vector<float>& Samples() const noexcept { return samples; }
+	inline std::shared_ptr<const OFS_WaveformPyramid> Pyramid() const noexcept { return std::atomic_load(&pyramid); }
 
 	inline size_t SampleCount() const noexcept {
-		return samples.size();
+		auto current = Pyramid();
+		return current ? current->SampleCount() : 0;
 	}
 };
 
 struct OFS_WaveformLOD
 {
+	// texels of the visible bins, uploaded into the start of WaveformTex
 	std::vector<float> WaveformLineBuffer;
 	std::unique_ptr<WaveformShader> WaveShader;
 	ImColor WaveformColor = IM_COL32(227, 66, 52, 255);
+	bool SpectralColors = true;
+	float spectralMix = 0.f;
 	uint32_t WaveformTex = 0;
+	uint32_t textureWidth = 0;
 	float samplingOffset = 0.f;
+	float samplingScale = 1.f;
+
+	std::shared_ptr<const OFS_WaveformPyramid> uploadedPyramid;
+	uint32_t lastLevel = 0;
+	int64_t lastFirstBin = 0;
 
-	float lastCanvasX = 0.f;
-	float lastVisibleDuration = 0.f;
-	
-	int32_t lastMultiple = 0.f;
 	OFS_Waveform data;
 
 	void Init() noexcept;
@@ -0,0 +1,124 @@
+#include "OFS_WaveformFft.h"
+
+#include <cmath>
+#include <utility>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define OFS_FFT_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OFS_FFT_SSE 1
+#endif
+
+OFS_WaveformFft::OFS_WaveformFft(uint32_t inSize) noexcept
+	: size(inSize)
+{
+	// the first two stages are fused so at least 4 points are needed
+	if (size < 4) size = 4;
+	while (size & (size - 1)) size += size & ~(size - 1);
+
+	constexpr double Pi = 3.14159265358979323846;
+	twiddleRe.reserve(size);
+	twiddleIm.reserve(size);
+	for (uint32_t stage = 2; stage <= size; stage *= 2) {
+		for (uint32_t k = 0; k < stage / 2; k += 1) {
+			double angle = -2.0 * Pi * k / stage;
+			twiddleRe.emplace_back((float)std::cos(angle));
+			twiddleIm.emplace_back((float)std::sin(angle));
+		}
+	}
+
+	int32_t bits = 0;
+	while ((1u << bits) < size) bits += 1;
+	bitReversed.resize(size);
+	for (uint32_t i = 0; i < size; i += 1) {
+		uint32_t reversed = 0;
+		for (int32_t b = 0; b < bits; b += 1) {
+			if (i & (1u << b)) reversed |= 1u << (bits - 1 - b);
+		}
+		bitReversed[i] = reversed;
+	}
+}
+
+// butterflies of half pairs, a[k] + w[k] b[k] and a[k] - w[k] b[k]
+static inline void butterflies(float* aRe, float* aIm, float* bRe, float* bIm, const float* wRe, const float* wIm, uint32_t half) noexcept
+{
+	uint32_t k = 0;
+#if defined(OFS_FFT_AVX)
+	for (; k + 8 <= half; k += 8) {
+		__m256 br = _mm256_loadu_ps(bRe + k), bi = _mm256_loadu_ps(bIm + k);
+		__m256 wr = _mm256_loadu_ps(wRe + k), wi = _mm256_loadu_ps(wIm + k);
+		__m256 tr = _mm256_sub_ps(_mm256_mul_ps(wr, br), _mm256_mul_ps(wi, bi));
+		__m256 ti = _mm256_add_ps(_mm256_mul_ps(wr, bi), _mm256_mul_ps(wi, br));
+		__m256 ar = _mm256_loadu_ps(aRe + k), ai = _mm256_loadu_ps(aIm + k);
+		_mm256_storeu_ps(bRe + k, _mm256_sub_ps(ar, tr));
+		_mm256_storeu_ps(bIm + k, _mm256_sub_ps(ai, ti));
+		_mm256_storeu_ps(aRe + k, _mm256_add_ps(ar, tr));
+		_mm256_storeu_ps(aIm + k, _mm256_add_ps(ai, ti));
+	}
+#endif
+#if defined(OFS_FFT_AVX) || defined(OFS_FFT_SSE)
+	for (; k + 4 <= half; k += 4) {
+		__m128 br = _mm_loadu_ps(bRe + k), bi = _mm_loadu_ps(bIm + k);
+		__m128 wr = _mm_loadu_ps(wRe + k), wi = _mm_loadu_ps(wIm + k);
+		__m128 tr = _mm_sub_ps(_mm_mul_ps(wr, br), _mm_mul_ps(wi, bi));
+		__m128 ti = _mm_add_ps(_mm_mul_ps(wr, bi), _mm_mul_ps(wi, br));
+		__m128 ar = _mm_loadu_ps(aRe + k), ai = _mm_loadu_ps(aIm + k);
+		_mm_storeu_ps(bRe + k, _mm_sub_ps(ar, tr));
+		_mm_storeu_ps(bIm + k, _mm_sub_ps(ai, ti));
+		_mm_storeu_ps(aRe + k, _mm_add_ps(ar, tr));
+		_mm_storeu_ps(aIm + k, _mm_add_ps(ai, ti));
+	}
+#endif
+	for (; k < half; k += 1) {
+		float tRe = wRe[k] * bRe[k] - wIm[k] * bIm[k];
+		float tIm = wRe[k] * bIm[k] + wIm[k] * bRe[k];
+		bRe[k] = aRe[k] - tRe;
+		bIm[k] = aIm[k] - tIm;
+		aRe[k] += tRe;
+		aIm[k] += tIm;
+	}
+}
+
+void OFS_WaveformFft::Forward(float* re, float* im) const noexcept
+{
+	for (uint32_t i = 0; i < size; i += 1) {
+		uint32_t j = bitReversed[i];
+		if (i < j) {
+			std::swap(re[i], re[j]);
+			std::swap(im[i], im[j]);
+		}
+	}
+	ForwardBitReversed(re, im);
+}
+
+void OFS_WaveformFft::ForwardBitReversed(float* re, float* im) const noexcept
+{
+	// the first two radix-2 stages only have the twiddles 1 and -i so they run as one radix-4 stage
+	for (uint32_t start = 0; start < size; start += 4) {
+		float* r = re + start;
+		float* i = im + start;
+		float sum01Re = r[0] + r[1], sum01Im = i[0] + i[1];
+		float dif01Re = r[0] - r[1], dif01Im = i[0] - i[1];
+		float sum23Re = r[2] + r[3], sum23Im = i[2] + i[3];
+		float dif23Re = r[2] - r[3], dif23Im = i[2] - i[3];
+		r[0] = sum01Re + sum23Re; i[0] = sum01Im + sum23Im;
+		r[2] = sum01Re - sum23Re; i[2] = sum01Im - sum23Im;
+		// -i * dif23
+		r[1] = dif01Re + dif23Im; i[1] = dif01Im - dif23Re;
+		r[3] = dif01Re - dif23Im; i[3] = dif01Im + dif23Re;
+	}
+
+	// radix-2 for the rest, the twiddles of the size 2 and 4 stages are skipped
+	const float* stageRe = twiddleRe.data() + 3;
+	const float* stageIm = twiddleIm.data() + 3;
+	for (uint32_t stage = 8; stage <= size; stage *= 2) {
+		uint32_t half = stage / 2;
+		for (uint32_t start = 0; start < size; start += stage) {
+			butterflies(re + start, im + start, re + start + half, im + start + half, stageRe, stageIm, half);
+		}
+		stageRe += half;
+		stageIm += half;
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+// In place radix-2 complex FFT of a fixed power of two size.
+// Split real and imaginary parts keep the butterflies free of std::complex overhead and vectorizable.
+class OFS_WaveformFft
+{
+	uint32_t size = 0;
+	// twiddles of every stage are stored back to back so the inner loop reads them contiguously
+	std::vector<float> twiddleRe;
+	std::vector<float> twiddleIm;
+	std::vector<uint32_t> bitReversed;
+
+public:
+	// the size is rounded up to a power of two of at least 4
+	explicit OFS_WaveformFft(uint32_t size) noexcept;
+
+	inline uint32_t Size() const noexcept { return size; }
+	// ForwardBitReversed expects input i at BitReversed()[i]
+	inline const std::vector<uint32_t>& BitReversed() const noexcept { return bitReversed; }
+
+	void Forward(float* re, float* im) const noexcept;
+	// skips the permutation when the caller already wrote the input in bit reversed order
+	void ForwardBitReversed(float* re, float* im) const noexcept;
+	// the inverse is the forward transform with real and imaginary parts swapped, it isn't scaled by 1 / Size
+	inline void InverseUnscaled(float* re, float* im) const noexcept { Forward(im, re); }
+};
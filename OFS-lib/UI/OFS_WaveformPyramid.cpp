@@ -0,0 +1,91 @@
+#include "OFS_WaveformPyramid.h"
+#include "OFS_Profiling.h"
+
+#include <algorithm>
+#include <cmath>
+
+inline static OFS_WaveformPyramid::Bin mergeBins(const OFS_WaveformPyramid::Bin& a, const OFS_WaveformPyramid::Bin& b) noexcept
+{
+	OFS_WaveformPyramid::Bin bin;
+	bin.Min = std::min(a.Min, b.Min);
+	bin.Max = std::max(a.Max, b.Max);
+	bin.Rms = std::sqrt((a.Rms * a.Rms + b.Rms * b.Rms) * 0.5f);
+	return bin;
+}
+
+inline static OFS_WaveformPyramid::Bands mergeBands(const OFS_WaveformPyramid::Bands& a, const OFS_WaveformPyramid::Bands& b) noexcept
+{
+	return OFS_WaveformPyramid::Bands{ (a.Low + b.Low) * 0.5f, (a.Mid + b.Mid) * 0.5f, (a.High + b.High) * 0.5f };
+}
+
+template<typename T, typename Merge>
+inline static std::vector<T> reduceLevel(const std::vector<T>& prev, Merge merge) noexcept
+{
+	std::vector<T> next;
+	next.reserve((prev.size() + 1) / 2);
+	for (size_t i = 0; i < prev.size(); i += 2) {
+		// an odd tail bin only covers one entry
+		next.emplace_back(i + 1 < prev.size() ? merge(prev[i], prev[i + 1]) : prev[i]);
+	}
+	return next;
+}
+
+OFS_WaveformPyramid::OFS_WaveformPyramid(std::vector<float>&& inSamples, float samplesPerSecond, std::vector<Bands>&& bands) noexcept
+	: samples(std::move(inSamples)), samplesPerSecond(samplesPerSecond)
+{
+	OFS_PROFILE(__FUNCTION__);
+	size_t count = samples.size();
+	if (bands.size() == count) sampleBands = std::move(bands);
+	if (count < 2) return;
+
+	auto& first = levels.emplace_back();
+	first.reserve((count + 1) / 2);
+	for (size_t i = 0; i < count; i += 2) {
+		Bin a{ samples[i], samples[i], std::abs(samples[i]) };
+		first.emplace_back(i + 1 < count ? mergeBins(a, Bin{ samples[i + 1], samples[i + 1], std::abs(samples[i + 1]) }) : a);
+	}
+	while (levels.back().size() > 1) {
+		levels.emplace_back(reduceLevel(levels.back(), mergeBins));
+	}
+
+	if (!sampleBands.empty()) {
+		levelBands.emplace_back(reduceLevel(sampleBands, mergeBands));
+		while (levelBands.size() < levels.size()) {
+			levelBands.emplace_back(reduceLevel(levelBands.back(), mergeBands));
+		}
+	}
+}
+
+OFS_WaveformPyramid::Bin OFS_WaveformPyramid::GetBin(uint32_t level, size_t idx) const noexcept
+{
+	if (level == 0) {
+		float sample = samples[idx];
+		return Bin{ sample, sample, std::abs(sample) };
+	}
+	return levels[level - 1][idx];
+}
+
+void OFS_WaveformPyramid::Texels(uint32_t level, int64_t firstBin, size_t count, float* outTexels) const noexcept
+{
+	int64_t binCount = BinCount(level);
+	const Bands* bands = nullptr;
+	if (!sampleBands.empty()) {
+		bands = level == 0 ? sampleBands.data() : levelBands[level - 1].data();
+	}
+
+	for (size_t i = 0; i < count; i += 1) {
+		float* texel = outTexels + i * TexelComponents;
+		int64_t idx = firstBin + (int64_t)i;
+		if (idx < 0 || idx >= binCount) {
+			texel[0] = texel[1] = texel[2] = texel[3] = 0.f;
+			continue;
+		}
+
+		texel[0] = level == 0 ? std::abs(samples[idx]) : levels[level - 1][idx].Peak();
+		float total = bands ? bands[idx].Low + bands[idx].Mid + bands[idx].High : 0.f;
+		float scale = total > 0.f ? 1.f / total : 0.f;
+		texel[1] = bands ? bands[idx].Low * scale : 0.f;
+		texel[2] = bands ? bands[idx].Mid * scale : 0.f;
+		texel[3] = bands ? bands[idx].High * scale : 0.f;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Power-of-two reduction of the waveform samples.
+// Level 0 are the samples themselves, every level above halves the previous one
+// so any zoom can be drawn from the level whose bins are closest to one bar.
+class OFS_WaveformPyramid
+{
+public:
+	struct Bin {
+		float Min = 0.f;
+		float Max = 0.f;
+		float Rms = 0.f;
+		// amplitude shown by the timeline
+		inline float Peak() const noexcept { return Max > -Min ? Max : -Min; }
+	};
+
+	// amplitude per frequency band of a sample, see OFS_WaveformSpectrum
+	struct Bands {
+		float Low = 0.f;
+		float Mid = 0.f;
+		float High = 0.f;
+	};
+	// every bin is uploaded as the peak followed by the share of each band
+	static constexpr int32_t TexelComponents = 4;
+
+private:
+	std::vector<float> samples;
+	// levels[0] holds bins of two samples
+	std::vector<std::vector<Bin>> levels;
+	// empty or one entry per sample and bin, averaged going up the levels
+	std::vector<Bands> sampleBands;
+	std::vector<std::vector<Bands>> levelBands;
+	// zero when the samples are spread over the whole media
+	float samplesPerSecond = 0.f;
+
+public:
+	explicit OFS_WaveformPyramid(std::vector<float>&& samples, float samplesPerSecond = 0.f, std::vector<Bands>&& bands = {}) noexcept;
+
+	inline float SamplesPerSecond() const noexcept { return samplesPerSecond; }
+
+	inline const std::vector<float>& Samples() const noexcept { return samples; }
+	inline const std::vector<Bands>& SampleBands() const noexcept { return sampleBands; }
+	inline bool HasBands() const noexcept { return !sampleBands.empty(); }
+	inline size_t SampleCount() const noexcept { return samples.size(); }
+	inline uint32_t LevelCount() const noexcept { return levels.size() + 1; }
+	// number of bins of 1 << level samples
+	inline size_t BinCount(uint32_t level) const noexcept { return level == 0 ? samples.size() : levels[level - 1].size(); }
+
+	Bin GetBin(uint32_t level, size_t idx) const noexcept;
+	// writes TexelComponents floats for count bins starting at firstBin, bins outside of the samples are silent
+	void Texels(uint32_t level, int64_t firstBin, size_t count, float* outTexels) const noexcept;
+};
@@ -0,0 +1,57 @@
+#include "OFS_WaveformSpectrum.h"
+
+#include <cmath>
+
+OFS_WaveformSpectrum::OFS_WaveformSpectrum(int32_t sampleRate) noexcept
+	: fft(HalfSize)
+{
+	constexpr double Pi = 3.14159265358979323846;
+	for (int32_t k = 0; k < HalfSize; k += 1) {
+		double angle = -2.0 * Pi * k / FftSize;
+		unpackRe.emplace_back((float)std::cos(angle));
+		unpackIm.emplace_back((float)std::sin(angle));
+	}
+
+	// hann
+	window.resize(FftSize);
+	for (int32_t i = 0; i < FftSize; i += 1) {
+		window[i] = (float)(0.5 - 0.5 * std::cos(2.0 * Pi * i / (FftSize - 1)));
+	}
+	re.resize(HalfSize);
+	im.resize(HalfSize);
+
+	float binHz = (float)sampleRate / FftSize;
+	lowMidBin = (int32_t)std::round(LowMidHz / binHz);
+	midHighBin = (int32_t)std::round(MidHighHz / binHz);
+}
+
+OFS_WaveformPyramid::Bands OFS_WaveformSpectrum::Analyze(const float* pcm) noexcept
+{
+	// even samples go into the real and odd ones into the imaginary part
+	auto& bitReversed = fft.BitReversed();
+	for (int32_t i = 0; i < HalfSize; i += 1) {
+		re[bitReversed[i]] = pcm[2 * i] * window[2 * i];
+		im[bitReversed[i]] = pcm[2 * i + 1] * window[2 * i + 1];
+	}
+	fft.ForwardBitReversed(re.data(), im.data());
+
+	// X[k] = (Z[k] + conj(Z[n-k])) / 2 - i e^(-2 pi i k / FftSize) (Z[k] - conj(Z[n-k])) / 2
+	// only bins below nyquist matter for real input, dc is skipped
+	auto bandPower = [this](int32_t first, int32_t last) noexcept {
+		float sum = 0.f;
+		for (int32_t bin = first; bin < last; bin += 1) {
+			float zRe = re[bin], zIm = im[bin];
+			float cRe = re[HalfSize - bin], cIm = -im[HalfSize - bin];
+			float evenRe = 0.5f * (zRe + cRe), evenIm = 0.5f * (zIm + cIm);
+			float oddRe = 0.5f * (zIm - cIm), oddIm = -0.5f * (zRe - cRe);
+			float xRe = evenRe + unpackRe[bin] * oddRe - unpackIm[bin] * oddIm;
+			float xIm = evenIm + unpackRe[bin] * oddIm + unpackIm[bin] * oddRe;
+			sum += xRe * xRe + xIm * xIm;
+		}
+		return sum;
+	};
+	float low = bandPower(1, lowMidBin);
+	float mid = bandPower(lowMidBin, midHighBin);
+	float high = bandPower(midHighBin, HalfSize);
+	return OFS_WaveformPyramid::Bands{ std::sqrt(low), std::sqrt(mid), std::sqrt(high) };
+}
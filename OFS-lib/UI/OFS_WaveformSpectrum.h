@@ -0,0 +1,37 @@
+#pragma once
+
+#include "OFS_WaveformPyramid.h"
+#include "OFS_WaveformFft.h"
+
+#include <vector>
+#include <cstdint>
+
+// Short-time Fourier transform of the waveform PCM reduced to three bands.
+// Low is roughly kicks and bass, mid vocals and most instruments, high hats and noise.
+class OFS_WaveformSpectrum
+{
+public:
+	static constexpr int32_t FftSize = 512;
+	static constexpr float LowMidHz = 250.f;
+	static constexpr float MidHighHz = 2000.f;
+
+private:
+	// the real input is packed into a complex fft of half the size
+	static constexpr int32_t HalfSize = FftSize / 2;
+
+	OFS_WaveformFft fft;
+	// e^(-2 pi i k / FftSize) to unpack the half size result
+	std::vector<float> unpackRe;
+	std::vector<float> unpackIm;
+	std::vector<float> window;
+	std::vector<float> re;
+	std::vector<float> im;
+	int32_t lowMidBin = 0;
+	int32_t midHighBin = 0;
+
+public:
+	explicit OFS_WaveformSpectrum(int32_t sampleRate) noexcept;
+
+	// amplitude of every band in the FftSize samples starting at pcm
+	OFS_WaveformPyramid::Bands Analyze(const float* pcm) noexcept;
+};
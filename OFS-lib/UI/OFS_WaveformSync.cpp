@@ -0,0 +1,423 @@
+#include "OFS_WaveformSync.h"
+#include "OFS_WaveformFft.h"
+#include "OFS_ParallelFor.h"
+#include "OFS_Profiling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// blocks are searched in the whole reference at a quarter of the waveform rate and refined at the full rate
+static constexpr int32_t Decimation = 4;
+// seconds of the moving mean which is subtracted from the log envelope
+static constexpr float DetrendSeconds = 1.f;
+// best offsets of a block which take part in the path search and how far apart they have to be
+static constexpr int32_t CandidateCount = 4;
+static constexpr float CandidateSpacingSeconds = 1.f;
+static constexpr float MinSegmentSeconds = 0.5f;
+
+struct Candidate {
+	// position of the block start in the reference minus the block start
+	int32_t Offset = 0;
+	float Score = 0.f;
+};
+
+// a run of blocks sharing one offset, the offset is Intercept + Slope * t in full rate samples
+struct Run {
+	int32_t FirstBlock = 0;
+	int32_t LastBlock = 0;
+	double Intercept = 0.0;
+	double Slope = 0.0;
+	double Start = 0.0;
+	double End = 0.0;
+	float Score = 0.f;
+};
+
+// log amplitude minus its moving mean scaled to unit variance, gain and encoder differences mostly cancel out
+static std::vector<float> envelopeFeatures(const OFS_WaveformPyramid& pyramid) noexcept
+{
+	auto& samples = pyramid.Samples();
+	int32_t count = (int32_t)samples.size();
+	std::vector<double> prefix(count + 1, 0.0);
+	std::vector<float> features(count);
+	for (int32_t i = 0; i < count; i += 1) {
+		features[i] = std::log(samples[i] + 1e-3f);
+		prefix[i + 1] = prefix[i] + features[i];
+	}
+
+	int32_t radius = std::max(1, (int32_t)(DetrendSeconds * pyramid.SamplesPerSecond()));
+	double energy = 0.0;
+	for (int32_t i = 0; i < count; i += 1) {
+		int32_t first = std::max(0, i - radius);
+		int32_t last = std::min(count, i + radius + 1);
+		features[i] -= (float)((prefix[last] - prefix[first]) / (last - first));
+		energy += (double)features[i] * features[i];
+	}
+	float scale = energy > 0.0 ? (float)(1.0 / std::sqrt(energy / count)) : 0.f;
+	for (auto& feature : features) feature *= scale;
+	return features;
+}
+
+static std::vector<float> decimate(const std::vector<float>& features) noexcept
+{
+	std::vector<float> coarse(features.size() / Decimation);
+	for (size_t i = 0; i < coarse.size(); i += 1) {
+		float sum = 0.f;
+		for (int32_t j = 0; j < Decimation; j += 1) sum += features[i * Decimation + j];
+		coarse[i] = sum / Decimation;
+	}
+	return coarse;
+}
+
+static std::vector<double> energyPrefix(const std::vector<float>& values) noexcept
+{
+	std::vector<double> prefix(values.size() + 1, 0.0);
+	for (size_t i = 0; i < values.size(); i += 1) {
+		prefix[i + 1] = prefix[i] + (double)values[i] * values[i];
+	}
+	return prefix;
+}
+
+// dot product of cur[first, last) with ref shifted by offset, over the part which overlaps
+static double overlapDot(const std::vector<float>& cur, const std::vector<float>& ref, int64_t first, int64_t last, int64_t offset) noexcept
+{
+	first = std::max(first, -offset);
+	last = std::min(last, (int64_t)ref.size() - offset);
+	double sum = 0.0;
+	for (int64_t t = first; t < last; t += 1) {
+		sum += (double)cur[t] * ref[t + offset];
+	}
+	return sum;
+}
+
+static double overlapEnergy(const std::vector<double>& prefix, int64_t first, int64_t last) noexcept
+{
+	int64_t count = (int64_t)prefix.size() - 1;
+	first = std::max<int64_t>(first, 0);
+	last = std::min(last, count);
+	return last > first ? prefix[last] - prefix[first] : 0.0;
+}
+
+// best correlation peaks of a block at least spacing apart, corr is the unscaled circular correlation
+static void pickCandidates(const float* corr, uint32_t n, int32_t blockStart, int32_t length, double blockEnergy,
+	const std::vector<double>& refEnergy, int32_t spacing, std::vector<Candidate>& out) noexcept
+{
+	out.clear();
+	if (blockEnergy <= 0.0) return;
+	int32_t refCount = (int32_t)refEnergy.size() - 1;
+	// at least half the block has to overlap the reference
+	int32_t minPos = -length / 2;
+	int32_t maxPos = refCount - (length + 1) / 2;
+	if (maxPos < minPos) return;
+
+	std::vector<float> scores(maxPos - minPos + 1);
+	for (int32_t pos = minPos; pos <= maxPos; pos += 1) {
+		double energy = overlapEnergy(refEnergy, pos, pos + length);
+		float value = corr[pos < 0 ? pos + (int32_t)n : pos] / (float)n;
+		scores[pos - minPos] = energy > 0.0 ? (float)(value / std::sqrt(blockEnergy * energy)) : 0.f;
+	}
+	for (int32_t c = 0; c < CandidateCount; c += 1) {
+		auto best = std::max_element(scores.begin(), scores.end());
+		if (*best <= 0.f) break;
+		int32_t idx = (int32_t)(best - scores.begin());
+		out.emplace_back(Candidate{ idx + minPos - blockStart, *best });
+		int32_t first = std::max(0, idx - spacing);
+		int32_t last = std::min((int32_t)scores.size(), idx + spacing + 1);
+		std::fill(scores.begin() + first, scores.begin() + last, 0.f);
+	}
+}
+
+bool OFS_WaveformSync::Align(const OFS_WaveformPyramid& current, const OFS_WaveformPyramid& reference,
+	const std::atomic<bool>& cancel, std::vector<Segment>& outSegments) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	outSegments.clear();
+	const float fps = current.SamplesPerSecond();
+	if (fps <= 0.f || reference.SamplesPerSecond() != fps) return true;
+
+	auto cur = envelopeFeatures(current);
+	auto ref = envelopeFeatures(reference);
+	auto curCoarse = decimate(cur);
+	auto refCoarse = decimate(ref);
+	const float coarseFps = fps / Decimation;
+	const int32_t blockLength = std::max(1, (int32_t)std::round(BlockSeconds * coarseFps));
+	const int32_t curCount = (int32_t)curCoarse.size();
+	const int32_t refCount = (int32_t)refCoarse.size();
+	if (curCount < blockLength / 4 || refCount < blockLength / 4) return true;
+
+	// a short tail is merged into the last block
+	const int32_t blockCount = std::max(1, (curCount + blockLength / 4) / blockLength);
+	auto blockStart = [&](int32_t b) noexcept { return b * blockLength; };
+	auto blockEnd = [&](int32_t b) noexcept { return b == blockCount - 1 ? curCount : (b + 1) * blockLength; };
+
+	// zero padded so the correlation doesn't wrap for blocks of up to twice the block length
+	OFS_WaveformFft fft(refCount + 2 * blockLength);
+	const uint32_t n = fft.Size();
+	std::vector<float> refRe(n, 0.f), refIm(n, 0.f);
+	std::copy(refCoarse.begin(), refCoarse.end(), refRe.begin());
+	fft.Forward(refRe.data(), refIm.data());
+	auto refCoarseEnergy = energyPrefix(refCoarse);
+	auto curCoarseEnergy = energyPrefix(curCoarse);
+	if (cancel) return false;
+
+	// two real blocks go through one complex transform, one as the real and one as the imaginary part
+	std::vector<std::vector<Candidate>> candidates(blockCount);
+	const int32_t spacing = std::max(1, (int32_t)(CandidateSpacingSeconds * coarseFps));
+	OFS::ParallelFor((blockCount + 1) / 2, [&](uint32_t pair) noexcept {
+		if (cancel) return;
+		int32_t first = 2 * pair;
+		int32_t second = first + 1;
+		std::vector<float> re(n, 0.f), im(n, 0.f);
+		std::copy(curCoarse.begin() + blockStart(first), curCoarse.begin() + blockEnd(first), re.begin());
+		if (second < blockCount) {
+			std::copy(curCoarse.begin() + blockStart(second), curCoarse.begin() + blockEnd(second), im.begin());
+		}
+		fft.Forward(re.data(), im.data());
+
+		// A = (Z[k] + conj(Z[n-k])) / 2, B = (Z[k] - conj(Z[n-k])) / 2i
+		// both correlations are real so conj(A) R + i conj(B) R transforms back to corrA + i corrB
+		std::vector<float> qRe(n), qIm(n);
+		for (uint32_t k = 0; k < n; k += 1) {
+			uint32_t m = (n - k) & (n - 1);
+			float aRe = 0.5f * (re[k] + re[m]), aIm = 0.5f * (im[k] - im[m]);
+			float bRe = 0.5f * (im[k] + im[m]), bIm = -0.5f * (re[k] - re[m]);
+			float rRe = refRe[k], rIm = refIm[k];
+			float pRe = aRe * rRe + aIm * rIm, pIm = aRe * rIm - aIm * rRe;
+			float sRe = bRe * rRe + bIm * rIm, sIm = bRe * rIm - bIm * rRe;
+			qRe[k] = pRe - sIm;
+			qIm[k] = pIm + sRe;
+		}
+		fft.InverseUnscaled(qRe.data(), qIm.data());
+
+		auto pick = [&](int32_t block, const float* corr) noexcept {
+			double energy = overlapEnergy(curCoarseEnergy, blockStart(block), blockEnd(block));
+			pickCandidates(corr, n, blockStart(block), blockEnd(block) - blockStart(block), energy,
+				refCoarseEnergy, spacing, candidates[block]);
+		};
+		pick(first, qRe.data());
+		if (second < blockCount) pick(second, qIm.data());
+	}, "OFS_WaveformSync");
+	if (cancel) return false;
+
+	// the path through the candidates with the highest score, every change of the offset costs CutPenalty
+	// the last state of every block stands for a block which is missing from the reference
+	auto sameOffset = [&](int32_t blockA, int32_t stateA, int32_t blockB, int32_t stateB) noexcept {
+		bool missingA = stateA == (int32_t)candidates[blockA].size();
+		bool missingB = stateB == (int32_t)candidates[blockB].size();
+		if (missingA || missingB) return missingA == missingB;
+		return std::abs(candidates[blockA][stateA].Offset - candidates[blockB][stateB].Offset) <= 1;
+	};
+	auto stateScore = [&](int32_t block, int32_t state) noexcept {
+		return state == (int32_t)candidates[block].size() ? MinScore : candidates[block][state].Score;
+	};
+	std::vector<std::vector<float>> totals(blockCount);
+	std::vector<std::vector<int32_t>> from(blockCount);
+	for (int32_t b = 0; b < blockCount; b += 1) {
+		int32_t stateCount = (int32_t)candidates[b].size() + 1;
+		totals[b].resize(stateCount);
+		from[b].resize(stateCount, -1);
+		for (int32_t s = 0; s < stateCount; s += 1) {
+			float best = 0.f;
+			if (b > 0) {
+				best = -std::numeric_limits<float>::max();
+				for (int32_t p = 0; p < (int32_t)totals[b - 1].size(); p += 1) {
+					float total = totals[b - 1][p] - (sameOffset(b - 1, p, b, s) ? 0.f : CutPenalty);
+					if (total > best) {
+						best = total;
+						from[b][s] = p;
+					}
+				}
+			}
+			totals[b][s] = best + stateScore(b, s);
+		}
+	}
+	std::vector<int32_t> path(blockCount);
+	path.back() = (int32_t)(std::max_element(totals.back().begin(), totals.back().end()) - totals.back().begin());
+	for (int32_t b = blockCount - 1; b > 0; b -= 1) {
+		path[b - 1] = from[b][path[b]];
+	}
+
+	// the offset of every matched block at the full rate, the coarse one is only accurate to Decimation samples
+	auto fullEnergy = energyPrefix(cur);
+	auto refFullEnergy = energyPrefix(ref);
+	const int64_t fullCount = (int64_t)cur.size();
+	auto fullStart = [&](int32_t b) noexcept { return (int64_t)blockStart(b) * Decimation; };
+	auto fullEnd = [&](int32_t b) noexcept { return b == blockCount - 1 ? fullCount : (int64_t)blockEnd(b) * Decimation; };
+	auto normalizedDot = [&](int64_t first, int64_t last, int64_t offset) noexcept {
+		double energy = overlapEnergy(fullEnergy, first, last) * overlapEnergy(refFullEnergy, first + offset, last + offset);
+		return energy > 0.0 ? overlapDot(cur, ref, first, last, offset) / std::sqrt(energy) : 0.0;
+	};
+	std::vector<double> blockOffsets(blockCount, 0.0);
+	std::vector<float> blockScores(blockCount, 0.f);
+	OFS::ParallelFor(blockCount, [&](uint32_t b) noexcept {
+		if (cancel || path[b] == (int32_t)candidates[b].size()) return;
+		int64_t center = (int64_t)candidates[b][path[b]].Offset * Decimation;
+		constexpr int32_t Radius = Decimation + 2;
+		double dots[2 * Radius + 1];
+		int32_t best = 0;
+		for (int32_t i = 0; i <= 2 * Radius; i += 1) {
+			dots[i] = normalizedDot(fullStart(b), fullEnd(b), center + i - Radius);
+			if (dots[i] > dots[best]) best = i;
+		}
+		// parabola through the peak and its neighbours
+		double shift = 0.0;
+		if (best > 0 && best < 2 * Radius) {
+			double denom = dots[best - 1] - 2.0 * dots[best] + dots[best + 1];
+			if (denom < 0.0) shift = 0.5 * (dots[best - 1] - dots[best + 1]) / denom;
+		}
+		blockOffsets[b] = (double)(center + best - Radius) + shift;
+		blockScores[b] = (float)dots[best];
+	}, "OFS_WaveformSync");
+	if (cancel) return false;
+
+	// consecutive matched blocks on the same offset become a run with a line through their offsets
+	std::vector<Run> runs;
+	std::vector<int32_t> blockRun(blockCount, -1);
+	for (int32_t b = 0; b < blockCount; b += 1) {
+		if (path[b] == (int32_t)candidates[b].size()) continue;
+		if (b == 0 || blockRun[b - 1] < 0 || !sameOffset(b - 1, path[b - 1], b, path[b])) {
+			runs.emplace_back().FirstBlock = b;
+		}
+		runs.back().LastBlock = b;
+		blockRun[b] = (int32_t)runs.size() - 1;
+	}
+	for (auto& run : runs) {
+		double sumW = 0.0, sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0, sumScore = 0.0;
+		for (int32_t b = run.FirstBlock; b <= run.LastBlock; b += 1) {
+			double w = std::max((double)blockScores[b], 1e-3);
+			w *= w;
+			double x = 0.5 * (fullStart(b) + fullEnd(b));
+			double y = blockOffsets[b];
+			sumW += w; sumX += w * x; sumY += w * y; sumXX += w * x * x; sumXY += w * x * y;
+			sumScore += blockScores[b];
+		}
+		double meanX = sumX / sumW, meanY = sumY / sumW;
+		double varX = sumXX / sumW - meanX * meanX;
+		// a speed difference needs a few blocks to be told apart from noise
+		if (run.LastBlock - run.FirstBlock >= 2 && varX > 0.0) {
+			run.Slope = std::clamp((sumXY / sumW - meanX * meanY) / varX, -(double)MaxDrift, (double)MaxDrift);
+		}
+		run.Intercept = meanY - run.Slope * meanX;
+		run.Start = (double)fullStart(run.FirstBlock);
+		run.End = (double)fullEnd(run.LastBlock);
+		run.Score = (float)(sumScore / (run.LastBlock - run.FirstBlock + 1));
+	}
+
+	// a cut lies in one of the two blocks around a change, it goes where the agreement of the left side
+	// with its offset and the right side with its offset is highest
+	auto agreement = [&](const Run* run, int64_t t) noexcept {
+		if (!run) return 0.0;
+		int64_t refIdx = t + (int64_t)std::llround(run->Intercept + run->Slope * t);
+		return refIdx >= 0 && refIdx < (int64_t)ref.size() ? (double)cur[t] * ref[refIdx] : 0.0;
+	};
+	double previousCut = 0.0;
+	for (int32_t b = 0; b + 1 < blockCount; b += 1) {
+		int32_t leftIdx = blockRun[b], rightIdx = blockRun[b + 1];
+		if (leftIdx == rightIdx) continue;
+		Run* left = leftIdx >= 0 ? &runs[leftIdx] : nullptr;
+		Run* right = rightIdx >= 0 ? &runs[rightIdx] : nullptr;
+		int64_t first = std::max((int64_t)std::ceil(previousCut), fullStart(b));
+		int64_t last = fullEnd(b + 1);
+		double sum = 0.0, bestSum = 0.0;
+		int64_t cut = first;
+		for (int64_t t = first; t < last; t += 1) {
+			sum += agreement(left, t) - agreement(right, t);
+			if (sum > bestSum) {
+				bestSum = sum;
+				cut = t + 1;
+			}
+		}
+		if (left) left->End = (double)cut;
+		if (right) right->Start = (double)cut;
+		previousCut = (double)cut;
+	}
+
+	// clipped to the reference so every segment maps onto audio which exists there
+	const double refLength = (double)ref.size();
+	for (auto& run : runs) {
+		double scale = 1.0 + run.Slope;
+		double start = std::max(run.Start, (0.0 - run.Intercept) / scale);
+		double end = std::min(run.End, (refLength - run.Intercept) / scale);
+		if ((end - start) / fps < MinSegmentSeconds) continue;
+		Segment segment;
+		segment.CurrentStart = (float)(start / fps);
+		segment.CurrentEnd = (float)(end / fps);
+		segment.ReferenceStart = (float)((start * scale + run.Intercept) / fps);
+		segment.ReferenceEnd = (float)((end * scale + run.Intercept) / fps);
+		segment.Score = run.Score;
+		outSegments.emplace_back(segment);
+	}
+	return true;
+}
+
+bool OFS_WaveformSync::ToCurrentTime(const std::vector<Segment>& segments, float referenceTime, float* outCurrentTime) noexcept
+{
+	for (auto& segment : segments) {
+		if (referenceTime < segment.ReferenceStart || referenceTime > segment.ReferenceEnd) continue;
+		float referenceLength = segment.ReferenceEnd - segment.ReferenceStart;
+		float progress = referenceLength > 0.f ? (referenceTime - segment.ReferenceStart) / referenceLength : 0.f;
+		*outCurrentTime = segment.CurrentStart + progress * (segment.CurrentEnd - segment.CurrentStart);
+		return true;
+	}
+	return false;
+}
+
+int OFS_WaveformSync::syncThread(void* user) noexcept
+{
+	auto sync = static_cast<OFS_WaveformSync*>(user);
+	auto newResult = std::make_shared<Result>();
+	newResult->Source = sync->input;
+	newResult->ReferencePath = sync->inputReferencePath;
+
+	if (sync->decodedReferencePath != sync->inputReferencePath && !sync->cancelled) {
+		sync->stage = Stage::DecodingReference;
+		sync->decodedReferencePath.clear();
+		sync->reference.Clear();
+		if (sync->reference.Generate(sync->inputFfmpegPath, sync->inputReferencePath, sync->referenceGeneration)) {
+			sync->decodedReferencePath = sync->inputReferencePath;
+		}
+	}
+
+	auto referencePyramid = sync->reference.Pyramid();
+	newResult->Decoded = referencePyramid && sync->decodedReferencePath == sync->inputReferencePath;
+	bool aligned = true;
+	if (newResult->Decoded && !sync->cancelled) {
+		sync->stage = Stage::Aligning;
+		aligned = Align(*sync->input, *referencePyramid, sync->cancelled, newResult->Segments);
+	}
+	if (aligned && !sync->cancelled) {
+		std::atomic_store(&sync->result, std::shared_ptr<const Result>(std::move(newResult)));
+	}
+	sync->stage = Stage::Idle;
+	return 0;
+}
+
+void OFS_WaveformSync::Start(std::shared_ptr<const OFS_WaveformPyramid> current, const std::string& ffmpegPath, const std::string& referencePath) noexcept
+{
+	Cancel();
+	// nothing to align without the sample rate of the current waveform
+	if (!current || current->SamplesPerSecond() <= 0.f) return;
+	input = std::move(current);
+	inputFfmpegPath = ffmpegPath;
+	inputReferencePath = referencePath;
+	cancelled = false;
+	referenceGeneration = reference.BeginGeneration();
+	stage = Stage::DecodingReference;
+	thread = SDL_CreateThread(syncThread, "OFS_WaveformSync", this);
+	if (!thread) stage = Stage::Idle;
+}
+
+void OFS_WaveformSync::Cancel() noexcept
+{
+	cancelled = true;
+	reference.Cancel();
+	if (thread) {
+		SDL_WaitThread(thread, nullptr);
+		thread = nullptr;
+	}
+}
+
+OFS_WaveformSync::~OFS_WaveformSync() noexcept
+{
+	Cancel();
+}
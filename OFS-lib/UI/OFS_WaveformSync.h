@@ -0,0 +1,89 @@
+#pragma once
+
+#include "OFS_Waveform.h"
+#include "OFS_WaveformPyramid.h"
+#include "SDL_thread.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+
+// Aligns the audio of the current media to a reference media, e.g. the encode a script was made for.
+// Blocks of the log amplitude envelope are cross-correlated with the whole reference through FFTs,
+// the offsets which explain most blocks with the fewest changes become a piecewise linear time warp.
+class OFS_WaveformSync
+{
+public:
+	// seconds of the current media per cross-correlated block
+	static constexpr float BlockSeconds = 20.f;
+	// normalized correlation below which a block counts as missing from the reference
+	static constexpr float MinScore = 0.3f;
+	// cost of a cut against the block scores
+	static constexpr float CutPenalty = 0.5f;
+	// the largest speed difference between the media which is corrected within a segment
+	static constexpr float MaxDrift = 0.002f;
+
+	// maps [CurrentStart, CurrentEnd) of the current media linearly to [ReferenceStart, ReferenceEnd)
+	struct Segment {
+		float CurrentStart = 0.f;
+		float CurrentEnd = 0.f;
+		float ReferenceStart = 0.f;
+		float ReferenceEnd = 0.f;
+		// mean normalized correlation of the blocks in the segment
+		float Score = 0.f;
+	};
+
+	enum class Stage : int32_t {
+		Idle,
+		DecodingReference,
+		Aligning
+	};
+
+	struct Result {
+		std::shared_ptr<const OFS_WaveformPyramid> Source;
+		std::string ReferencePath;
+		// false when the reference couldn't be decoded
+		bool Decoded = false;
+		// ordered by CurrentStart
+		std::vector<Segment> Segments;
+	};
+
+private:
+	SDL_Thread* thread = nullptr;
+	std::atomic<Stage> stage = Stage::Idle;
+	std::atomic<bool> cancelled = false;
+	// replaced by the sync thread, read by the main thread
+	std::shared_ptr<const Result> result;
+	// decodes the reference, kept across runs so the same reference isn't decoded twice
+	OFS_Waveform reference;
+	// taken by Start on the calling thread so a Cancel before the decode starts still reaches it
+	uint32_t referenceGeneration = 0;
+	std::string decodedReferencePath;
+
+	std::shared_ptr<const OFS_WaveformPyramid> input;
+	std::string inputFfmpegPath;
+	std::string inputReferencePath;
+
+	static int syncThread(void* user) noexcept;
+
+public:
+	OFS_WaveformSync() noexcept = default;
+	OFS_WaveformSync(const OFS_WaveformSync&) = delete;
+	~OFS_WaveformSync() noexcept;
+
+	// decodes the reference with ffmpeg and aligns the current waveform to it on a background thread
+	void Start(std::shared_ptr<const OFS_WaveformPyramid> current, const std::string& ffmpegPath, const std::string& referencePath) noexcept;
+	// stops and waits for a running sync
+	void Cancel() noexcept;
+
+	inline Stage CurrentStage() const noexcept { return stage; }
+	inline bool Busy() const noexcept { return stage != Stage::Idle; }
+	inline std::shared_ptr<const Result> GetResult() const noexcept { return std::atomic_load(&result); }
+
+	// blocking alignment spread over worker threads, false if it was cancelled
+	static bool Align(const OFS_WaveformPyramid& current, const OFS_WaveformPyramid& reference,
+		const std::atomic<bool>& cancel, std::vector<Segment>& outSegments) noexcept;
+	// the time in the current media of a reference time, false if that part of the reference is missing
+	static bool ToCurrentTime(const std::vector<Segment>& segments, float referenceTime, float* outCurrentTime) noexcept;
+};
@@ -0,0 +1,422 @@
+#include "OFS_WaveformTempo.h"
+#include "OFS_Profiling.h"
+#include "OFS_ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+
+// the prior is a log-normal around this tempo, against picking half or double the tempo
+static constexpr float PriorBpm = 120.f;
+static constexpr float PriorOctaves = 1.f;
+// windows with less than this autocorrelation peak over mean don't take part in segmentation
+static constexpr float MinWindowConfidence = 1.2f;
+// a frame is an onset when its flux is over this times the mean of the surrounding second
+static constexpr float OnsetThreshold = 1.5f;
+// beats per block whose phase is tracked to correct the period
+static constexpr int32_t BlockBeats = 32;
+// blocks with a best phase less than this times the mean don't take part in the period fit
+static constexpr double MinBlockContrast = 1.5;
+
+// mean of values in [idx - radius, idx + radius] for every index
+static std::vector<float> localMean(const std::vector<float>& values, int32_t radius) noexcept
+{
+	std::vector<double> prefix(values.size() + 1, 0.0);
+	for (size_t i = 0; i < values.size(); i += 1) {
+		prefix[i + 1] = prefix[i] + values[i];
+	}
+	std::vector<float> mean(values.size());
+	int32_t size = (int32_t)values.size();
+	for (int32_t i = 0; i < size; i += 1) {
+		int32_t first = std::max(0, i - radius);
+		int32_t last = std::min(size, i + radius + 1);
+		mean[i] = (float)((prefix[last] - prefix[first]) / (last - first));
+	}
+	return mean;
+}
+
+// positive change of the log compressed amplitude summed over the bands
+static std::vector<float> spectralFlux(const OFS_WaveformPyramid& pyramid) noexcept
+{
+	constexpr float Compression = 100.f;
+	auto& samples = pyramid.Samples();
+	auto& bands = pyramid.SampleBands();
+	std::vector<float> flux(samples.size(), 0.f);
+	auto rise = [](float& prev, float value) noexcept {
+		float compressed = std::log1p(Compression * value);
+		float diff = compressed - prev;
+		prev = compressed;
+		return diff > 0.f ? diff : 0.f;
+	};
+
+	if (!bands.empty()) {
+		float low = 0.f, mid = 0.f, high = 0.f;
+		for (size_t t = 0; t < bands.size(); t += 1) {
+			flux[t] = rise(low, bands[t].Low) + rise(mid, bands[t].Mid) + rise(high, bands[t].High);
+		}
+	}
+	else {
+		// waveforms from older projects only have the amplitude
+		float amplitude = 0.f;
+		for (size_t t = 0; t < samples.size(); t += 1) {
+			flux[t] = rise(amplitude, samples[t]);
+		}
+	}
+	if (!flux.empty()) flux[0] = 0.f;
+	return flux;
+}
+
+// normalized autocorrelation of strength[first, last) for every lag in [lagMin, lagMin + lagCount)
+static void autocorrelate(const std::vector<float>& strength, int32_t first, int32_t last, int32_t lagMin, int32_t lagCount, float* out) noexcept
+{
+	for (int32_t i = 0; i < lagCount; i += 1) {
+		out[i] = 0.f;
+		int32_t lag = lagMin + i;
+		if (last - first <= lag) continue;
+		double sum = 0.0;
+		for (int32_t t = first; t + lag < last; t += 1) {
+			sum += strength[t] * strength[t + lag];
+		}
+		out[i] = (float)(sum / (last - first - lag));
+	}
+}
+
+struct LagEstimate {
+	// in frames, zero if there is no estimate
+	float Lag = 0.f;
+	float Confidence = 0.f;
+};
+
+static LagEstimate bestLag(const float* acf, int32_t lagMin, int32_t lagCount, float fps) noexcept
+{
+	std::vector<float> scores(lagCount);
+	int32_t best = -1;
+	double sum = 0.0;
+	for (int32_t i = 0; i < lagCount; i += 1) {
+		float bpm = 60.f * fps / (lagMin + i);
+		float octaves = std::log2(bpm / PriorBpm) / PriorOctaves;
+		scores[i] = acf[i] * std::exp(-0.5f * octaves * octaves);
+		sum += acf[i];
+		if (best < 0 || scores[i] > scores[best]) best = i;
+	}
+	if (best < 0 || sum <= 0.0 || scores[best] <= 0.f) return LagEstimate{};
+
+	LagEstimate estimate;
+	estimate.Lag = (float)(lagMin + best);
+	if (best > 0 && best < lagCount - 1) {
+		// parabola through the peak and its neighbours
+		float a = scores[best - 1], b = scores[best], c = scores[best + 1];
+		float denom = a - 2.f * b + c;
+		if (denom < 0.f) estimate.Lag += 0.5f * (a - c) / denom;
+	}
+	estimate.Confidence = (float)(acf[best] / (sum / lagCount));
+	return estimate;
+}
+
+// treats double and half the tempo as the same tempo
+static bool tempoDiffers(float bpmA, float bpmB) noexcept
+{
+	float ratio = bpmA / bpmB;
+	float diff = std::min({ std::abs(ratio - 1.f), std::abs(ratio * 2.f - 1.f), std::abs(ratio * 0.5f - 1.f) });
+	return diff > OFS_WaveformTempo::TempoChange;
+}
+
+// onset strength on the beats [beatFirst, beatLast) of a grid starting at first, period and phase in frames
+static double gridScore(const std::vector<float>& strength, int32_t first, int32_t last,
+	double period, double phase, int64_t beatFirst, int64_t beatLast) noexcept
+{
+	double score = 0.0;
+	for (int64_t beat = beatFirst; beat < beatLast; beat += 1) {
+		double t = first + phase + beat * period;
+		if (t >= last - 1) break;
+		int32_t idx = (int32_t)t;
+		float frac = (float)(t - idx);
+		score += strength[idx] * (1.f - frac) + strength[idx + 1] * frac;
+	}
+	return score;
+}
+
+struct BlockPhase {
+	double Phase = 0.0;
+	// zero for blocks without a clear beat
+	double Weight = 0.0;
+};
+
+static BlockPhase blockPhase(const std::vector<float>& strength, int32_t first, int32_t last, double period, int64_t block) noexcept
+{
+	BlockPhase result;
+	double bestScore = -1.0;
+	double sum = 0.0;
+	int32_t phaseCount = 0;
+	for (double phase = 0.0; phase < period; phase += 0.25) {
+		double score = gridScore(strength, first, last, period, phase, block * BlockBeats, (block + 1) * BlockBeats);
+		sum += score;
+		phaseCount += 1;
+		if (score > bestScore) {
+			bestScore = score;
+			result.Phase = phase;
+		}
+	}
+	double mean = sum / phaseCount;
+	if (mean > 0.0 && bestScore >= MinBlockContrast * mean) {
+		result.Weight = bestScore / mean - 1.0;
+	}
+	return result;
+}
+
+struct LineFit {
+	double Intercept = 0.0;
+	double Slope = 0.0;
+};
+
+// weighted least squares of y over x
+static LineFit fitLine(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& weights) noexcept
+{
+	double sw = 0.0, sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+	for (size_t i = 0; i < x.size(); i += 1) {
+		sw += weights[i];
+		sx += weights[i] * x[i];
+		sy += weights[i] * y[i];
+		sxx += weights[i] * x[i] * x[i];
+		sxy += weights[i] * x[i] * y[i];
+	}
+	LineFit fit;
+	if (sw <= 0.0) return fit;
+	double denom = sw * sxx - sx * sx;
+	fit.Slope = std::abs(denom) > 1e-9 ? (sw * sxy - sx * sy) / denom : 0.0;
+	fit.Intercept = (sy - fit.Slope * sx) / sw;
+	return fit;
+}
+
+bool OFS_WaveformTempo::Analyze(const OFS_WaveformPyramid& pyramid, float duration, const std::vector<Interval>& intervals,
+	const std::atomic<bool>& cancel, Result& out) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	out.Onsets.clear();
+	out.Segments.clear();
+	const int32_t frameCount = (int32_t)pyramid.SampleCount();
+	const float fps = pyramid.SamplesPerSecond() > 0.f
+		? pyramid.SamplesPerSecond()
+		: (duration > 0.f ? frameCount / duration : 0.f);
+	const int32_t lagMin = (int32_t)std::floor(60.f * fps / MaxBpm);
+	const int32_t lagMax = (int32_t)std::ceil(60.f * fps / MinBpm);
+	const int32_t lagCount = lagMax - lagMin + 1;
+	if (fps <= 0.f || lagMin < 1 || frameCount < 2 * lagMax) return true;
+
+	// onset strength is the flux above the mean of the surrounding half second
+	auto flux = spectralFlux(pyramid);
+	auto fluxMean = localMean(flux, (int32_t)(0.25f * fps));
+	std::vector<float> strength(frameCount);
+	for (int32_t t = 0; t < frameCount; t += 1) {
+		strength[t] = std::max(0.f, flux[t] - fluxMean[t]);
+	}
+
+	// onsets are the strongest flux within 50ms which clearly stand out of the surrounding second
+	{
+		auto onsetMean = localMean(flux, (int32_t)(0.5f * fps));
+		double globalMean = 0.0;
+		for (auto value : flux) globalMean += value;
+		globalMean /= frameCount;
+		const int32_t peakRadius = std::max(1, (int32_t)std::round(0.05f * fps));
+		int32_t lastOnset = -peakRadius - 1;
+		for (int32_t t = 0; t < frameCount; t += 1) {
+			if (flux[t] <= OnsetThreshold * onsetMean[t] + 0.1f * (float)globalMean) continue;
+			if (t - lastOnset <= peakRadius) continue;
+			int32_t first = std::max(0, t - peakRadius);
+			int32_t last = std::min(frameCount, t + peakRadius + 1);
+			if (std::max_element(flux.begin() + first, flux.begin() + last) != flux.begin() + t) continue;
+			out.Onsets.emplace_back(t / fps);
+			lastOnset = t;
+		}
+	}
+	if (cancel) return false;
+
+	struct SegmentFrames {
+		int32_t First = 0;
+		int32_t Last = 0;
+	};
+	std::vector<SegmentFrames> segments;
+	if (!intervals.empty()) {
+		for (auto& interval : intervals) {
+			SegmentFrames segment;
+			segment.First = std::clamp((int32_t)(interval.StartTime * fps), 0, frameCount);
+			segment.Last = std::clamp((int32_t)(interval.EndTime * fps), 0, frameCount);
+			segments.emplace_back(segment);
+		}
+	}
+	else {
+		// tempo of overlapping windows, a segment ends when two windows in a row agree on a different tempo
+		const int32_t windowSize = std::max(2 * lagMax, (int32_t)(WindowSeconds * fps));
+		const int32_t windowHop = windowSize / 2;
+		const int32_t windowCount = std::max(1, (frameCount - windowSize) / windowHop + 1);
+		std::vector<float> windowAcf((size_t)windowCount * lagCount);
+		std::vector<LagEstimate> windowLags(windowCount);
+		OFS::ParallelFor(windowCount, [&](uint32_t w) noexcept {
+			if (cancel) return;
+			int32_t first = w * windowHop;
+			float* acf = windowAcf.data() + (size_t)w * lagCount;
+			autocorrelate(strength, first, std::min(frameCount, first + windowSize), lagMin, lagCount, acf);
+			windowLags[w] = bestLag(acf, lagMin, lagCount, fps);
+		});
+		if (cancel) return false;
+
+		auto isTempoWindow = [&](int32_t w) noexcept {
+			return w < windowCount && windowLags[w].Lag > 0.f && windowLags[w].Confidence >= MinWindowConfidence;
+		};
+		auto windowBpm = [&](int32_t w) noexcept { return 60.f * fps / windowLags[w].Lag; };
+
+		std::vector<float> segmentAcf(lagCount, 0.f);
+		bool segmentHasTempo = false;
+		segments.emplace_back();
+		for (int32_t w = 0; w < windowCount; w += 1) {
+			if (!isTempoWindow(w)) continue;
+			const float* acf = windowAcf.data() + (size_t)w * lagCount;
+			if (segmentHasTempo) {
+				auto segmentLag = bestLag(segmentAcf.data(), lagMin, lagCount, fps);
+				float segmentBpm = segmentLag.Lag > 0.f ? 60.f * fps / segmentLag.Lag : windowBpm(w);
+				int32_t nextW = w + 1;
+				while (nextW < windowCount && !isTempoWindow(nextW)) nextW += 1;
+				if (nextW < windowCount
+					&& tempoDiffers(windowBpm(w), segmentBpm)
+					&& tempoDiffers(windowBpm(nextW), segmentBpm)
+					&& !tempoDiffers(windowBpm(nextW), windowBpm(w))) {
+					// the previous window still agreed, so the change is in the first half of this one
+					int32_t boundary = w * windowHop + windowSize / 4;
+					segments.back().Last = boundary;
+					segments.emplace_back().First = boundary;
+					std::fill(segmentAcf.begin(), segmentAcf.end(), 0.f);
+				}
+			}
+			for (int32_t i = 0; i < lagCount; i += 1) {
+				segmentAcf[i] += acf[i];
+			}
+			segmentHasTempo = true;
+		}
+		segments.back().Last = frameCount;
+	}
+
+	// tempo of every segment, one lag per task so a single long segment is spread over the cores as well
+	const uint32_t segmentCount = segments.size();
+	std::vector<float> segmentAcf((size_t)segmentCount * lagCount);
+	OFS::ParallelFor(segmentCount * lagCount, [&](uint32_t task) noexcept {
+		if (cancel) return;
+		auto& segment = segments[task / lagCount];
+		int32_t lagIdx = task % lagCount;
+		autocorrelate(strength, segment.First, segment.Last, lagMin + lagIdx, 1, &segmentAcf[task]);
+	});
+	if (cancel) return false;
+
+	std::vector<LagEstimate> segmentLags(segmentCount);
+	for (uint32_t s = 0; s < segmentCount; s += 1) {
+		segmentLags[s] = bestLag(segmentAcf.data() + (size_t)s * lagCount, lagMin, lagCount, fps);
+	}
+
+	// the autocorrelation peak is only accurate to a fraction of a frame which adds up over long segments
+	// the phase of every block of beats drifts by the period error so a line through them corrects it
+	struct BlockTask {
+		uint32_t Segment = 0;
+		int64_t Block = 0;
+	};
+	std::vector<BlockTask> blockTasks;
+	std::vector<uint32_t> firstBlockTask(segmentCount + 1);
+	for (uint32_t s = 0; s < segmentCount; s += 1) {
+		firstBlockTask[s] = blockTasks.size();
+		if (segmentLags[s].Lag <= 0.f) continue;
+		int64_t beats = (int64_t)((segments[s].Last - segments[s].First) / segmentLags[s].Lag);
+		int64_t blocks = std::max<int64_t>(1, beats / BlockBeats);
+		for (int64_t block = 0; block < blocks; block += 1) {
+			blockTasks.emplace_back(BlockTask{ s, block });
+		}
+	}
+	firstBlockTask[segmentCount] = blockTasks.size();
+
+	std::vector<BlockPhase> blockPhases(blockTasks.size());
+	OFS::ParallelFor(blockTasks.size(), [&](uint32_t task) noexcept {
+		if (cancel) return;
+		auto& blockTask = blockTasks[task];
+		auto& segment = segments[blockTask.Segment];
+		blockPhases[task] = blockPhase(strength, segment.First, segment.Last, segmentLags[blockTask.Segment].Lag, blockTask.Block);
+	});
+	if (cancel) return false;
+
+	for (uint32_t s = 0; s < segmentCount; s += 1) {
+		if (segmentLags[s].Lag <= 0.f) continue;
+		const double lag = segmentLags[s].Lag;
+		std::vector<double> x, y, weights;
+		bool hasPrevious = false;
+		double previous = 0.0;
+		for (uint32_t task = firstBlockTask[s]; task < firstBlockTask[s + 1]; task += 1) {
+			auto& block = blockPhases[task];
+			if (block.Weight <= 0.0) continue;
+			// unwrap against the previous block, the drift between blocks is far below half a period
+			double phase = block.Phase;
+			if (hasPrevious) phase += std::round((previous - phase) / lag) * lag;
+			previous = phase;
+			hasPrevious = true;
+			x.emplace_back((blockTasks[task].Block + 0.5) * BlockBeats);
+			y.emplace_back(phase);
+			weights.emplace_back(block.Weight);
+		}
+		if (x.empty()) continue;
+
+		auto line = fitLine(x, y, weights);
+		// once more without the blocks which are off by more than an eighth of a beat
+		for (size_t i = 0; i < x.size(); i += 1) {
+			if (std::abs(line.Intercept + line.Slope * x[i] - y[i]) > lag / 8.0) weights[i] = 0.0;
+		}
+		auto refined = fitLine(x, y, weights);
+		if (std::any_of(weights.begin(), weights.end(), [](double w) noexcept { return w > 0.0; })) line = refined;
+		// a single block says nothing about the period
+		if (x.size() < 2) line.Slope = 0.0;
+
+		double period = lag + line.Slope;
+		Segment segment;
+		segment.StartTime = segments[s].First / fps;
+		segment.EndTime = segments[s].Last / fps;
+		segment.Bpm = (float)(60.0 * fps / period);
+		segment.Confidence = segmentLags[s].Confidence;
+		double beatTime = (segments[s].First + line.Intercept) / fps;
+		double beatPeriod = period / fps;
+		segment.BeatOffset = (float)(beatTime - std::floor(beatTime / beatPeriod) * beatPeriod);
+		out.Segments.emplace_back(segment);
+	}
+	return true;
+}
+
+int OFS_WaveformTempo::analysisThread(void* user) noexcept
+{
+	auto tempo = static_cast<OFS_WaveformTempo*>(user);
+	auto newResult = std::make_shared<Result>();
+	newResult->Source = tempo->input;
+	if (Analyze(*tempo->input, tempo->inputDuration, tempo->inputIntervals, tempo->cancelled, *newResult)) {
+		std::atomic_store(&tempo->result, std::shared_ptr<const Result>(std::move(newResult)));
+	}
+	tempo->running = false;
+	return 0;
+}
+
+void OFS_WaveformTempo::Start(std::shared_ptr<const OFS_WaveformPyramid> pyramid, float duration, std::vector<Interval> intervals) noexcept
+{
+	Cancel();
+	if (!pyramid) return;
+	input = std::move(pyramid);
+	inputDuration = duration;
+	inputIntervals = std::move(intervals);
+	cancelled = false;
+	running = true;
+	thread = SDL_CreateThread(analysisThread, "OFS_TempoAnalysis", this);
+	if (!thread) running = false;
+}
+
+void OFS_WaveformTempo::Cancel() noexcept
+{
+	cancelled = true;
+	if (thread) {
+		SDL_WaitThread(thread, nullptr);
+		thread = nullptr;
+	}
+}
+
+OFS_WaveformTempo::~OFS_WaveformTempo() noexcept
+{
+	Cancel();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "OFS_WaveformPyramid.h"
+#include "SDL_thread.h"
+
+#include <vector>
+#include <memory>
+#include <atomic>
+
+// Onset and tempo detection on the waveform samples.
+// Onsets are peaks of the spectral flux of the band amplitudes, the tempo is the strongest
+// autocorrelation lag of the onset strength and the phase the best fitting beat grid.
+class OFS_WaveformTempo
+{
+public:
+	static constexpr float MinBpm = 60.f;
+	static constexpr float MaxBpm = 200.f;
+	// seconds of onset strength per tempo estimate, windows overlap by half
+	static constexpr float WindowSeconds = 6.f;
+	// relative tempo difference which starts a new segment
+	static constexpr float TempoChange = 0.04f;
+
+	struct Interval {
+		float StartTime = 0.f;
+		float EndTime = 0.f;
+	};
+
+	struct Segment {
+		float StartTime = 0.f;
+		float EndTime = 0.f;
+		float Bpm = 0.f;
+		// time of a beat in [0, 60 / Bpm)
+		float BeatOffset = 0.f;
+		// autocorrelation peak over its mean, close to 1 means there is no clear beat
+		float Confidence = 0.f;
+	};
+
+	struct Result {
+		std::shared_ptr<const OFS_WaveformPyramid> Source;
+		// sorted, in seconds
+		std::vector<float> Onsets;
+		std::vector<Segment> Segments;
+	};
+
+private:
+	SDL_Thread* thread = nullptr;
+	std::atomic<bool> running = false;
+	std::atomic<bool> cancelled = false;
+	// replaced by the analysis thread, read by the main thread
+	std::shared_ptr<const Result> result;
+
+	std::shared_ptr<const OFS_WaveformPyramid> input;
+	float inputDuration = 0.f;
+	std::vector<Interval> inputIntervals;
+
+	static int analysisThread(void* user) noexcept;
+
+public:
+	OFS_WaveformTempo() noexcept = default;
+	OFS_WaveformTempo(const OFS_WaveformTempo&) = delete;
+	~OFS_WaveformTempo() noexcept;
+
+	// analyzes on a background thread, every interval gets one segment
+	// without intervals the whole track is segmented by its tempo changes
+	void Start(std::shared_ptr<const OFS_WaveformPyramid> pyramid, float duration, std::vector<Interval> intervals) noexcept;
+	// stops and waits for a running analysis
+	void Cancel() noexcept;
+
+	inline bool Busy() const noexcept { return running; }
+	inline std::shared_ptr<const Result> GetResult() const noexcept { return std::atomic_load(&result); }
+
+	// blocking analysis spread over worker threads, false if it was cancelled
+	static bool Analyze(const OFS_WaveformPyramid& pyramid, float duration, const std::vector<Interval>& intervals,
+		const std::atomic<bool>& cancel, Result& out) noexcept;
+};
@@ -3,6 +3,7 @@
 #include "OFS_Profiling.h"
 #include "OFS_Localization.h"
 #include "FunscriptHeatmap.h"
+#include "OFS_FrameArena.h"
 
 #include "state/states/BaseOverlayState.h"
 
@@ -89,62 +90,50 @@ ImVec2 BaseOverlay::GetPointForAction(const OverlayDrawingCtx& ctx, FunscriptAct
 
 void BaseOverlay::drawActionLinesSpline(const OverlayDrawingCtx& ctx, const BaseOverlayState& state) noexcept
 {
-    auto drawSpline = [](const OverlayDrawingCtx& ctx, FunscriptAction startAction, FunscriptAction endAction, uint32_t color, float width, bool background = true) noexcept
-    {
-        constexpr float SamplesPerTwothousandPixels = 150.f;
-        const float MaximumSamples = SamplesPerTwothousandPixels * (ctx.canvasSize.x / 2000.f);
-
-        auto getPointForTimePos = [](const OverlayDrawingCtx& ctx, float time, float pos) noexcept {
-            float relative_x = (float)(time - ctx.offsetTime) / ctx.visibleTime;
-            float x = (ctx.canvasSize.x) * relative_x;
-            float y = (ctx.canvasSize.y) * (1 - (pos / 100.f));
-            x += ctx.canvasPos.x;
-            y += ctx.canvasPos.y;
-            return ImVec2(x, y);
-        };
-        auto putPoint = [getPointForTimePos](auto& ctx, float time) noexcept {
-            float pos = Util::Clamp<float>(ctx.DrawingScript()->Spline(time) * 100.f, 0.f, 100.f);
-            ctx.drawList->PathLineTo(getPointForTimePos(ctx, time, pos));
-        };
-
-        ctx.drawList->PathClear();
-        float visibleDuration;
-        float currentTime;
-        float endTime;
-        if (startAction.atS >= ctx.offsetTime && endAction.atS <= (ctx.offsetTime + ctx.visibleTime)) {
-            currentTime = startAction.atS;
-            endTime = endAction.atS;
-            visibleDuration = endTime - currentTime;
-        }
-        else if (startAction.atS < ctx.offsetTime && endAction.atS > (ctx.offsetTime + ctx.visibleTime)) {
-            // clip at the invisible area in both direction
-            currentTime = ctx.offsetTime;
-            endTime = (ctx.offsetTime + ctx.visibleTime);
-            visibleDuration = ctx.visibleTime;
-        }
-        else if (startAction.atS < ctx.offsetTime) {
-            // clip invisible area on the left
-            currentTime = ctx.offsetTime;
-            endTime = endAction.atS;
-            visibleDuration = endAction.atS - ctx.offsetTime;
-        }
-        else if (endAction.atS > (ctx.offsetTime + ctx.visibleTime)) {
-            // clip invisble area on the right
-            currentTime = startAction.atS;
-            endTime = (ctx.offsetTime + ctx.visibleTime) + 0.001f;
-            visibleDuration = endTime - startAction.atS;
-        }
+    constexpr float SamplesPerTwothousandPixels = 150.f;
+    const float maximumSamples = SamplesPerTwothousandPixels * (ctx.canvasSize.x / 2000.f);
+    if (ctx.visibleTime <= 0.f || maximumSamples < 2.f) {
+        // nothing to sample the spline over
+        drawActionLinesLinear(ctx, state);
+        return;
+    }
 
-        // detail gets dynamically reduced by increasing the timeStep,
-        // at which is being sampled from the spline
-        const float ratio = visibleDuration / ctx.visibleTime;
-        const float SampleCount = MaximumSamples * ratio;
+    // the spline of the whole visible window is sampled in one pass,
+    // the segments pick their samples from it in order
+    const uint32_t sampleCount = (uint32_t)maximumSamples;
+    const float startTime = ctx.offsetTime;
+    const float endTime = ctx.offsetTime + ctx.visibleTime;
+    // same step as FunscriptSpline::SampleRange
+    const float timeStep = (endTime - startTime) / (sampleCount - 1);
+    OFS_FrameVector<float> splinePositions(sampleCount);
+    FunscriptSpline::SampleRange(ctx.DrawingScript()->Actions(), startTime, endTime, sampleCount, splinePositions.data());
+
+    auto sampleTime = [startTime, timeStep](uint32_t i) noexcept {
+        return (float)(startTime + (double)timeStep * i);
+    };
+    auto getPointForTimePos = [](const OverlayDrawingCtx& ctx, float time, float pos) noexcept {
+        float relative_x = (float)(time - ctx.offsetTime) / ctx.visibleTime;
+        float x = (ctx.canvasSize.x) * relative_x;
+        float y = (ctx.canvasSize.y) * (1 - (pos / 100.f));
+        x += ctx.canvasPos.x;
+        y += ctx.canvasPos.y;
+        return ImVec2(x, y);
+    };
 
-        const float timeStep = visibleDuration / SampleCount;
-        
-        if (SampleCount < 3.f) {
-            auto p1 = BaseOverlay::GetPointForAction(ctx, startAction);
-            auto p2 = BaseOverlay::GetPointForAction(ctx, endAction);
+    // sampleIdx only moves forward, the segments have to be drawn in time order
+    auto drawSpline = [&](FunscriptAction startAction, FunscriptAction endAction, uint32_t& sampleIdx, uint32_t color, float width, bool background) noexcept
+    {
+        const float segmentStart = startAction.atS;
+        const float segmentEnd = endAction.atS;
+        while (sampleIdx < sampleCount && sampleTime(sampleIdx) <= segmentStart) ++sampleIdx;
+        uint32_t sampleEnd = sampleIdx;
+        while (sampleEnd < sampleCount && sampleTime(sampleEnd) < segmentEnd) ++sampleEnd;
+
+        auto p1 = BaseOverlay::GetPointForAction(ctx, startAction);
+        auto p2 = BaseOverlay::GetPointForAction(ctx, endAction);
+        ctx.drawList->PathClear();
+        if (sampleEnd - sampleIdx < 2) {
+            // too short for the curve to show
             if (background) {
                 ctx.drawList->PathLineTo(p1);
                 ctx.drawList->PathLineTo(p2);
@@ -153,18 +142,17 @@ void BaseOverlay::drawActionLinesSpline(const OverlayDrawingCtx& ctx, const Base
             ColoredLines.emplace_back(std::move(BaseOverlay::ColoredLine{ p1, p2, color }));
         }
         else {
-            putPoint(ctx, currentTime);
-            currentTime += timeStep;
-            while (currentTime < endTime) {
-                putPoint(ctx, currentTime);
-                currentTime += timeStep;
+            ctx.drawList->PathLineTo(p1);
+            for (uint32_t i = sampleIdx; i < sampleEnd; ++i) {
+                ctx.drawList->PathLineTo(getPointForTimePos(ctx, sampleTime(i), splinePositions[i]));
             }
-            putPoint(ctx, endAction.atS);
+            ctx.drawList->PathLineTo(p2);
             auto tmpSize = ctx.drawList->_Path.Size;
             ctx.drawList->PathStroke(IM_COL32_BLACK, false, 7.f);
             ctx.drawList->_Path.Size = tmpSize;
             ctx.drawList->PathStroke(color, false, width);
         }
+        sampleIdx = sampleEnd;
     };
 
     auto& drawingScript = ctx.DrawingScript();
@@ -173,14 +161,14 @@ void BaseOverlay::drawActionLinesSpline(const OverlayDrawingCtx& ctx, const Base
         auto endIt = drawingScript->Actions().begin() + ctx.actionToIdx;
 
         const FunscriptAction* prevAction = nullptr;
+        uint32_t sampleIdx = 0;
         for (; startIt != endIt; ++startIt) {
             auto& action = *startIt;
-            auto p1 = BaseOverlay::GetPointForAction(ctx, action);
 
             if (prevAction != nullptr) {
                 ImColor speedColor;
                 getActionLineColor(&speedColor, FunscriptHeatmap::LineColors, action, *prevAction, state);
-                drawSpline(ctx, *prevAction, action, ImGui::ColorConvertFloat4ToU32(speedColor), 3.f);
+                drawSpline(*prevAction, action, sampleIdx, ImGui::ColorConvertFloat4ToU32(speedColor), 3.f, true);
             }
             prevAction = &action;
         }
@@ -188,19 +176,18 @@ void BaseOverlay::drawActionLinesSpline(const OverlayDrawingCtx& ctx, const Base
 
     if(drawingScript->HasSelection())
     {
-        auto startIt = drawingScript->Selection().begin() + ctx.selectionFromIdx;
-        auto endIt = drawingScript->Selection().begin() + ctx.selectionToIdx;
+        auto& actions = drawingScript->Actions();
+        auto& selection = drawingScript->Selection();
         const FunscriptAction* prevAction = nullptr;
-        for (; startIt != endIt; ++startIt) {
-            auto&& action = *startIt;
-
+        uint32_t sampleIdx = 0;
+        selection.ForEachAction(actions, (uint32_t)ctx.selectionFromIdx, (uint32_t)ctx.selectionToIdx, [&](const FunscriptAction& action) noexcept {
             if (prevAction != nullptr) {
                 // draw highlight line
-                drawSpline(ctx, *prevAction, action, SelectedLineColor, 3.f, false);
+                drawSpline(*prevAction, action, sampleIdx, SelectedLineColor, 3.f, false);
             }
 
             prevAction = &action;
-        }
+        });
     }
 }
 
@@ -237,11 +224,10 @@ void BaseOverlay::drawActionLinesLinear(const OverlayDrawingCtx& ctx, const Base
 
     if(drawingScript->HasSelection())
     {
-        auto startIt = drawingScript->Selection().begin() + ctx.selectionFromIdx;
-        auto endIt = drawingScript->Selection().begin() + ctx.selectionToIdx;
+        auto& actions = drawingScript->Actions();
+        auto& selection = drawingScript->Selection();
         const FunscriptAction* prevAction = nullptr;
-        for (; startIt != endIt; ++startIt) {
-            auto&& action = *startIt;
+        selection.ForEachAction(actions, (uint32_t)ctx.selectionFromIdx, (uint32_t)ctx.selectionToIdx, [&](const FunscriptAction& action) noexcept {
             auto point = BaseOverlay::GetPointForAction(ctx, action);
 
             if (prevAction != nullptr) {
@@ -257,7 +243,7 @@ void BaseOverlay::drawActionLinesLinear(const OverlayDrawingCtx& ctx, const Base
             }
 
             prevAction = &action;
-        }
+        });
     }
 }
 
@@ -322,14 +308,14 @@ void BaseOverlay::DrawActionPoints(const OverlayDrawingCtx& ctx) noexcept
 
         if(drawingScript->HasSelection())
         {
-            auto startIt = drawingScript->Selection().begin() + ctx.selectionFromIdx;
-            auto endIt = drawingScript->Selection().begin() + ctx.selectionToIdx;
-            for (; startIt != endIt; ++startIt) 
+            auto& actions = drawingScript->Actions();
+            auto& selection = drawingScript->Selection();
+            selection.ForEachAction(actions, (uint32_t)ctx.selectionFromIdx, (uint32_t)ctx.selectionToIdx, [&](const FunscriptAction& action) noexcept
             {
-                auto p = BaseOverlay::GetPointForAction(ctx, *startIt);
+                auto p = BaseOverlay::GetPointForAction(ctx, action);
                 const auto selectedDots = IM_COL32(11, 252, 3, opcacityInt);
 			    ctx.drawList->AddCircleFilled(p, BaseOverlay::PointSize * 0.7f, selectedDots, 4);
-            }
+            });
         }
     }
 }
@@ -28,6 +28,7 @@ struct OverlayDrawingCtx {
 	int32_t actionFromIdx;
 	int32_t actionToIdx;
 
+	// indices into Actions, selected actions in this range have to be drawn
 	int32_t selectionFromIdx;
 	int32_t selectionToIdx;
 
@@ -148,7 +148,9 @@ void WaveformShader::initUniformLocations() noexcept
 	AudioLoc = glGetUniformLocation(program, "audio");
 	AudioScaleLoc = glGetUniformLocation(program, "scaleAudio");
 	AudioSamplingOffset = glGetUniformLocation(program, "SamplingOffset");
+	AudioSamplingScale = glGetUniformLocation(program, "SamplingScale");
 	ColorLoc = glGetUniformLocation(program, "Color");
+	SpectralMixLoc = glGetUniformLocation(program, "SpectralMix");
 }
 
 void WaveformShader::ProjMtx(const float* mat4) noexcept
@@ -166,6 +168,11 @@ void WaveformShader::SampleOffset(float offset) noexcept
 	glUniform1f(AudioSamplingOffset, offset);
 }
 
+void WaveformShader::SampleScale(float scale) noexcept
+{
+	glUniform1f(AudioSamplingScale, scale);
+}
+
 void WaveformShader::ScaleFactor(float scale) noexcept
 {
 	glUniform1f(AudioScaleLoc, scale);
@@ -175,3 +182,8 @@ void WaveformShader::Color(float* vec3) noexcept
 {
 	glUniform3fv(ColorLoc, 1, vec3);
 }
+
+void WaveformShader::SpectralMix(float mix) noexcept
+{
+	glUniform1f(SpectralMixLoc, mix);
+}
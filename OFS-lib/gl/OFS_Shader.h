@@ -118,7 +118,9 @@ private:
 	int32_t AudioLoc = 0;
 	int32_t AudioScaleLoc = 0;
 	int32_t AudioSamplingOffset = 0;
+	int32_t AudioSamplingScale = 0;
 	int32_t ColorLoc = 0;
+	int32_t SpectralMixLoc = 0;
 
 	static constexpr const char* vtx_shader = OFS_SHADER_VERSION R"(
 			precision highp float;
@@ -143,6 +145,10 @@ private:
 			uniform sampler2D audio;
 			uniform float scaleAudio;
 			uniform float SamplingOffset;
+			// part of the texture which is in view
+			uniform float SamplingScale;
+			// 1 colours every bar by the share of its low, mid and high band
+			uniform float SpectralMix;
 
 			in vec2 Frag_UV;
 			in vec4 Frag_Color;
@@ -172,7 +178,9 @@ private:
 				const float lowT = (500.f / frequencyBase) * 2.f;
 				const float midT = (2000.f / frequencyBase) * 2.f;
 
-				float unscaledSample = texture(audio, vec2(Frag_UV.x + SamplingOffset, 0)).x;
+				// peak followed by the low, mid and high band share
+				vec4 texel = texture(audio, vec2(Frag_UV.x * SamplingScale + SamplingOffset, 0));
+				float unscaledSample = texel.x;
 				float scaledSample = unscaledSample * scaleAudio;
 				float padding = (1.f - scaledSample) / 2.f;
 				
@@ -188,6 +196,9 @@ private:
 
 				vec3 c = mix(highCol, midCol, l1);
 				c = mix(c, lowCol, m1);
+
+				vec3 spectralCol = texel.y * lowCol + texel.z * midCol + texel.w * highCol;
+				c = mix(c, spectralCol, SpectralMix);
 				Out_Color = vec4(c, h1 + s1);
 			}
 	)";
@@ -203,8 +214,10 @@ public:
 	void ProjMtx(const float* mat4) noexcept;
 	void AudioData(uint32_t unit) noexcept;
 	void SampleOffset(float offset) noexcept;
+	void SampleScale(float scale) noexcept;
 	void ScaleFactor(float scale) noexcept;
 	void Color(float* vec3) noexcept;
+	void SpectralMix(float mix) noexcept;
 };
 
 class LightingShader : public ShaderBase
@@ -2,8 +2,10 @@
 
 #include "OFS_StateHandle.h"
 #include "OFS_BinarySerialization.h"
+#include "OFS_WaveformPyramid.h"
 
 #include <vector>
+#include <memory>
 #include <cstdint>
 
 #include "sdefl.h"
@@ -15,48 +17,97 @@ struct WaveformState
     std::string Filename;
     std::vector<uint8_t> BinSamples;
     size_t UncompressedSize = 0;
+    // zero in projects from before the waveform was streamed
+    float SamplesPerSecond = 0.f;
+    // low, mid and high amplitude of every sample, empty in older projects
+    std::vector<uint8_t> BinBands;
+    size_t UncompressedBandsSize = 0;
 
-    std::vector<float> GetSamples() noexcept
+    // decoded once per project instead of on every load, not serialized
+    std::shared_ptr<const OFS_WaveformPyramid> Pyramid;
+
+    // values in [0, 1] are stored as deflated u16
+    static std::vector<float> Inflate(const std::vector<uint8_t>& compressed, size_t uncompressedSize) noexcept
     {
-        if(UncompressedSize == 0) 
-            return {};
+        std::vector<float> values;
         std::vector<uint8_t> decompressed;
-        decompressed.resize(UncompressedSize);
+        decompressed.resize(uncompressedSize);
 
-        auto size = sinflate(decompressed.data(), decompressed.size(), BinSamples.data(), BinSamples.size());
-        if(size == UncompressedSize)
+        auto size = sinflate(decompressed.data(), decompressed.size(), compressed.data(), compressed.size());
+        if(size == uncompressedSize)
         {
-            std::vector<uint16_t> u16Samples;
-            OFS_Binary::Deserialize(decompressed, u16Samples);
-            std::vector<float> samples;
-            samples.reserve(u16Samples.size());
-            for(auto sample : u16Samples)
-                samples.emplace_back(sample / (float) std::numeric_limits<uint16_t>::max());
-            return samples;
+            std::vector<uint16_t> u16Values;
+            OFS_Binary::Deserialize(decompressed, u16Values);
+            values.reserve(u16Values.size());
+            for(auto value : u16Values)
+                values.emplace_back(value / (float) std::numeric_limits<uint16_t>::max());
         }
-        return {};
+        return values;
     }
 
-    void SetSamples(const std::vector<float>& samples)
+    static std::vector<uint8_t> Deflate(const std::vector<float>& values, size_t& uncompressedSize) noexcept
     {
-        std::vector<uint16_t> u16Samples;
-        u16Samples.reserve(samples.size());
-        for(auto sample : samples)
-            u16Samples.emplace_back((uint16_t)(sample * (float)std::numeric_limits<uint16_t>::max()));
-
-        BinSamples.clear();
-        auto size = OFS_Binary::Serialize(BinSamples, u16Samples);
-        BinSamples.resize(size);
+        std::vector<uint16_t> u16Values;
+        u16Values.reserve(values.size());
+        for(auto value : values)
+            u16Values.emplace_back((uint16_t)(value * (float)std::numeric_limits<uint16_t>::max()));
 
-        UncompressedSize = size;
+        std::vector<uint8_t> bin;
+        auto size = OFS_Binary::Serialize(bin, u16Values);
+        bin.resize(size);
+        uncompressedSize = size;
 
         std::vector<uint8_t> compressedBin;
-        compressedBin.resize(size);
+        compressedBin.resize(sdefl_bound(size));
 
         sdefl ctx = {0};
-        auto compressedSize = sdeflate(&ctx, compressedBin.data(), BinSamples.data(), BinSamples.size(), 8);
+        auto compressedSize = sdeflate(&ctx, compressedBin.data(), bin.data(), bin.size(), 8);
         compressedBin.resize(compressedSize);
-        BinSamples = std::move(compressedBin);
+        return compressedBin;
+    }
+
+    std::shared_ptr<const OFS_WaveformPyramid> GetPyramid() noexcept
+    {
+        if(Pyramid || UncompressedSize == 0) 
+            return Pyramid;
+        auto samples = Inflate(BinSamples, UncompressedSize);
+        if(!samples.empty())
+        {
+            std::vector<OFS_WaveformPyramid::Bands> bands;
+            if(UncompressedBandsSize > 0)
+            {
+                auto bandValues = Inflate(BinBands, UncompressedBandsSize);
+                if(bandValues.size() == samples.size() * 3)
+                {
+                    bands.reserve(samples.size());
+                    for(size_t i = 0; i < bandValues.size(); i += 3)
+                        bands.emplace_back(OFS_WaveformPyramid::Bands{ bandValues[i], bandValues[i + 1], bandValues[i + 2] });
+                }
+            }
+            Pyramid = std::make_shared<const OFS_WaveformPyramid>(std::move(samples), SamplesPerSecond, std::move(bands));
+        }
+        return Pyramid;
+    }
+
+    void SetPyramid(std::shared_ptr<const OFS_WaveformPyramid> pyramid)
+    {
+        BinSamples = Deflate(pyramid->Samples(), UncompressedSize);
+
+        std::vector<float> bandValues;
+        bandValues.reserve(pyramid->SampleBands().size() * 3);
+        for(auto& band : pyramid->SampleBands())
+        {
+            bandValues.emplace_back(band.Low);
+            bandValues.emplace_back(band.Mid);
+            bandValues.emplace_back(band.High);
+        }
+        UncompressedBandsSize = 0;
+        BinBands.clear();
+        if(!bandValues.empty())
+            BinBands = Deflate(bandValues, UncompressedBandsSize);
+
+        SamplesPerSecond = pyramid->SamplesPerSecond();
+        Pyramid = std::move(pyramid);
     }
 
     inline static WaveformState& StaticStateSlow() noexcept
@@ -71,4 +122,7 @@ REFL_TYPE(WaveformState)
     REFL_FIELD(Filename)
     REFL_FIELD(BinSamples)
     REFL_FIELD(UncompressedSize)
+    REFL_FIELD(SamplesPerSecond)
+    REFL_FIELD(BinBands)
+    REFL_FIELD(UncompressedBandsSize)
 REFL_END
\ No newline at end of file
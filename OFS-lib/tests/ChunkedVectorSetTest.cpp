@@ -0,0 +1,193 @@
+#include "FunscriptAction.h"
+#include "OFS_VectorSet.h"
+#include "OFS_ChunkedVectorSet.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Runs random edits against vector_set and chunked_vector_set side by side and compares them after every step.
+// With --bench it times both at 10k, 100k and 1M actions instead.
+
+using FlatArray = vector_set<FunscriptAction, ActionLess>;
+// small chunks so the edits split and coalesce a lot
+using SmallChunkArray = chunked_vector_set<FunscriptAction, ActionLess, 128>;
+using ChunkedArray = chunked_vector_set<FunscriptAction, ActionLess>;
+
+static bool same(const FlatArray& flat, const SmallChunkArray& chunked) noexcept
+{
+	if (flat.size() != chunked.size()) return false;
+	auto flatIt = flat.begin();
+	for (auto it = chunked.begin(); it != chunked.end(); ++it, ++flatIt) {
+		if (!(*it == *flatIt) || it->pos != flatIt->pos) return false;
+	}
+	// backwards and through the index as well
+	size_t idx = flat.size();
+	for (auto it = chunked.end(); it != chunked.begin();) {
+		if (!(*--it == flat[--idx])) return false;
+	}
+	for (size_t i = 0; i < flat.size(); i += 7) {
+		if (!(chunked[i] == flat[i])) return false;
+	}
+	return true;
+}
+
+static bool randomEdits() noexcept
+{
+	std::mt19937 rng(3);
+	auto randomTime = [&]() noexcept { return (float)(rng() % 5000) / 10.f; };
+
+	for (int round = 0; round < 200; ++round) {
+		FlatArray flat;
+		SmallChunkArray chunked;
+		for (int step = 0; step < 400; ++step) {
+			switch (rng() % 9) {
+				case 0:
+				case 1:
+				case 2:
+				{
+					FunscriptAction action(randomTime(), rng() % 100);
+					if (flat.emplace(action) != chunked.emplace(action)) return false;
+					break;
+				}
+				case 3:
+					if (!flat.empty()) {
+						size_t idx = rng() % flat.size();
+						flat.erase(flat.begin() + idx);
+						chunked.erase(chunked.begin() + idx);
+					}
+					break;
+				case 4:
+					if (!flat.empty()) {
+						size_t first = rng() % flat.size();
+						size_t last = first + rng() % (flat.size() - first + 1);
+						flat.erase(flat.begin() + first, flat.begin() + last);
+						chunked.erase(chunked.begin() + first, chunked.begin() + last);
+					}
+					break;
+				case 5:
+				{
+					FlatArray other;
+					int count = rng() % 2 ? 3 : 200;
+					for (int i = 0; i < count; ++i) other.emplace(FunscriptAction(randomTime(), rng() % 100));
+					if (flat.merge(other.begin(), other.end()) != chunked.merge(other.begin(), other.end())) return false;
+					break;
+				}
+				case 6:
+				{
+					FlatArray other;
+					for (auto action : flat) if (rng() % 3 == 0) other.emplace_back_unsorted(action);
+					if (flat.erase_sorted(other.begin(), other.end()) != chunked.erase_sorted(other.begin(), other.end())) return false;
+					break;
+				}
+				case 7:
+				{
+					float fromTime = randomTime();
+					float toTime = fromTime + (rng() % 500) / 10.f;
+					FlatArray other;
+					for (int i = 0; i < 5; ++i) other.emplace(FunscriptAction(fromTime + i * (toTime - fromTime) / 5, 1));
+					size_t flatRemoved = flat.replace_interval(FunscriptAction(fromTime, 0), FunscriptAction(toTime, 0), other.begin(), other.end());
+					size_t chunkedRemoved = chunked.replace_interval(FunscriptAction(fromTime, 0), FunscriptAction(toTime, 0), other.begin(), other.end());
+					if (flatRemoved != chunkedRemoved) return false;
+					break;
+				}
+				case 8:
+				{
+					// a sorted run which fits between two neighbours
+					size_t idx = flat.empty() ? 0 : rng() % (flat.size() + 1);
+					float lo = idx > 0 ? (float)flat[idx - 1].atS : -100.f;
+					float hi = idx < flat.size() ? (float)flat[idx].atS : lo + 100.f;
+					int count = rng() % 3 ? rng() % 5 : rng() % 300;
+					FlatArray run;
+					for (int i = 1; i <= count; ++i) {
+						FunscriptAction action(lo + (hi - lo) * i / (count + 1), i % 100);
+						if ((idx == 0 || ActionLess()(flat[idx - 1], action)) && (idx == flat.size() || ActionLess()(action, flat[idx]))) {
+							run.emplace(action);
+						}
+					}
+					flat.insert(flat.begin() + idx, run.begin(), run.end());
+					auto it = chunked.insert(chunked.begin() + idx, run.begin(), run.end());
+					if ((size_t)(it - chunked.begin()) != idx) return false;
+					break;
+				}
+			}
+			if (!same(flat, chunked)) {
+				std::printf("mismatch in round %d step %d\n", round, step);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+template<typename Fn>
+static double milliseconds(Fn&& fn) noexcept
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	fn();
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+template<typename Array>
+static void fill(Array& actions, size_t count) noexcept
+{
+	actions.reserve(count);
+	for (size_t i = 0; i < count; ++i) actions.emplace_back_unsorted(FunscriptAction(i * 0.2f, i % 100));
+}
+
+static void bench() noexcept
+{
+	std::mt19937 rng(5);
+	constexpr int Ops = 10000;
+	for (size_t count : { 10000u, 100000u, 1000000u }) {
+		FlatArray flat;
+		ChunkedArray chunked;
+		fill(flat, count);
+		fill(chunked, count);
+		std::vector<float> times(Ops);
+		for (auto& time : times) time = (rng() % count) * 0.2f + 0.1f;
+
+		double flatInsert = milliseconds([&]() noexcept { for (auto time : times) flat.emplace(FunscriptAction(time, 1)); });
+		double chunkedInsert = milliseconds([&]() noexcept { for (auto time : times) chunked.emplace(FunscriptAction(time, 1)); });
+		double flatErase = milliseconds([&]() noexcept {
+			for (auto time : times) { auto it = flat.find(FunscriptAction(time, 1)); if (it != flat.end()) flat.erase(it); }
+		});
+		double chunkedErase = milliseconds([&]() noexcept {
+			for (auto time : times) { auto it = chunked.find(FunscriptAction(time, 1)); if (it != chunked.end()) chunked.erase(it); }
+		});
+
+		volatile float sink = 0.f;
+		double flatBound = milliseconds([&]() noexcept { for (auto time : times) sink = sink + flat.lower_bound(FunscriptAction(time, 0))->pos; });
+		double chunkedBound = milliseconds([&]() noexcept { for (auto time : times) sink = sink + chunked.lower_bound(FunscriptAction(time, 0))->pos; });
+		double flatScan = milliseconds([&]() noexcept { float sum = 0.f; for (auto& action : flat) sum += action.pos; sink = sum; });
+		double chunkedScan = milliseconds([&]() noexcept { float sum = 0.f; for (auto& action : chunked) sum += action.pos; sink = sum; });
+		double flatIndex = milliseconds([&]() noexcept { float sum = 0.f; for (size_t i = 0; i < flat.size(); ++i) sum += flat[i].pos; sink = sum; });
+		double chunkedIndex = milliseconds([&]() noexcept { float sum = 0.f; for (size_t i = 0; i < chunked.size(); ++i) sum += chunked[i].pos; sink = sum; });
+
+		std::vector<FunscriptAction> run;
+		for (int i = 0; i < Ops; ++i) run.emplace_back(FunscriptAction(-1.f - (Ops - i) * 0.001f, 1));
+		double flatRange = milliseconds([&]() noexcept { flat.insert(flat.begin(), run.begin(), run.end()); });
+		double chunkedRange = milliseconds([&]() noexcept { chunked.insert(chunked.begin(), run.begin(), run.end()); });
+
+		std::printf("%7zu actions, flat / chunked ms\n", count);
+		std::printf("  %d random inserts  %9.2f / %7.2f\n", Ops, flatInsert, chunkedInsert);
+		std::printf("  %d random erases   %9.2f / %7.2f\n", Ops, flatErase, chunkedErase);
+		std::printf("  %d lower_bound     %9.2f / %7.2f\n", Ops, flatBound, chunkedBound);
+		std::printf("  iterator scan         %9.2f / %7.2f\n", flatScan, chunkedScan);
+		std::printf("  index scan            %9.2f / %7.2f\n", flatIndex, chunkedIndex);
+		std::printf("  %d range insert    %9.2f / %7.2f\n", Ops, flatRange, chunkedRange);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && std::strcmp(argv[1], "--bench") == 0) {
+		bench();
+		return 0;
+	}
+	if (!randomEdits()) return 1;
+	std::puts("ok");
+	return 0;
+}
@@ -0,0 +1,159 @@
+#include "Funscript.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <limits>
+
+// Compares the block/tree statistics of a randomly edited script against
+// a straight walk over all segments after every edit.
+
+using Summary = FunscriptStatistics::Summary;
+
+static bool close(float a, float b) noexcept
+{
+	return std::abs(a - b) <= 1e-3f * std::max(1.f, std::max(std::abs(a), std::abs(b)));
+}
+
+static bool same(const Summary& a, const Summary& b) noexcept
+{
+	if (a.Segments != b.Segments || a.Gaps != b.Gaps || !close(a.MaxSpeed, b.MaxSpeed)) return false;
+	if (!close(a.Duration, b.Duration) || !close(a.GapTime, b.GapTime)) return false;
+	if (!close(a.Distance, b.Distance) || !close(a.GapDistance, b.GapDistance)) return false;
+	if (!close(a.TimeAboveLimit, b.TimeAboveLimit)) return false;
+	for (uint32_t i = 0; i < FunscriptStatistics::HistogramBuckets; ++i) {
+		if (!close(a.SpeedHistogram[i], b.SpeedHistogram[i])) return false;
+	}
+	return true;
+}
+
+static Summary bruteForce(const FunscriptArray& actions, float fromTime, float toTime, const FunscriptStatistics::Settings& settings) noexcept
+{
+	Summary sum;
+	for (size_t i = 0; i + 1 < actions.size(); ++i) {
+		float startTime = actions[i].atS;
+		if (startTime < fromTime || startTime >= toTime) continue;
+		float duration = (float)actions[i + 1].atS - startTime;
+		if (duration <= 0.f) continue;
+		float distance = (float)std::abs(actions[i + 1].pos - actions[i].pos);
+		float speed = distance / duration;
+		sum.Segments += 1;
+		sum.Duration += duration;
+		sum.Distance += distance;
+		sum.MaxSpeed = std::max(sum.MaxSpeed, speed);
+		if (duration >= settings.GapThreshold) {
+			sum.Gaps += 1;
+			sum.GapTime += duration;
+			sum.GapDistance += distance;
+			continue;
+		}
+		uint32_t bucket = std::min((uint32_t)(speed / FunscriptStatistics::HistogramBucketWidth), FunscriptStatistics::HistogramBuckets - 1);
+		sum.SpeedHistogram[bucket] += duration;
+		if (speed > settings.SpeedLimit) sum.TimeAboveLimit += duration;
+	}
+	return sum;
+}
+
+static bool pauseDoesNotCountAsMovement() noexcept
+{
+	// one second moving 100 units, a 20 second pause covering another 100 units
+	Funscript script;
+	script.AddAction(FunscriptAction(0.f, 0));
+	script.AddAction(FunscriptAction(1.f, 100));
+	script.AddAction(FunscriptAction(21.f, 0));
+
+	FunscriptStatistics::Settings settings;
+	settings.GapThreshold = 10.f;
+	auto& total = script.Statistics(settings).Total();
+	if (total.Gaps != 1 || !close(total.MovingTime(), 1.f) || !close(total.MovingDistance(), 100.f)) return false;
+	return close(total.AverageSpeed(), 100.f);
+}
+
+static bool randomEdits() noexcept
+{
+	std::mt19937 rng(4);
+	FunscriptStatistics::Settings settings;
+	settings.GapThreshold = 3.f;
+	auto randomTime = [&]() noexcept { return (float)(rng() % 30000) / 10.f; };
+
+	for (int round = 0; round < 40; ++round) {
+		Funscript script;
+		{
+			FunscriptArray actions;
+			int count = rng() % 3000;
+			for (int i = 0; i < count; ++i) {
+				actions.emplace_back_unsorted(FunscriptAction(i * 0.5f + (rng() % 5) * 0.1f, rng() % 101));
+			}
+			actions.sort();
+			script.SetActions(actions);
+		}
+		for (int step = 0; step < 200; ++step) {
+			auto& actions = script.Actions();
+			switch (rng() % 9) {
+				case 0:
+				case 1:
+				case 2:
+					script.AddAction(FunscriptAction(randomTime(), rng() % 4 * 33));
+					break;
+				case 3:
+					if (!actions.empty()) script.RemoveAction(actions[rng() % actions.size()]);
+					break;
+				case 4:
+					if (!actions.empty()) script.EditAction(actions[rng() % actions.size()], FunscriptAction(randomTime(), rng() % 101));
+					break;
+				case 5:
+				{
+					float time = randomTime();
+					script.SelectTime(time, time + 200.f);
+					script.MoveSelectionTime((rng() % 50) / 10.f - 2.5f, 0.f);
+					script.ClearSelection();
+					break;
+				}
+				case 6:
+				{
+					float time = randomTime();
+					script.SelectTime(time, time + 20.f);
+					script.MoveSelectionPosition(rng() % 21 - 10);
+					script.ClearSelection();
+					break;
+				}
+				case 7:
+				{
+					float time = randomTime();
+					script.RemoveActionsInInterval(time, time + (rng() % 1000) / 10.f);
+					break;
+				}
+				case 8:
+					script.SelectAll();
+					script.InvertSelection();
+					script.ClearSelection();
+					break;
+			}
+
+			auto& stats = script.Statistics(settings);
+			auto expected = bruteForce(script.Actions(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::max(), settings);
+			if (!same(stats.Total(), expected)) {
+				std::printf("total mismatch in round %d step %d\n", round, step);
+				return false;
+			}
+			float fromTime = randomTime();
+			float toTime = fromTime + randomTime() / 4.f;
+			if (!same(stats.Range(script.Columns(), fromTime, toTime), bruteForce(script.Actions(), fromTime, toTime, settings))) {
+				std::printf("range mismatch in round %d step %d\n", round, step);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	if (!pauseDoesNotCountAsMovement()) {
+		std::puts("pauses count towards the average speed");
+		return 1;
+	}
+	if (!randomEdits()) return 1;
+	std::puts("ok");
+	return 0;
+}
@@ -0,0 +1,373 @@
+#include "OFS_EditJournal.h"
+#include "OFS_MappedFile.h"
+#include "OFS_Util.h"
+#include "OFS_Profiling.h"
+
+#include <filesystem>
+#include <cstring>
+#include <cstdio>
+#include <type_traits>
+#include <algorithm>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static_assert(std::is_trivially_copyable_v<FunscriptAction>, "actions are stored as raw bytes");
+
+// Every record is prefixed with the size and checksum of its payload.
+// Payload: u16 title length, title, u8 full, from, to, u32 action count, actions.
+// from and to are stored like the action timestamps, ticks in fixed timebase builds so the interval is exact.
+// Full records replace all actions, the others replace the actions in [from, to].
+struct JournalRecordHeader {
+    uint32_t Size = 0;
+    uint32_t Checksum = 0;
+};
+
+inline static uint32_t journalFlags() noexcept
+{
+#if OFS_FIXED_TIMEBASE
+    return OFS_EditJournal::FixedTimebaseFlag;
+#else
+    return 0;
+#endif
+}
+
+inline static uint32_t checksum(const uint8_t* data, size_t size) noexcept
+{
+    // FNV-1a
+    uint32_t hash = 0x811c9dc5;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+static void projectStamp(const std::string& projectPath, OFS_EditJournal::Header* header) noexcept
+{
+    std::error_code ec;
+    auto path = Util::PathFromString(projectPath);
+    auto fileSize = std::filesystem::file_size(path, ec);
+    header->ProjectSize = ec ? 0 : fileSize;
+    auto writeTime = std::filesystem::last_write_time(path, ec);
+    header->ProjectTime = ec ? 0 : writeTime.time_since_epoch().count();
+    header->Flags = journalFlags();
+}
+
+template<typename T>
+inline static void put(std::vector<uint8_t>& buffer, const T& value) noexcept
+{
+    auto offset = buffer.size();
+    buffer.resize(offset + sizeof(T));
+    std::memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+template<typename T>
+inline static bool get(const uint8_t*& data, const uint8_t* end, T* value) noexcept
+{
+    if ((size_t)(end - data) < sizeof(T)) return false;
+    std::memcpy(value, data, sizeof(T));
+    data += sizeof(T);
+    return true;
+}
+
+static FILE* openJournal(const std::string& path) noexcept
+{
+    auto journalPath = Util::PathFromString(path);
+#ifdef WIN32
+    return _wfopen(journalPath.c_str(), L"wb");
+#else
+    return std::fopen(journalPath.c_str(), "wb");
+#endif
+}
+
+static void syncJournal(FILE* file) noexcept
+{
+    std::fflush(file);
+#ifdef WIN32
+    _commit(_fileno(file));
+#else
+    fsync(fileno(file));
+#endif
+}
+
+OFS_EditJournal::OFS_EditJournal() noexcept
+{
+    mutex = SDL_CreateMutex();
+    cond = SDL_CreateCond();
+}
+
+OFS_EditJournal::~OFS_EditJournal() noexcept
+{
+    if (writerThread) {
+        SDL_LockMutex(mutex);
+        shouldExit = true;
+        SDL_CondSignal(cond);
+        SDL_UnlockMutex(mutex);
+        SDL_WaitThread(writerThread, nullptr);
+    }
+    SDL_DestroyCond(cond);
+    SDL_DestroyMutex(mutex);
+}
+
+std::string OFS_EditJournal::PathFor(const std::string& projectPath) noexcept
+{
+    std::error_code ec;
+    auto absolutePath = std::filesystem::absolute(Util::PathFromString(projectPath), ec).lexically_normal().u8string();
+
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325;
+    for (char c : absolutePath) {
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001b3;
+    }
+    char name[32];
+    stbsp_snprintf(name, sizeof(name), "%016llx.ofsj", (unsigned long long)hash);
+    return Util::Prefpath("journal/" + std::string(name));
+}
+
+uint32_t OFS_EditJournal::Replay(const std::string& projectPath, std::vector<std::shared_ptr<Funscript>>& scripts) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    Header expected;
+    projectStamp(projectPath, &expected);
+
+    OFS_MappedFile file;
+    if (!file.Open(PathFor(projectPath))) return 0;
+    if (file.Size() < sizeof(Header)) return 0;
+
+    Header header;
+    std::memcpy(&header, file.Data(), sizeof(Header));
+    if (std::memcmp(header.Magic, expected.Magic, sizeof(header.Magic)) != 0
+        || header.Version != expected.Version
+        || header.ActionSize != expected.ActionSize
+        || header.Flags != expected.Flags
+        || header.ProjectSize != expected.ProjectSize
+        || header.ProjectTime != expected.ProjectTime) {
+        LOG_WARN("Ignoring edit journal which doesn't belong to the project on disk.");
+        return 0;
+    }
+
+    uint32_t applied = 0;
+    FunscriptArray actions;
+    const uint8_t* it = file.Data() + sizeof(Header);
+    const uint8_t* end = file.Data() + file.Size();
+    for (;;) {
+        JournalRecordHeader recordHeader;
+        if (!get(it, end, &recordHeader)) break;
+        if ((size_t)(end - it) < recordHeader.Size) break;
+        const uint8_t* payload = it;
+        const uint8_t* payloadEnd = it + recordHeader.Size;
+        it = payloadEnd;
+        // everything after a torn write is lost
+        if (checksum(payload, recordHeader.Size) != recordHeader.Checksum) break;
+
+        uint16_t titleLength;
+        if (!get(payload, payloadEnd, &titleLength) || (size_t)(payloadEnd - payload) < titleLength) break;
+        std::string title((const char*)payload, titleLength);
+        payload += titleLength;
+        uint8_t full;
+        FunscriptTime fromTime, toTime;
+        uint32_t count;
+        if (!get(payload, payloadEnd, &full)
+            || !get(payload, payloadEnd, &fromTime)
+            || !get(payload, payloadEnd, &toTime)
+            || !get(payload, payloadEnd, &count)
+            || (size_t)(payloadEnd - payload) != count * sizeof(FunscriptAction)) {
+            break;
+        }
+
+        actions.clear();
+        actions.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            FunscriptAction action;
+            std::memcpy(&action, payload + i * sizeof(FunscriptAction), sizeof(FunscriptAction));
+            actions.emplace_back_unsorted(action);
+        }
+
+        auto scriptIt = std::find_if(scripts.begin(), scripts.end(),
+            [&title](auto& script) noexcept { return script->Title() == title; });
+        if (scriptIt == scripts.end()) {
+            LOGF_WARN("Skipping journaled edit of unknown script \"%s\"", title.c_str());
+            continue;
+        }
+        if (full) {
+            (*scriptIt)->SetActions(actions);
+        }
+        else {
+            (*scriptIt)->ReplaceActionsInInterval(fromTime, toTime, actions);
+        }
+        applied += 1;
+    }
+    return applied;
+}
+
+void OFS_EditJournal::Open(const std::string& projectPath, const std::vector<std::shared_ptr<Funscript>>& scripts) noexcept
+{
+    if (!Util::CreateDirectories(Util::PathFromString(Util::Prefpath("journal")))) return;
+    Header header;
+    projectStamp(projectPath, &header);
+
+    SDL_LockMutex(mutex);
+    pendingPath = PathFor(projectPath);
+    pendingHeader = header;
+    SDL_UnlockMutex(mutex);
+    restart();
+
+    for (auto& script : scripts) {
+        if (script->HasUnsavedEdits()) append(*script, true, FunscriptTime(), FunscriptTime());
+    }
+
+    if (!writerThread) {
+        writerThread = SDL_CreateThread(writerMain, "OFS_EditJournal", this);
+    }
+}
+
+void OFS_EditJournal::KeepOnClose() noexcept
+{
+    SDL_LockMutex(mutex);
+    keepOnExit = true;
+    SDL_UnlockMutex(mutex);
+}
+
+void OFS_EditJournal::restart() noexcept
+{
+    SDL_LockMutex(mutex);
+    pending.clear();
+    truncatePending = true;
+    SDL_CondSignal(cond);
+    SDL_UnlockMutex(mutex);
+    journalSize = sizeof(Header);
+}
+
+void OFS_EditJournal::append(const Funscript& script, bool full, FunscriptTime fromTime, FunscriptTime toTime) noexcept
+{
+    auto& actions = script.Actions();
+    auto startIt = full ? actions.begin() : actions.lower_bound(FunscriptAction(fromTime, 0));
+    auto endIt = full ? actions.end() : actions.upper_bound(FunscriptAction(toTime, 0));
+    uint32_t count = std::distance(startIt, endIt);
+
+    auto& title = script.Title();
+    uint16_t titleLength = std::min<size_t>(title.size(), UINT16_MAX);
+    record.clear();
+    record.reserve(sizeof(JournalRecordHeader) + sizeof(uint16_t) + titleLength + sizeof(uint8_t) + 2 * sizeof(FunscriptTime) + sizeof(uint32_t) + count * sizeof(FunscriptAction));
+    put(record, JournalRecordHeader());
+    put(record, titleLength);
+    record.insert(record.end(), title.begin(), title.begin() + titleLength);
+    put(record, (uint8_t)full);
+    put(record, fromTime);
+    put(record, toTime);
+    put(record, count);
+    for (auto it = startIt; it != endIt; ++it) {
+        put(record, *it);
+    }
+
+    JournalRecordHeader recordHeader;
+    recordHeader.Size = record.size() - sizeof(JournalRecordHeader);
+    recordHeader.Checksum = checksum(record.data() + sizeof(JournalRecordHeader), recordHeader.Size);
+    std::memcpy(record.data(), &recordHeader, sizeof(JournalRecordHeader));
+
+    SDL_LockMutex(mutex);
+    pending.insert(pending.end(), record.begin(), record.end());
+    SDL_UnlockMutex(mutex);
+    journalSize += record.size();
+}
+
+void OFS_EditJournal::Record(const std::vector<std::shared_ptr<Funscript>>& scripts) noexcept
+{
+    if (!writerThread) return;
+    OFS_PROFILE(__FUNCTION__);
+    bool recorded = false;
+    for (auto& script : scripts) {
+        auto& change = script->PendingChange();
+        if (!change.Edit) continue;
+        append(*script, change.IsFull(), change.FromTime, change.ToTime);
+        recorded = true;
+    }
+    if (!recorded) return;
+
+    if (journalSize > CompactSize) {
+        // one full record per script is all that's needed to get back to the current state
+        restart();
+        for (auto& script : scripts) {
+            append(*script, true, FunscriptTime(), FunscriptTime());
+        }
+    }
+    SDL_LockMutex(mutex);
+    SDL_CondSignal(cond);
+    SDL_UnlockMutex(mutex);
+}
+
+int OFS_EditJournal::writerMain(void* user) noexcept
+{
+    ((OFS_EditJournal*)user)->writeLoop();
+    return 0;
+}
+
+void OFS_EditJournal::writeLoop() noexcept
+{
+    FILE* file = nullptr;
+    std::string filePath;
+    std::vector<uint8_t> bytes;
+    uint32_t lastSync = SDL_GetTicks();
+    bool unsynced = false;
+
+    SDL_LockMutex(mutex);
+    for (;;) {
+        if (pending.empty() && !truncatePending && !shouldExit) {
+            SDL_CondWaitTimeout(cond, mutex, SyncIntervalMs);
+        }
+        bool truncate = truncatePending;
+        truncatePending = false;
+        Header header = pendingHeader;
+        std::string path = pendingPath;
+        bytes.swap(pending);
+        bool exit = shouldExit;
+        bool keep = keepOnExit;
+        SDL_UnlockMutex(mutex);
+
+        if (truncate) {
+            if (file) std::fclose(file);
+            std::error_code ec;
+            if (!filePath.empty() && filePath != path) {
+                // the project was saved under a new name
+                std::filesystem::remove(Util::PathFromString(filePath), ec);
+            }
+            filePath = path;
+            file = openJournal(filePath);
+            if (file) {
+                std::fwrite(&header, sizeof(Header), 1, file);
+                unsynced = true;
+            }
+            else {
+                LOGF_ERROR("Failed to open edit journal \"%s\"", filePath.c_str());
+            }
+        }
+        if (file && !bytes.empty()) {
+            std::fwrite(bytes.data(), 1, bytes.size(), file);
+            unsynced = true;
+        }
+        bytes.clear();
+
+        if (exit) {
+            if (file && keep) syncJournal(file);
+            if (file) std::fclose(file);
+            // a clean shutdown leaves nothing to recover
+            if (!keep && !filePath.empty()) {
+                std::error_code ec;
+                std::filesystem::remove(Util::PathFromString(filePath), ec);
+            }
+            return;
+        }
+
+        if (file && unsynced && SDL_GetTicks() - lastSync >= SyncIntervalMs) {
+            syncJournal(file);
+            lastSync = SDL_GetTicks();
+            unsynced = false;
+        }
+        SDL_LockMutex(mutex);
+    }
+}
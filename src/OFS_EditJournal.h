@@ -0,0 +1,74 @@
+#pragma once
+#include "Funscript.h"
+
+#include "SDL_thread.h"
+#include "SDL_mutex.h"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <string>
+
+// Append-only log of the action edits made since the project was last saved.
+// The main thread encodes one record per edited script and frame,
+// a background thread appends them and syncs the file at most once every SyncIntervalMs.
+// A journal which still exists when its project gets loaded means the last session didn't end cleanly.
+class OFS_EditJournal
+{
+public:
+    static constexpr uint32_t SyncIntervalMs = 1000;
+    // the journal gets rewritten from the current state once it grows past this
+    static constexpr size_t CompactSize = 32 * 1024 * 1024;
+
+    struct Header {
+        char Magic[4] = { 'O', 'F', 'S', 'J' };
+        uint32_t Version = 2;
+        uint32_t ActionSize = sizeof(FunscriptAction);
+        uint32_t Flags = 0;
+        // the project file the records apply to
+        uint64_t ProjectSize = 0;
+        int64_t ProjectTime = 0;
+    };
+
+    static constexpr uint32_t FixedTimebaseFlag = 1;
+
+private:
+    std::vector<uint8_t> record;
+    size_t journalSize = 0;
+
+    SDL_Thread* writerThread = nullptr;
+    SDL_mutex* mutex = nullptr;
+    SDL_cond* cond = nullptr;
+    // guarded by the mutex
+    std::vector<uint8_t> pending;
+    std::string pendingPath;
+    Header pendingHeader;
+    bool truncatePending = false;
+    bool shouldExit = false;
+    bool keepOnExit = false;
+
+    static int writerMain(void* user) noexcept;
+    void writeLoop() noexcept;
+    void restart() noexcept;
+    void append(const Funscript& script, bool full, FunscriptTime fromTime, FunscriptTime toTime) noexcept;
+
+public:
+    OFS_EditJournal() noexcept;
+    OFS_EditJournal(const OFS_EditJournal&) = delete;
+    OFS_EditJournal& operator=(const OFS_EditJournal&) = delete;
+    // removes the journal, only a crash leaves it behind
+    ~OFS_EditJournal() noexcept;
+
+    static std::string PathFor(const std::string& projectPath) noexcept;
+    // applies the journal left behind for the project to its scripts
+    // returns the number of applied records
+    static uint32_t Replay(const std::string& projectPath, std::vector<std::shared_ptr<Funscript>>& scripts) noexcept;
+
+    // starts a new journal on top of the project file as it is on disk right now
+    // scripts which still have unsaved edits are recorded in full
+    void Open(const std::string& projectPath, const std::vector<std::shared_ptr<Funscript>>& scripts) noexcept;
+    // has to be called before Funscript::Update resets the pending changes
+    void Record(const std::vector<std::shared_ptr<Funscript>>& scripts) noexcept;
+    // leaves the journal behind on destruction, for when the final save failed
+    void KeepOnClose() noexcept;
+};
@@ -4,8 +4,10 @@
 #include "OFS_DynamicFontAtlas.h"
 #include "OFS_BlockingTask.h"
 #include "OFS_EventSystem.h"
+#include "state/states/ChapterState.h"
 
 #include "subprocess.h"
+#include "SDL_thread.h"
 
 #include <algorithm>
 
@@ -77,6 +79,14 @@ OFS_Project::OFS_Project() noexcept
 
 OFS_Project::~OFS_Project() noexcept
 {
+    if (saveThread) {
+        SDL_WaitThread(saveThread, nullptr);
+        saveThread = nullptr;
+        if (!saveJob->Succeeded && journal) {
+            // the project file is still the old one, the journal has the rest
+            journal->KeepOnClose();
+        }
+    }
 }
 
 void OFS_Project::loadNecessaryGlyphs() noexcept
@@ -130,6 +140,13 @@ bool OFS_Project::Load(const std::string& path) noexcept
         OFS_Binary::Deserialize(projectState.binaryFunscriptData, *this);
         lastPath = path;
         loadNecessaryGlyphs();
+
+        auto recovered = OFS_EditJournal::Replay(lastPath, Funscripts);
+        if (recovered > 0) {
+            LOGF_INFO("Recovered %u edits from the journal.", recovered);
+            Util::MessageBoxAlert(TR(JOURNAL_RECOVERED), FMT(TR(JOURNAL_RECOVERED_MSG), recovered));
+        }
+        openJournal();
     }
 
     return valid;
@@ -196,19 +213,9 @@ bool OFS_Project::ImportFromMedia(const std::string& file) noexcept
     return valid;
 }
 
-bool OFS_Project::AddFunscript(const std::string& path) noexcept
+void OFS_Project::attachFunscript(const std::string& path, std::shared_ptr<Funscript>&& script, const Funscript::Metadata& metadata, bool loaded, bool isFirstFunscript) noexcept
 {
-    bool loadedScript = false;
-
-    bool succ = false;
-    auto jsonText = Util::ReadFileString(path.c_str());
-    auto json = Util::ParseJson(jsonText, &succ);
-
-    auto script = std::make_shared<Funscript>();
-    auto metadata = Funscript::Metadata();
-
-    bool isFirstFunscript = Funscripts.size() == 0;
-    if (succ && script->Deserialize(json, &metadata, isFirstFunscript)) {
+    if (loaded) {
         // Add existing script to project
         script = Funscripts.emplace_back(std::move(script));
         script->UpdateRelativePath(MakePathRelative(path));
@@ -217,7 +224,6 @@ bool OFS_Project::AddFunscript(const std::string& path) noexcept
             auto& projectState = State();
             projectState.metadata = metadata;
         }
-        loadedScript = true;
     }
     else {
         // Add empty script to project
@@ -225,6 +231,16 @@ bool OFS_Project::AddFunscript(const std::string& path) noexcept
         script->UpdateRelativePath(MakePathRelative(path));
         script = Funscripts.emplace_back(std::move(script));
     }
+}
+
+bool OFS_Project::AddFunscript(const std::string& path) noexcept
+{
+    auto script = std::make_shared<Funscript>();
+    auto metadata = Funscript::Metadata();
+
+    bool isFirstFunscript = Funscripts.size() == 0;
+    bool loadedScript = script->DeserializeFile(path, &metadata, isFirstFunscript);
+    attachFunscript(path, std::move(script), metadata, loadedScript, isFirstFunscript);
     return loadedScript;
 }
 
@@ -238,36 +254,146 @@ void OFS_Project::RemoveFunscript(int32_t idx) noexcept
 
 void OFS_Project::Save(const std::string& path, bool clearUnsavedChanges) noexcept
 {
-    {
-        auto& projectState = State();
-        projectState.binaryFunscriptData.clear();
-        auto size = OFS_Binary::Serialize(projectState.binaryFunscriptData, *this);
-        projectState.binaryFunscriptData.resize(size);
+    OFS_PROFILE(__FUNCTION__);
+    // only one save at a time
+    finishSave(true);
+
+    auto& projectState = State();
+    projectState.binaryFunscriptData.clear();
+    auto size = OFS_Binary::Serialize(projectState.binaryFunscriptData, *this);
+    projectState.binaryFunscriptData.resize(size);
+
+    // the timer ticks every frame, it alone doesn't make the project worth rewriting
+    float activeTimer = projectState.activeTimer;
+    projectState.activeTimer = 0.f;
+#if 1
+    auto serializedState = OFS_StateManager::Get()->SerializeProjectAll(true);
+#else
+    auto serializedState = OFS_StateManager::Get()->SerializeProjectAll(false);
+#endif
+    projectState.activeTimer = activeTimer;
+    uint64_t stateHash = std::hash<nlohmann::json>()(serializedState);
+
+    bool isProjectFile = clearUnsavedChanges;
+    if (isProjectFile && stateHash == savedHash && Util::FileExists(path)) {
+        LOGF_INFO("Skipped saving \"%s\" nothing changed.", path.c_str());
+        for (auto& script : Funscripts) script->ClearUnsavedEdits();
+        openJournal();
+        return;
     }
+    serializedState[ProjectState::StateName]["State"]["activeTimer"] = activeTimer;
+
+    auto job = std::make_unique<SaveJob>();
+    job->Path = path;
+    job->ClearUnsavedChanges = clearUnsavedChanges;
+    job->ProjectState = std::move(serializedState);
+    job->StateHash = stateHash;
+    for (auto& script : Funscripts) {
+        job->ScriptVersions.emplace_back(script.get(), script->Version());
+    }
+
+    saveJob = std::move(job);
+    SDL_AtomicSet(&saveFinished, 0);
+    saveThread = SDL_CreateThread(saveThreadMain, "OFS_ProjectSave", this);
+    if (!saveThread) {
+        // save on this thread instead of dropping it
+        writeProject(*saveJob);
+        finishSave(true);
+    }
+}
+
+int OFS_Project::saveThreadMain(void* user) noexcept
+{
+    auto project = (OFS_Project*)user;
+    project->writeProject(*project->saveJob);
+    SDL_AtomicSet(&project->saveFinished, 1);
+    return 0;
+}
 
+void OFS_Project::writeProject(SaveJob& job) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
 #if 1
-    auto projectState = OFS_StateManager::Get()->SerializeProjectAll(true);
-    auto projectBin = Util::SerializeCBOR(projectState);
-    Util::WriteFile(path.c_str(), projectBin.data(), projectBin.size());
+    auto projectBin = Util::SerializeCBOR(job.ProjectState);
 #else
-    auto projectState = OFS_StateManager::Get()->SerializeProjectAll(false);
-    auto projectJson = Util::SerializeJson(projectState, false);
-    Util::WriteFile(path.c_str(), projectJson.data(), projectJson.size());
+    auto projectBin = Util::SerializeJson(job.ProjectState, false);
 #endif
-    if (clearUnsavedChanges) {
-        for (auto& script : Funscripts) {
-            script->ClearUnsavedEdits();
+    job.ProjectState = nlohmann::json();
+    job.Succeeded = Util::WriteFileAtomic(job.Path, projectBin.data(), projectBin.size());
+}
+
+void OFS_Project::finishSave(bool wait) noexcept
+{
+    if (!saveJob) return;
+    if (saveThread && !wait && !SDL_AtomicGet(&saveFinished)) return;
+    OFS_PROFILE(__FUNCTION__);
+    if (saveThread) {
+        SDL_WaitThread(saveThread, nullptr);
+        saveThread = nullptr;
+    }
+    auto job = std::move(saveJob);
+    if (job->ClearUnsavedChanges) {
+        savedHash = job->Succeeded ? job->StateHash : 0;
+    }
+
+    if (!job->Succeeded) {
+        Util::MessageBoxAlert(TR(SAVE_FAILED), FMT(TR(SAVE_FAILED_MSG), job->Path.c_str()));
+        return;
+    }
+    if (job->ClearUnsavedChanges) {
+        for (auto [scriptPtr, version] : job->ScriptVersions) {
+            auto it = std::find_if(Funscripts.begin(), Funscripts.end(),
+                [scriptPtr = scriptPtr](auto& script) noexcept { return script.get() == scriptPtr; });
+            // edits made while saving stay unsaved
+            if (it != Funscripts.end() && (*it)->Version() == version) {
+                (*it)->ClearUnsavedEdits();
+            }
         }
+        // everything up to the snapshot is in the project file now
+        openJournal();
     }
 }
 
+void OFS_Project::openJournal() noexcept
+{
+    if (!journal) journal = std::make_unique<OFS_EditJournal>();
+    journal->Open(lastPath, Funscripts);
+}
+
+static bool sameChapters(const ChapterState& a, const ChapterState& b) noexcept
+{
+    // only compares what ends up in the funscript metadata
+    auto chapterEqual = [](const Chapter& a, const Chapter& b) noexcept {
+        return a.startTime == b.startTime && a.endTime == b.endTime && a.name == b.name;
+    };
+    auto bookmarkEqual = [](const Bookmark& a, const Bookmark& b) noexcept {
+        return a.time == b.time && a.name == b.name;
+    };
+    return std::equal(a.chapters.begin(), a.chapters.end(), b.chapters.begin(), b.chapters.end(), chapterEqual)
+        && std::equal(a.bookmarks.begin(), a.bookmarks.end(), b.bookmarks.begin(), b.bookmarks.end(), bookmarkEqual);
+}
+
 void OFS_Project::Update(float delta, bool idleMode) noexcept
 {
     if (!idleMode) {
         auto& projectState = State();
         projectState.activeTimer += delta;
     }
-    for (auto& script : Funscripts) script->Update();
+    finishSave(false);
+    if (journal) journal->Record(Funscripts);
+    for (auto& script : Funscripts) {
+        script->Update();
+    }
+}
+
+std::shared_ptr<const FunscriptSnapshot> OFS_Project::ScriptSnapshot(Funscript& script) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    auto& chapterState = ChapterState::StaticStateSlow();
+    if (!chapterSnapshot || !sameChapters(*chapterSnapshot, chapterState)) {
+        chapterSnapshot = std::make_shared<const ChapterState>(chapterState);
+    }
+    return script.PublishSnapshot(chapterSnapshot);
 }
 
 bool OFS_Project::HasUnsavedEdits() noexcept
@@ -327,9 +453,10 @@ void OFS_Project::ExportFunscripts() noexcept
     for (auto& script : Funscripts) {
         FUN_ASSERT(!script->RelativePath().empty(), "path is empty");
         if (!script->RelativePath().empty()) {
-            auto json = script->Serialize(state.metadata, true);
+            funscriptWriter.Clear();
+            script->SerializeText(funscriptWriter, state.metadata, true);
             script->ClearUnsavedEdits();
-            auto jsonText = Util::SerializeJson(json, false);
+            auto& jsonText = funscriptWriter.Text();
             Util::WriteFile(MakePathAbsolute(script->RelativePath()).c_str(), jsonText.data(), jsonText.size());
         }
     }
@@ -343,9 +470,10 @@ void OFS_Project::ExportFunscripts(const std::string& outputDir) noexcept
         if (!script->RelativePath().empty()) {
             auto filename = Util::PathFromString(script->RelativePath()).filename();
             auto outputPath = (Util::PathFromString(outputDir) / filename).u8string();
-            auto json = script->Serialize(state.metadata, true);
+            funscriptWriter.Clear();
+            script->SerializeText(funscriptWriter, state.metadata, true);
             script->ClearUnsavedEdits();
-            auto jsonText = Util::SerializeJson(json, false);
+            auto& jsonText = funscriptWriter.Text();
             Util::WriteFile(outputPath.c_str(), jsonText.data(), jsonText.size());
         }
     }
@@ -355,14 +483,27 @@ void OFS_Project::ExportFunscript(const std::string& outputPath, int32_t idx) no
 {
     FUN_ASSERT(idx >= 0 && idx < Funscripts.size(), "out of bounds");
     auto& state = State();
-    auto json = Funscripts[idx]->Serialize(state.metadata, true);
+    funscriptWriter.Clear();
+    Funscripts[idx]->SerializeText(funscriptWriter, state.metadata, true);
     Funscripts[idx]->ClearUnsavedEdits();
     // Using this function changes the default path
     Funscripts[idx]->UpdateRelativePath(MakePathRelative(outputPath));
-    auto jsonText = Util::SerializeJson(json, false);
+    auto& jsonText = funscriptWriter.Text();
     Util::WriteFile(outputPath.c_str(), jsonText.data(), jsonText.size());
 }
 
+bool OFS_Project::ExportResampled(const std::string& outputPath, const FunscriptStreamExport::Settings& settings, float duration) noexcept
+{
+    std::vector<FunscriptStreamExport::Axis> axes;
+    axes.reserve(Funscripts.size());
+    for (auto& script : Funscripts) {
+        auto& actions = script->Actions();
+        if (!actions.empty()) duration = std::max(duration, (float)actions.back().atS);
+        axes.emplace_back(FunscriptStreamExport::Axis{ script->Title(), &actions });
+    }
+    return FunscriptStreamExport::Write(outputPath, axes, duration, settings);
+}
+
 void OFS_Project::loadMultiAxis(const std::string& rootScript) noexcept
 {
     std::vector<std::filesystem::path> relatedFiles;
@@ -409,11 +550,35 @@ void OFS_Project::loadMultiAxis(const std::string& rootScript) noexcept
             }
         }
     }
-    // load the related files
-    for (int i = relatedFiles.size() - 1; i >= 0; i -= 1) {
-        auto& file = relatedFiles[i];
-        auto filePathString = file.u8string();
-        AddFunscript(filePathString);
+    // read and parse the related files in parallel
+    // the scripts are detached until every thread is done and get attached in the usual order
+    struct LoadTask {
+        std::string path;
+        std::shared_ptr<Funscript> script;
+        Funscript::Metadata metadata;
+        bool isFirstFunscript = false;
+        bool loaded = false;
+        SDL_Thread* thread = nullptr;
+    };
+    auto loadThread = [](void* user) -> int {
+        auto task = static_cast<LoadTask*>(user);
+        task->loaded = task->script->DeserializeFile(task->path, &task->metadata, task->isFirstFunscript);
+        return 0;
+    };
+
+    std::vector<LoadTask> tasks(relatedFiles.size());
+    for (int i = relatedFiles.size() - 1, taskIdx = 0; i >= 0; i -= 1, taskIdx += 1) {
+        auto& task = tasks[taskIdx];
+        task.path = relatedFiles[i].u8string();
+        task.script = std::make_shared<Funscript>();
+        // only one task can load chapters so the chapter state is never touched concurrently
+        task.isFirstFunscript = Funscripts.size() == 0 && taskIdx == 0;
+        task.thread = SDL_CreateThread(loadThread, "LoadMultiAxis", &task);
+        if (!task.thread) loadThread(&task);
+    }
+    for (auto& task : tasks) {
+        if (task.thread) SDL_WaitThread(task.thread, nullptr);
+        attachFunscript(task.path, std::move(task.script), task.metadata, task.loaded, task.isFirstFunscript);
     }
 }
 
@@ -1,7 +1,13 @@
 #pragma once
 #include "state/ProjectState.h"
 #include "Funscript.h"
+#include "FunscriptWriter.h"
+#include "FunscriptStreamExport.h"
 #include "OFS_Event.h"
+#include "OFS_EditJournal.h"
+
+#include "SDL_thread.h"
+#include "SDL_atomic.h"
 
 #include <vector>
 #include <memory>
@@ -25,6 +31,34 @@ private:
     std::string notValidError;
     bool valid = false;
 
+    // reused between exports
+    FunscriptWriter funscriptWriter;
+    // published with the funscript snapshots, replaced when a snapshot is asked for after the chapters changed
+    std::shared_ptr<const ChapterState> chapterSnapshot;
+    // edits since the last save, only exists once the project is on disk
+    std::unique_ptr<OFS_EditJournal> journal;
+
+    // state captured on the main thread, encoded and written by the save thread
+    struct SaveJob {
+        std::string Path;
+        nlohmann::json ProjectState;
+        bool ClearUnsavedChanges = false;
+        // edit versions at the time of the snapshot
+        std::vector<std::pair<const Funscript*, uint64_t>> ScriptVersions;
+        // hash of the serialized state without the active timer
+        uint64_t StateHash = 0;
+        bool Succeeded = false;
+    };
+    std::unique_ptr<SaveJob> saveJob;
+    SDL_Thread* saveThread = nullptr;
+    SDL_atomic_t saveFinished = {};
+    // StateHash of the last save to the project path
+    uint64_t savedHash = 0;
+
+    static int saveThreadMain(void* user) noexcept;
+    void writeProject(SaveJob& job) noexcept;
+    void finishSave(bool wait) noexcept;
+
     void addError(const std::string& error) noexcept
     {
         valid = false;
@@ -33,6 +67,8 @@ private:
     }
     void loadNecessaryGlyphs() noexcept;
     void loadMultiAxis(const std::string& rootScript) noexcept;
+    void openJournal() noexcept;
+    void attachFunscript(const std::string& path, std::shared_ptr<Funscript>&& script, const Funscript::Metadata& metadata, bool loaded, bool isFirstFunscript) noexcept;
 
 public:
     static constexpr auto Extension = OFS_PROJECT_EXT;
@@ -46,7 +82,9 @@ public:
 
     bool Load(const std::string& path) noexcept;
     void Save(bool clearUnsavedChanges) noexcept { Save(lastPath, clearUnsavedChanges); }
+    // snapshots the project, encoding and writing happens in the background
     void Save(const std::string& path, bool clearUnsavedChanges) noexcept;
+    inline bool IsSaving() const noexcept { return saveThread != nullptr; }
 
     bool ImportFromFunscript(const std::string& path) noexcept;
     bool ImportFromMedia(const std::string& path) noexcept;
@@ -57,7 +95,8 @@ public:
     void Update(float delta, bool idleMode) noexcept;
     void ShowProjectWindow(bool* open) noexcept;
     bool HasUnsavedEdits() noexcept;
-
+    // main thread only, publishes the script's snapshot with the current chapters if it's out of date
+    std::shared_ptr<const FunscriptSnapshot> ScriptSnapshot(Funscript& script) noexcept;
 
     inline void SetActiveIdx(uint32_t activeIdx) noexcept { State().activeScriptIdx = activeIdx; }
     inline uint32_t ActiveIdx() const noexcept { return State().activeScriptIdx; }
@@ -71,6 +110,8 @@ public:
     void ExportFunscripts() noexcept;
     void ExportFunscripts(const std::string& outputDir) noexcept;
     void ExportFunscript(const std::string& outputPath, int32_t idx) noexcept;
+    // every script as one interleaved fixed-rate sample stream
+    bool ExportResampled(const std::string& outputPath, const FunscriptStreamExport::Settings& settings, float duration) noexcept;
 
     std::string MakePathAbsolute(const std::string& relPath) const noexcept;
     std::string MakePathRelative(const std::string& absPath) const noexcept;
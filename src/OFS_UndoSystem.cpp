@@ -38,7 +38,8 @@ static std::array<Tr, (int32_t)StateType::TOTAL_UNDOSTATE_TYPES> stateTranslatio
     Tr::MOVE_TO_CURRENT_POSITION,
 
     Tr::SIMPLIFY,
-    Tr::LUA_SCRIPT
+    Tr::LUA_SCRIPT,
+    Tr::AUDIO_SYNC
 };
 
 // FIXME: UndoStack and RedoStack should be filtered when scripts are removed / projects change
@@ -60,7 +61,6 @@ const char* UndoSystem::UndoContext::Description() const noexcept
 UndoSystem::UndoSystem() noexcept
 {
     RedoStack.reserve(100);
-    UndoStack.reserve(1000);
 }
 
 void UndoSystem::ShowUndoRedoHistory(bool* open) noexcept
@@ -69,6 +69,9 @@ void UndoSystem::ShowUndoRedoHistory(bool* open) noexcept
     OFS_PROFILE(__FUNCTION__);
     ImGui::SetNextWindowSizeConstraints(ImVec2(200, 100), ImVec2(200, 200));
     ImGui::Begin(TR_ID(UndoSystem::WindowId, Tr::UNDO_REDO_HISTORY), open, ImGuiWindowFlags_AlwaysVerticalScrollbar | ImGuiWindowFlags_AlwaysAutoResize);
+    ImGui::Text("%s: %.1f/%.0f MB", TR(UNDO_MEMORY),
+        FunscriptUndoSystem::MemoryUsage() / (1024.f * 1024.f), memoryLimit / (1024.f * 1024.f));
+    ImGui::Separator();
     ImGui::TextDisabled(TR(REDO_STACK));
 
     for (auto it = RedoStack.begin(), end = RedoStack.end(); it != end; ++it) {
@@ -113,6 +116,23 @@ void UndoSystem::Snapshot(StateType type, UndoContextScripts&& scriptsToSnapshot
             FUN_ASSERT(false, "Stale weak_ptr.");
         }
     }
+    evictOldest();
+}
+
+void UndoSystem::evictOldest() noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    // the most recent step is always kept
+    while (UndoStack.size() > 1 && FunscriptUndoSystem::MemoryUsage() > memoryLimit) {
+        // every script of a context got its state pushed at the same time
+        // so the oldest context owns the oldest state of each of its scripts
+        for (auto& weak : UndoStack.front().Scripts) {
+            if (auto script = weak.lock()) {
+                script->undoSystem->DropOldestUndo();
+            }
+        }
+        UndoStack.pop_front();
+    }
 }
 
 bool UndoSystem::Undo() noexcept
@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <deque>
 #include <memory>
 
 #include "FunscriptUndoSystem.h"
@@ -37,6 +38,7 @@ enum StateType : int32_t {
 
     SIMPLIFY = 21,
     CUSTOM_LUA = 22,
+    AUDIO_SYNC = 23,
     // add more here & update stateStrings in UndoSystem.cpp
 
 
@@ -58,9 +60,12 @@ private:
         const char* Description() const noexcept;
     };
 
-    std::vector<UndoContext> UndoStack;
+    std::deque<UndoContext> UndoStack;
     std::vector<UndoContext> RedoStack;
+    size_t memoryLimit = 256 * 1024 * 1024;
     void ClearRedo() noexcept;
+    // drops the oldest undo steps until the states of all scripts fit into the limit
+    void evictOldest() noexcept;
 
 public:
     UndoSystem() noexcept;
@@ -77,7 +82,10 @@ public:
     bool Undo() noexcept;
     bool Redo() noexcept;
 
+    inline void SetMemoryLimit(size_t bytes) noexcept { memoryLimit = bytes; evictOldest(); }
+
     inline bool MatchUndoTop(int32_t type) const noexcept { return !UndoEmpty() && UndoStack.back().Type == type; }
+    inline bool MatchRedoTop(int32_t type) const noexcept { return !RedoEmpty() && RedoStack.back().Type == type; }
     inline bool UndoEmpty() const noexcept { return UndoStack.empty(); }
     inline bool RedoEmpty() const noexcept { return RedoStack.empty(); }
 };
@@ -42,7 +42,7 @@ static constexpr const char* ActionEditorWindowId = "###ACTION_EDITOR";
 static constexpr int DefaultWidth = 1920;
 static constexpr int DefaultHeight = 1080;
 
-static constexpr int AutoBackupIntervalSeconds = 60;
+static constexpr int AutoBackupIntervalSeconds = 600;
 
 bool OpenFunscripter::imguiSetup() noexcept
 {
@@ -118,6 +118,7 @@ bool OpenFunscripter::Init(int argc, char* argv[])
     OFS_FileLogger::Init();
     Util::InMainThread();
     Util::InitRandom();
+    frameArena.MakeCurrent();
 
     FUN_ASSERT(!ptr, "there can only be one instance");
     ptr = this;
@@ -222,6 +223,7 @@ bool OpenFunscripter::Init(int argc, char* argv[])
 
     playerControls.Init(player.get(), prefState.forceHwDecoding);
     undoSystem = std::make_unique<UndoSystem>();
+    undoSystem->SetMemoryLimit((size_t)prefState.undoMemoryLimit * 1024 * 1024);
 
     keys = std::make_unique<OFS_KeybindingSystem>();
     registerBindings();
@@ -272,6 +274,7 @@ bool OpenFunscripter::Init(int argc, char* argv[])
     webApi->Init();
 
     chapterMgr = std::make_unique<OFS_ChapterManager>();
+    audioSync = std::make_unique<OFS_AudioSync>();
 #ifdef WIN32
     OFS_DownloadFfmpeg::FfmpegMissing = !Util::FileExists(Util::FfmpegPath().u8string());
 #endif
@@ -793,8 +796,8 @@ void OpenFunscripter::registerBindings()
         if (app->ActiveFunscript()->HasSelection()) {
 
             auto time = forward
-                ? app->scripting->SteppingIntervalForward(app->ActiveFunscript()->Selection().front().atS)
-                : app->scripting->SteppingIntervalBackward(app->ActiveFunscript()->Selection().front().atS);
+                ? app->scripting->SteppingIntervalForward(app->ActiveFunscript()->SelectionFront()->atS)
+                : app->scripting->SteppingIntervalBackward(app->ActiveFunscript()->SelectionFront()->atS);
 
             app->undoSystem->Snapshot(StateType::ACTIONS_MOVED, app->ActiveFunscript());
             app->ActiveFunscript()->MoveSelectionTime(time, app->scripting->LogicalFrameTime());
@@ -821,8 +824,8 @@ void OpenFunscripter::registerBindings()
         auto app = OpenFunscripter::ptr;
         if (app->ActiveFunscript()->HasSelection()) {
             auto time = forward
-                ? app->scripting->SteppingIntervalForward(app->ActiveFunscript()->Selection().front().atS)
-                : app->scripting->SteppingIntervalBackward(app->ActiveFunscript()->Selection().front().atS);
+                ? app->scripting->SteppingIntervalForward(app->ActiveFunscript()->SelectionFront()->atS)
+                : app->scripting->SteppingIntervalBackward(app->ActiveFunscript()->SelectionFront()->atS);
 
             app->undoSystem->Snapshot(StateType::ACTIONS_MOVED, app->ActiveFunscript());
             app->ActiveFunscript()->MoveSelectionTime(time, app->scripting->LogicalFrameTime());
@@ -831,7 +834,7 @@ void OpenFunscripter::registerBindings()
                 app->player->SetPositionExact(closest->atS);
             }
             else {
-                app->player->SetPositionExact(app->ActiveFunscript()->Selection().front().atS);
+                app->player->SetPositionExact(app->ActiveFunscript()->SelectionFront()->atS);
             }
         }
         else {
@@ -1368,12 +1371,16 @@ void OpenFunscripter::FunscriptChanged(const FunscriptActionsChangedEvent* ev) n
     auto ptr = ev->Script;
     for (int i = 0, size = LoadedFunscripts().size(); i < size; i += 1) {
         if (LoadedFunscripts()[i].get() == ptr) {
-            extensions->ScriptChanged(i);
+            extensions->ScriptChanged(i, ev->Change);
             break;
         }
     }
 
-    Status = Status | OFS_Status::OFS_GradientNeedsUpdate;
+    // only the active script is shown in the heatmap
+    if (ptr == ActiveFunscript().get()) {
+        gradientChange.Merge(ev->Change);
+        Status = Status | OFS_Status::OFS_GradientNeedsUpdate;
+    }
 }
 
 void OpenFunscripter::ScriptTimelineActionClicked(const FunscriptActionClickedEvent* ev) noexcept
@@ -1430,6 +1437,7 @@ void OpenFunscripter::VideoDuration(const DurationChangeEvent* ev) noexcept
     auto& projectState = LoadedProject->State();
     projectState.metadata.duration = player->Duration();
     player->SetPositionExact(projectState.lastPlayerPosition);
+    gradientChange.Full = true;
     Status |= OFS_Status::OFS_GradientNeedsUpdate;
 }
 
@@ -1563,6 +1571,7 @@ void OpenFunscripter::setIdle(bool idle) noexcept
 void OpenFunscripter::Step() noexcept
 {
     OFS_BEGINPROFILING();
+    frameArena.Reset();
     {
         OFS_PROFILE(__FUNCTION__);
         processEvents();
@@ -1605,6 +1614,7 @@ void OpenFunscripter::Step() noexcept
             OFS_FileLogger::DrawLogWindow(&ofsState.showDebugLog);
             keys->RenderKeybindingWindow();
             chapterMgr->ShowWindow(&ofsState.showChapterManager);
+            audioSync->ShowWindow(&ofsState.showAudioSync);
 
             if (preferences->ShowPreferenceWindow()) {}
 
@@ -1612,7 +1622,14 @@ void OpenFunscripter::Step() noexcept
 
             if (Status & OFS_GradientNeedsUpdate) {
                 Status &= ~(OFS_GradientNeedsUpdate);
-                playerControls.UpdateHeatmap(player->Duration(), ActiveFunscript()->Actions());
+                if (gradientChange.IsFull()) {
+                    playerControls.UpdateHeatmap(player->Duration(), ActiveFunscript()->Columns());
+                }
+                else {
+                    playerControls.UpdateHeatmapRange(player->Duration(), ActiveFunscript()->Columns(),
+                        gradientChange.FromTime, gradientChange.ToTime);
+                }
+                gradientChange = FunscriptChange();
             }
 
             playerControls.DrawTimeline();
@@ -1748,13 +1765,19 @@ void OpenFunscripter::Shutdown() noexcept
 void OpenFunscripter::Undo() noexcept
 {
     OFS_PROFILE(__FUNCTION__);
-    if (undoSystem->Undo()) scripting->Undo();
+    if (undoSystem->Undo()) {
+        scripting->Undo();
+        if (undoSystem->MatchRedoTop((int32_t)StateType::AUDIO_SYNC)) audioSync->ApplyUndone();
+    }
 }
 
 void OpenFunscripter::Redo() noexcept
 {
     OFS_PROFILE(__FUNCTION__);
-    if (undoSystem->Redo()) scripting->Redo();
+    if (undoSystem->Redo()) {
+        scripting->Redo();
+        if (undoSystem->MatchUndoTop((int32_t)StateType::AUDIO_SYNC)) audioSync->ApplyRedone();
+    }
 }
 
 void OpenFunscripter::openFile(const std::string& file) noexcept
@@ -1838,6 +1861,7 @@ void OpenFunscripter::UpdateNewActiveScript(uint32_t activeIndex) noexcept
 {
     LoadedProject->SetActiveIdx(activeIndex);
     updateTitle();
+    gradientChange.Full = true;
     Status = Status | OFS_Status::OFS_GradientNeedsUpdate;
 }
 
@@ -1966,10 +1990,7 @@ void OpenFunscripter::copySelection() noexcept
 {
     OFS_PROFILE(__FUNCTION__);
     if (ActiveFunscript()->HasSelection()) {
-        CopiedSelection.clear();
-        for (auto action : ActiveFunscript()->Selection()) {
-            CopiedSelection.emplace(action);
-        }
+        CopiedSelection = ActiveFunscript()->GetSelectedActions();
     }
 }
 
@@ -1983,13 +2004,16 @@ void OpenFunscripter::pasteSelection() noexcept
     float currentTime = player->CurrentTime();
     float offsetTime = currentTime - CopiedSelection.begin()->atS;
 
-    ActiveFunscript()->RemoveActionsInInterval(
-        currentTime - 0.0005f,
-        currentTime + (CopiedSelection.back().atS - CopiedSelection.front().atS + 0.0005f));
-
+    FunscriptArray pasted;
+    pasted.reserve(CopiedSelection.size());
     for (auto&& action : CopiedSelection) {
-        ActiveFunscript()->AddAction(FunscriptAction(action.atS + offsetTime, action.pos));
+        pasted.emplace_back_unsorted(FunscriptAction(action.atS + offsetTime, action.pos));
     }
+    ActiveFunscript()->ReplaceActionsInInterval(
+        currentTime - 0.0005f,
+        currentTime + (CopiedSelection.back().atS - CopiedSelection.front().atS + 0.0005f),
+        pasted);
+
     float newPosTime = (CopiedSelection.end() - 1)->atS + offsetTime;
     player->SetPositionExact(newPosTime);
 }
@@ -2000,13 +2024,12 @@ void OpenFunscripter::pasteSelectionExact() noexcept
     if (CopiedSelection.empty()) return;
 
     undoSystem->Snapshot(StateType::PASTE_COPIED_ACTIONS, ActiveFunscript());
+    // paste without altering timestamps
     if (CopiedSelection.size() >= 2) {
-        ActiveFunscript()->RemoveActionsInInterval(CopiedSelection.front().atS, CopiedSelection.back().atS);
+        ActiveFunscript()->ReplaceActionsInInterval(CopiedSelection.front().atS, CopiedSelection.back().atS, CopiedSelection);
     }
-
-    // paste without altering timestamps
-    for (auto&& action : CopiedSelection) {
-        ActiveFunscript()->AddAction(action);
+    else {
+        ActiveFunscript()->AddMultipleActions(CopiedSelection);
     }
 }
 
@@ -2031,7 +2054,7 @@ void OpenFunscripter::equalizeSelection() noexcept
             }
         }
     }
-    else if (ActiveFunscript()->Selection().size() >= 3) {
+    else if (ActiveFunscript()->SelectionSize() >= 3) {
         undoSystem->Snapshot(StateType::EQUALIZE_ACTIONS, ActiveFunscript());
         ActiveFunscript()->EqualizeSelection();
     }
@@ -2050,7 +2073,7 @@ void OpenFunscripter::invertSelection() noexcept
             ActiveFunscript()->ClearSelection();
         }
     }
-    else if (ActiveFunscript()->Selection().size() >= 3) {
+    else if (ActiveFunscript()->SelectionSize() >= 3) {
         undoSystem->Snapshot(StateType::INVERT_ACTIONS, ActiveFunscript());
         ActiveFunscript()->InvertSelection();
     }
@@ -2121,6 +2144,23 @@ void OpenFunscripter::saveActiveScriptAs()
         { "Funscript", "*.funscript" });
 }
 
+void OpenFunscripter::exportResampled() noexcept
+{
+    auto& ofsState = OpenFunscripterState::State(stateHandle);
+    auto savePath = Util::PathFromString(ofsState.lastPath) / (ActiveFunscript()->Title() + ".ofsr");
+    Util::SaveFileDialog(TR(EXPORT_RESAMPLED), savePath.u8string(),
+        [this](auto& result) {
+            if (result.files.size() > 0) {
+                LoadedProject->ExportResampled(result.files[0], resampleSettings, player->Duration());
+                auto dir = Util::PathFromString(result.files[0]);
+                dir.remove_filename();
+                auto& ofsState = OpenFunscripterState::State(stateHandle);
+                ofsState.lastPath = dir.u8string();
+            }
+        },
+        { "Resampled stream", "*.ofsr" });
+}
+
 void OpenFunscripter::ShowMainMenuBar() noexcept
 {
 #define BINDING_STRING(binding) nullptr // TODO: keybinds.getBindingString(binding)
@@ -2215,6 +2255,28 @@ void OpenFunscripter::ShowMainMenuBar() noexcept
                             });
                     }
                 }
+                bool resampleMenu = ImGui::BeginMenu(FMT(ICON_SHARE " %s", TR(EXPORT_RESAMPLED)));
+                OFS::Tooltip(TR(EXPORT_RESAMPLED_TOOLTIP));
+                if (resampleMenu) {
+                    using Format = FunscriptStreamExport::SampleFormat;
+                    using Mode = FunscriptSpline::Interpolation;
+                    auto& settings = resampleSettings;
+                    for (uint32_t rate : { 250u, 500u, 1000u }) {
+                        if (ImGui::MenuItem(FMT("%u Hz", rate), NULL, settings.SampleRate == rate)) settings.SampleRate = rate;
+                    }
+                    ImGui::Separator();
+                    if (ImGui::MenuItem("8 bit", NULL, settings.Format == Format::U8)) settings.Format = Format::U8;
+                    if (ImGui::MenuItem("16 bit", NULL, settings.Format == Format::U16)) settings.Format = Format::U16;
+                    ImGui::Separator();
+                    bool spline = settings.Mode == Mode::Spline;
+                    if (ImGui::MenuItem(TR(SPLINE), NULL, &spline)) settings.Mode = spline ? Mode::Spline : Mode::Linear;
+                    OFS::Tooltip(TR(SPLINE_TOOLTIP));
+                    ImGui::Separator();
+                    if (ImGui::MenuItem(TR(EXPORT_MENU))) {
+                        exportResampled();
+                    }
+                    ImGui::EndMenu();
+                }
                 ImGui::EndMenu();
             }
             ImGui::Separator();
@@ -2237,6 +2299,7 @@ void OpenFunscripter::ShowMainMenuBar() noexcept
             if (ImGui::MenuItem(TR(PICK_DIFFERENT_MEDIA))) {
                 pickDifferentMedia();
             }
+            if (ImGui::MenuItem(TR(AUDIO_SYNC), NULL, &ofsState.showAudioSync)) {}
             if (ImGui::BeginMenu(TR(ADD_MENU), LoadedProject->IsValid())) {
                 auto fileAlreadyLoaded = [](const std::string& path) noexcept -> bool {
                     auto app = OpenFunscripter::ptr;
@@ -2599,6 +2662,9 @@ void OpenFunscripter::ShowMainMenuBar() noexcept
         if (IdleMode) {
             ImGui::TextUnformatted(ICON_LEAF);
         }
+        if (LoadedProject->IsSaving()) {
+            ImGui::TextDisabled(ICON_REFRESH " %s", TR(SAVING));
+        }
         if (player->VideoLoaded() && unsavedEdits) {
             const float timeUnit = saveDuration.count() / 60.f;
             ImGui::SameLine(region.x - ImGui::GetFontSize() * 13.5f);
@@ -2742,6 +2808,91 @@ void OpenFunscripter::ShowStatisticsWindow(bool* open) noexcept
         }
     }
 
+    auto& ofsState = OpenFunscripterState::State(stateHandle);
+    auto& statsSettings = ofsState.statisticsSettings;
+    FunscriptStatistics::Settings settings;
+    settings.SpeedLimit = statsSettings.speedLimit;
+    settings.GapThreshold = statsSettings.pauseThreshold;
+
+    auto& script = ActiveFunscript();
+    auto& stats = script->Statistics(settings);
+    auto& strokes = script->Strokes();
+    auto& total = stats.Total();
+
+    // strokes between the first and last turning point inside of the range
+    auto strokesInRange = [&strokes](float fromTime, float toTime) noexcept {
+        auto& points = strokes.TurningPoints();
+        auto first = std::lower_bound(points.begin(), points.end(), FunscriptAction(fromTime, 0), ActionLess());
+        auto last = std::upper_bound(points.begin(), points.end(), FunscriptAction(toTime, 0), ActionLess());
+        auto count = std::distance(first, last);
+        return count > 1 ? (uint32_t)count - 1 : 0;
+    };
+
+    ImGui::Separator();
+    ImGui::TextUnformatted(TR(WHOLE_SCRIPT));
+    ImGui::Text("%s: %u", TR(ACTION_COUNT), (uint32_t)script->Actions().size());
+    ImGui::Text("%s: %u", TR(STROKE_COUNT), strokes.Count());
+    {
+        auto& columns = script->Columns();
+        auto positionRange = columns.MinMaxPosition(columns.All());
+        ImGui::Text("%s: %.0f - %.0f", TR(POSITION_RANGE), positionRange.Min, positionRange.Max);
+    }
+    ImGui::Text("%s: %.02f units/s", TR(AVERAGE_SPEED), total.AverageSpeed());
+    ImGui::Text("%s: %.02f units/s", TR(PEAK_SPEED), total.MaxSpeed);
+    float movingTime = total.MovingTime();
+    ImGui::Text("%s: %.2f s (%.1f%%)", TR(ABOVE_SPEED_LIMIT), total.TimeAboveLimit,
+        movingTime > 0.f ? total.TimeAboveLimit / movingTime * 100.f : 0.f);
+    ImGui::Text("%s: %u (%.2f s)", TR(PAUSES), total.Gaps, total.GapTime);
+
+    std::array<float, FunscriptStatistics::HistogramBuckets> histogram;
+    for (uint32_t i = 0; i < histogram.size(); ++i) {
+        histogram[i] = movingTime > 0.f ? total.SpeedHistogram[i] / movingTime * 100.f : 0.f;
+    }
+    ImGui::PlotHistogram("##speedHistogram", histogram.data(), histogram.size(), 0,
+        FMT("%s 0 - %d+ units/s", TR(SPEED_HISTOGRAM), (int)(FunscriptStatistics::HistogramBucketWidth * (histogram.size() - 1))),
+        0.f, 100.f, ImVec2(-1.f, ImGui::GetFontSize() * 4.f));
+    if (ImGui::IsItemHovered() && movingTime > 0.f) {
+        float rel = (ImGui::GetMousePos().x - ImGui::GetItemRectMin().x) / ImGui::GetItemRectSize().x;
+        uint32_t bucket = std::min((uint32_t)(rel * histogram.size()), (uint32_t)histogram.size() - 1);
+        float bucketFrom = bucket * FunscriptStatistics::HistogramBucketWidth;
+        ImGui::SetTooltip("%.0f - %.0f units/s: %.1f%%", bucketFrom, bucketFrom + FunscriptStatistics::HistogramBucketWidth, histogram[bucket]);
+    }
+
+    if (ImGui::TreeNode(TR(SETTINGS))) {
+        ImGui::DragFloat(TR(SPEED_LIMIT), &statsSettings.speedLimit, 1.f, 1.f, 2000.f, "%.0f units/s", ImGuiSliderFlags_AlwaysClamp);
+        ImGui::DragFloat(TR(PAUSE_THRESHOLD), &statsSettings.pauseThreshold, 0.1f, 0.1f, 600.f, "%.1f s", ImGuiSliderFlags_AlwaysClamp);
+        OFS::Tooltip(TR(PAUSE_THRESHOLD_TOOLTIP));
+        ImGui::TreePop();
+    }
+
+    auto& chapters = chapterMgr->State().chapters;
+    if (!chapters.empty() && ImGui::TreeNode(TR(CHAPTERS))) {
+        if (ImGui::BeginTable("##chapterStatistics", 5, ImGuiTableFlags_Resizable)) {
+            ImGui::TableSetupColumn(TR(CHAPTER));
+            ImGui::TableSetupColumn(TR(STROKE_COUNT));
+            ImGui::TableSetupColumn(TR(AVERAGE_SPEED));
+            ImGui::TableSetupColumn(TR(PEAK_SPEED));
+            ImGui::TableSetupColumn(TR(ABOVE_SPEED_LIMIT));
+            ImGui::TableHeadersRow();
+            for (auto& chapter : chapters) {
+                auto chapterStats = stats.Range(script->Columns(), chapter.startTime, chapter.endTime);
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(chapter.name.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", strokesInRange(chapter.startTime, chapter.endTime));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.02f", chapterStats.AverageSpeed());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.02f", chapterStats.MaxSpeed);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f s", chapterStats.TimeAboveLimit);
+            }
+            ImGui::EndTable();
+        }
+        ImGui::TreePop();
+    }
+
     ImGui::End();
 }
 
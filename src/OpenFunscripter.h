@@ -22,6 +22,8 @@
 #include "OFS_VideoplayerWindow.h"
 #include "OFS_WebsocketApi.h"
 #include "OFS_ChapterManager.h"
+#include "OFS_AudioSync.h"
+#include "OFS_FrameArena.h"
 
 #include <memory>
 #include <chrono>
@@ -52,6 +54,8 @@ private:
     uint32_t IdleTimer = 0;
 
     FunscriptArray CopiedSelection;
+    FunscriptChange gradientChange;
+    FunscriptStreamExport::Settings resampleSettings;
     std::chrono::steady_clock::time_point lastBackup;
 
     char tmpBuf[2][32];
@@ -112,6 +116,7 @@ private:
     void addEditAction(int pos) noexcept;
 
     void saveActiveScriptAs();
+    void exportResampled() noexcept;
 
     void openFile(const std::string& file) noexcept;
     void initProject() noexcept;
@@ -136,6 +141,8 @@ public:
 
     ~OpenFunscripter() noexcept;
 
+    // scratch memory of the main thread, reset every frame
+    OFS_FrameArena frameArena;
     ScriptTimeline scriptTimeline;
     OFS_VideoplayerControls playerControls;
     ScriptSimulator simulator;
@@ -153,6 +160,7 @@ public:
     std::unique_ptr<OFS_FunscriptMetadataEditor> metadataEditor;
     std::unique_ptr<OFS_WebsocketApi> webApi;
     std::unique_ptr<OFS_ChapterManager> chapterMgr;
+    std::unique_ptr<OFS_AudioSync> audioSync;
 
     std::unique_ptr<OFS_Project> LoadedProject;
 
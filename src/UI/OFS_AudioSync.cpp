@@ -0,0 +1,134 @@
+#include "OFS_AudioSync.h"
+
+#include "OpenFunscripter.h"
+#include "OFS_Localization.h"
+#include "OFS_ImGui.h"
+#include "OFS_Profiling.h"
+#include "OFS_Util.h"
+
+#include "imgui.h"
+#include "imgui_stdlib.h"
+
+void OFS_AudioSync::applyToScripts(const std::vector<OFS_WaveformSync::Segment>& segments) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    auto app = OpenFunscripter::ptr;
+    auto& scripts = app->LoadedFunscripts();
+
+    // every axis in one undo step
+    UndoContextScripts snapshotScripts;
+    for (auto& script : scripts) snapshotScripts.emplace_back(script);
+    app->undoSystem->Snapshot(StateType::AUDIO_SYNC, std::move(snapshotScripts));
+
+    for (auto& script : scripts) {
+        // actions in parts of the reference which were cut from the current media are dropped
+        FunscriptArray warped;
+        for (auto action : script->Actions()) {
+            float time;
+            if (!OFS_WaveformSync::ToCurrentTime(segments, action.atS, &time)) continue;
+            action.atS = time;
+            warped.emplace(action);
+        }
+        script->ClearSelection();
+        script->SetActions(warped);
+    }
+}
+
+void OFS_AudioSync::ShowWindow(bool* open) noexcept
+{
+    if (!*open) return;
+    OFS_PROFILE(__FUNCTION__);
+    auto app = OpenFunscripter::ptr;
+    auto& wave = app->scriptTimeline.Wave.data;
+    auto pyramid = wave.Pyramid();
+
+    ImGui::Begin(TR_ID("AudioSync", Tr::AUDIO_SYNC), open, ImGuiWindowFlags_None);
+
+    ImGui::InputText(TR(REFERENCE_MEDIA), &referencePath);
+    ImGui::SameLine();
+    if (ImGui::Button(TR(CHANGE))) {
+        Util::OpenFileDialog(TR(REFERENCE_MEDIA), app->LoadedProject->MediaPath(),
+            [this](auto& result) {
+                if (!result.files.empty()) referencePath = result.files[0];
+            });
+    }
+
+    if (sync.Busy()) {
+        ImGui::TextUnformatted(sync.CurrentStage() == OFS_WaveformSync::Stage::DecodingReference
+            ? TR(DECODING_REFERENCE) : TR(ALIGNING_AUDIO));
+        ImGui::SameLine();
+        OFS::Spinner("##AudioSyncSpin", ImGui::GetFontSize() / 3.f, 4.f, ImGui::GetColorU32(ImGuiCol_TabActive));
+        ImGui::SameLine();
+        if (ImGui::Button(TR(CANCEL))) sync.Cancel();
+    }
+    else {
+        // the waveform of the current media has to be complete,
+        // waveforms restored from older projects don't know their sample rate
+        bool hasSampleRate = pyramid && pyramid->SamplesPerSecond() > 0.f;
+        bool canAlign = hasSampleRate && !wave.BusyGenerating() && Util::FileExists(referencePath);
+        ImGui::BeginDisabled(!canAlign);
+        if (ImGui::Button(TR(ALIGN_TO_REFERENCE))) {
+            sync.Start(pyramid, Util::FfmpegPath().u8string(), referencePath);
+        }
+        ImGui::EndDisabled();
+        if (!hasSampleRate && ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+            ImGui::SetTooltip("%s", pyramid ? TR(AUDIO_SYNC_OLD_WAVEFORM) : TR(DETECT_TEMPO_NO_WAVEFORM));
+        }
+    }
+
+    auto result = sync.GetResult();
+    if (!result || result->Source != pyramid || sync.Busy()) {
+        ImGui::End();
+        return;
+    }
+    if (!result->Decoded) {
+        ImGui::TextUnformatted(TR(REFERENCE_DECODE_FAILED));
+        ImGui::End();
+        return;
+    }
+    if (result->Segments.empty()) {
+        ImGui::TextUnformatted(TR(NO_ALIGNMENT_FOUND));
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Separator();
+    if (ImGui::BeginTable("##audioSyncTable", 4, ImGuiTableFlags_Resizable)) {
+        ImGui::TableSetupColumn(TR(MEDIA), ImGuiTableColumnFlags_None);
+        ImGui::TableSetupColumn(TR(REFERENCE_MEDIA), ImGuiTableColumnFlags_None);
+        ImGui::TableSetupColumn(TR(OFFSET), ImGuiTableColumnFlags_None);
+        ImGui::TableSetupColumn(TR(SCORE), ImGuiTableColumnFlags_None);
+        ImGui::TableHeadersRow();
+
+        char startBuf[16];
+        char endBuf[16];
+        for (auto& segment : result->Segments) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            Util::FormatTime(startBuf, sizeof(startBuf), segment.CurrentStart, true);
+            Util::FormatTime(endBuf, sizeof(endBuf), segment.CurrentEnd, true);
+            ImGui::Text("%s - %s", startBuf, endBuf);
+
+            ImGui::TableNextColumn();
+            Util::FormatTime(startBuf, sizeof(startBuf), segment.ReferenceStart, true);
+            Util::FormatTime(endBuf, sizeof(endBuf), segment.ReferenceEnd, true);
+            ImGui::Text("%s - %s", startBuf, endBuf);
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%+.3fs", segment.CurrentStart - segment.ReferenceStart);
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", segment.Score);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::BeginDisabled(result == appliedResult || app->LoadedFunscripts().empty());
+    if (ImGui::Button(TR(APPLY_TO_ALL_SCRIPTS), ImVec2(-1.f, 0.f))) {
+        applyToScripts(result->Segments);
+        appliedResult = result;
+        undoneResult.reset();
+    }
+    ImGui::EndDisabled();
+    ImGui::End();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "OFS_WaveformSync.h"
+
+#include <string>
+#include <memory>
+
+// Re-times all scripts of a project made for a different cut or encode of the media.
+class OFS_AudioSync
+{
+    private:
+    OFS_WaveformSync sync;
+    std::string referencePath;
+    // the result which was already applied, applying it twice would warp the scripts twice
+    std::shared_ptr<const OFS_WaveformSync::Result> appliedResult;
+    // the applied result while its undo step is on the redo stack
+    std::shared_ptr<const OFS_WaveformSync::Result> undoneResult;
+
+    void applyToScripts(const std::vector<OFS_WaveformSync::Segment>& segments) noexcept;
+
+    public:
+    OFS_AudioSync() noexcept = default;
+    OFS_AudioSync(const OFS_AudioSync&) = delete;
+    OFS_AudioSync(OFS_AudioSync&&) = delete;
+
+    void ShowWindow(bool* open) noexcept;
+
+    // called when the AUDIO_SYNC undo step was undone or redone
+    inline void ApplyUndone() noexcept { undoneResult = std::move(appliedResult); }
+    inline void ApplyRedone() noexcept { appliedResult = std::move(undoneResult); }
+};
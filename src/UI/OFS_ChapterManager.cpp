@@ -5,6 +5,7 @@
 #include "OFS_EventSystem.h"
 #include "OFS_VideoplayerEvents.h"
 #include "OFS_Localization.h"
+#include "FunscriptWriter.h"
 
 #include "imgui.h"
 #include "imgui_stdlib.h"
@@ -99,6 +100,7 @@ bool OFS_ChapterManager::ExportClip(const Chapter& chapter, const std::string& o
 
     auto& projectState = app->LoadedProject->State();
 
+    FunscriptWriter funscriptWriter;
     for(auto& script : app->LoadedFunscripts())
     {
         auto scriptOutputPath = (outputDir / (chapter.name + "_" + script->Title()));
@@ -114,8 +116,9 @@ bool OFS_ChapterManager::ExportClip(const Chapter& chapter, const std::string& o
         clippedScript.MoveSelectionTime(-chapter.startTime, 0.f);
 
         // FIXME: chapters and bookmarks are not included
-        auto funscriptJson = clippedScript.Serialize(projectState.metadata, false);
-        auto funscriptText = Util::SerializeJson(funscriptJson);
+        funscriptWriter.Clear();
+        clippedScript.SerializeText(funscriptWriter, projectState.metadata, false);
+        auto& funscriptText = funscriptWriter.Text();
         Util::WriteFile(scriptOutputPathStr.c_str(), funscriptText.data(), funscriptText.size());
     }
 
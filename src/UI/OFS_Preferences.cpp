@@ -190,6 +190,12 @@ bool OFS_Preferences::ShowPreferenceWindow() noexcept
 						state.fastStepAmount = Util::Clamp<int32_t>(state.fastStepAmount, 2, 30);
 					}
 					OFS::Tooltip(TR(FAST_FRAME_STEP_TOOLTIP));
+					if (ImGui::InputInt(TR(UNDO_MEMORY_LIMIT), &state.undoMemoryLimit, 16, 128)) {
+						save = true;
+						state.undoMemoryLimit = Util::Clamp<int32_t>(state.undoMemoryLimit, 16, 16384);
+						OpenFunscripter::ptr->undoSystem->SetMemoryLimit((size_t)state.undoMemoryLimit * 1024 * 1024);
+					}
+					OFS::Tooltip(TR(UNDO_MEMORY_LIMIT_TOOLTIP));
 					ImGui::Separator();
 					if (ImGui::Checkbox(TR(SHOW_METADATA_DIALOG_ON_NEW_PROJECT), &state.showMetaOnNew)) {
 						save = true;
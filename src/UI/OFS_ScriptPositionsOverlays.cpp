@@ -1,7 +1,9 @@
 #include "OFS_ScriptPositionsOverlays.h"
 #include "OpenFunscripter.h"
+#include "OFS_ImGui.h"
 
 #include "state/ProjectState.h"
+#include "state/states/ChapterState.h"
 
 void FrameOverlay::DrawScriptPositionContent(const OverlayDrawingCtx& ctx) noexcept
 {
@@ -148,6 +150,62 @@ void TempoOverlay::DrawSettings() noexcept
     }
 
     ImGui::Text("%s: %.2fms", TR(INTERVAL), static_cast<float>(((60.f * 1000.f) / tempo.bpm) * beatMultiples[tempo.measureIndex]));
+    drawTempoDetection();
+}
+
+void TempoOverlay::drawTempoDetection() noexcept
+{
+    auto app = OpenFunscripter::ptr;
+    auto& tempo = TempoOverlayState::State(stateHandle);
+    auto pyramid = timeline->Wave.data.Pyramid();
+
+    ImGui::Separator();
+    if (tempoAnalysis.Busy()) {
+        ImGui::TextUnformatted(TR(DETECTING_TEMPO));
+        ImGui::SameLine();
+        OFS::Spinner("##TempoSpin", ImGui::GetFontSize() / 3.f, 4.f, ImGui::GetColorU32(ImGuiCol_TabActive));
+    }
+    else {
+        // the waveform has to be complete, a partial one only covers the start of the video
+        bool canDetect = pyramid && !timeline->Wave.data.BusyGenerating();
+        ImGui::BeginDisabled(!canDetect);
+        if (ImGui::Button(TR(DETECT_TEMPO))) {
+            // chapters get a tempo each, otherwise the whole video is split where the tempo changes
+            std::vector<OFS_WaveformTempo::Interval> intervals;
+            for (auto& chapter : app->chapterMgr->State().chapters) {
+                intervals.emplace_back(OFS_WaveformTempo::Interval{ chapter.startTime, chapter.endTime });
+            }
+            tempoAnalysis.Start(pyramid, (float)app->player->Duration(), std::move(intervals));
+        }
+        ImGui::EndDisabled();
+        if (!pyramid && ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+            ImGui::SetTooltip("%s", TR(DETECT_TEMPO_NO_WAVEFORM));
+        }
+    }
+    ImGui::Checkbox(TR(SNAP_TO_ONSETS), &tempo.snapToOnsets);
+
+    auto result = tempoAnalysis.GetResult();
+    if (!result || result->Source != pyramid) return;
+    if (result->Segments.empty()) {
+        ImGui::TextUnformatted(TR(NO_TEMPO_DETECTED));
+        return;
+    }
+
+    char startBuf[16];
+    char endBuf[16];
+    for (int i = 0, size = result->Segments.size(); i < size; i += 1) {
+        auto& segment = result->Segments[i];
+        ImGui::PushID(i);
+        Util::FormatTime(startBuf, sizeof(startBuf), segment.StartTime, false);
+        Util::FormatTime(endBuf, sizeof(endBuf), segment.EndTime, false);
+        if (ImGui::Button(TR(APPLY))) {
+            tempo.bpm = segment.Bpm;
+            tempo.beatOffsetSeconds = segment.BeatOffset;
+        }
+        ImGui::SameLine();
+        ImGui::Text("%s - %s  %.2f %s  %.3fs", startBuf, endBuf, segment.Bpm, TR(BPM), segment.BeatOffset);
+        ImGui::PopID();
+    }
 }
 
 void TempoOverlay::DrawScriptPositionContent(const OverlayDrawingCtx& ctx) noexcept
@@ -236,6 +294,35 @@ static float GetPreviousPosition(float beatTime, float currentTime, float beatOf
     return newPosition;
 }
 
+float TempoOverlay::snapToOnset(float position, float fromTime, float beatTime) noexcept
+{
+    auto& tempo = TempoOverlayState::State(stateHandle);
+    if (!tempo.snapToOnsets) return position;
+    auto result = tempoAnalysis.GetResult();
+    if (!result || result->Source != timeline->Wave.data.Pyramid()) return position;
+
+    const bool forward = position > fromTime;
+    const float tolerance = beatTime / 4.f;
+    // already on this beat through an onset just before or after it
+    if (std::abs(position - fromTime) < tolerance) {
+        position += forward ? beatTime : -beatTime;
+    }
+    auto& onsets = result->Onsets;
+    auto it = std::lower_bound(onsets.begin(), onsets.end(), position - tolerance);
+    float snapped = position;
+    float bestDistance = tolerance;
+    for (; it != onsets.end() && *it <= position + tolerance; ++it) {
+        // never snap to the current position or behind it
+        bool inDirection = forward ? *it > fromTime + 0.001f : *it < fromTime - 0.001f;
+        float distance = std::abs(*it - position);
+        if (inDirection && distance <= bestDistance) {
+            snapped = *it;
+            bestDistance = distance;
+        }
+    }
+    return snapped;
+}
+
 void TempoOverlay::nextFrame(float realFrameTime) noexcept
 {
     auto app = OpenFunscripter::ptr;
@@ -244,6 +331,7 @@ void TempoOverlay::nextFrame(float realFrameTime) noexcept
     float beatTime = (60.f / tempo.bpm) * beatMultiples[tempo.measureIndex];
     float currentTime = app->player->CurrentTime();
     float newPosition = GetNextPosition(beatTime, currentTime, tempo.beatOffsetSeconds);
+    newPosition = snapToOnset(newPosition, currentTime, beatTime);
 
     app->player->SetPositionExact(newPosition);
 }
@@ -256,6 +344,7 @@ void TempoOverlay::previousFrame(float realFrameTime) noexcept
     float beatTime = (60.f/ tempo.bpm) * beatMultiples[tempo.measureIndex];
     float currentTime = app->player->CurrentTime();
     float newPosition = GetPreviousPosition(beatTime, currentTime, tempo.beatOffsetSeconds);
+    newPosition = snapToOnset(newPosition, currentTime, beatTime);
 
     app->player->SetPositionExact(newPosition);
 }
@@ -264,12 +353,14 @@ float TempoOverlay::steppingIntervalForward(float realFrameTime, float fromTime)
 {
     auto& tempo = TempoOverlayState::State(stateHandle);
     float beatTime = (60.f / tempo.bpm) * beatMultiples[tempo.measureIndex];
-    return GetNextPosition(beatTime, fromTime, tempo.beatOffsetSeconds) - fromTime;
+    float position = GetNextPosition(beatTime, fromTime, tempo.beatOffsetSeconds);
+    return snapToOnset(position, fromTime, beatTime) - fromTime;
 }
 
 float TempoOverlay::steppingIntervalBackward(float realFrameTime, float fromTime) noexcept
 {
     auto& tempo = TempoOverlayState::State(stateHandle);
     float beatTime = (60.f / tempo.bpm) * beatMultiples[tempo.measureIndex];
-    return GetPreviousPosition(beatTime, fromTime, tempo.beatOffsetSeconds) - fromTime;
+    float position = GetPreviousPosition(beatTime, fromTime, tempo.beatOffsetSeconds);
+    return snapToOnset(position, fromTime, beatTime) - fromTime;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "ScriptPositionsOverlayMode.h"
 #include "OFS_Localization.h"
+#include "OFS_WaveformTempo.h"
 #include <cstdint>
 
 
@@ -54,6 +55,12 @@ private:
 		Tr::TEMPO_64TH_MEASURES,
 	};
 	uint32_t stateHandle = 0xFFFF'FFFF;
+	OFS_WaveformTempo tempoAnalysis;
+
+	void drawTempoDetection() noexcept;
+	// the closest detected onset within a quarter beat of the stepped to position
+	// a beat which fromTime already snapped to is skipped
+	float snapToOnset(float position, float fromTime, float beatTime) noexcept;
 public:
 	TempoOverlay(ScriptTimeline* timeline) noexcept;
 	virtual void DrawSettings() noexcept override;
@@ -106,7 +106,7 @@ void FunctionRangeExtender::SelectionChanged(const FunscriptSelectionChangedEven
 {
     OFS_PROFILE(__FUNCTION__);
     auto app = OpenFunscripter::ptr;
-    if (!app->ActiveFunscript()->Selection().empty()) {
+    if (app->ActiveFunscript()->HasSelection()) {
         rangeExtend = 0;
         createUndoState = true;
     }
@@ -153,7 +153,7 @@ void RamerDouglasPeucker::SelectionChanged(const FunscriptSelectionChangedEvent*
 {
     OFS_PROFILE(__FUNCTION__);
     auto app = OpenFunscripter::ptr;
-    if (!app->ActiveFunscript()->Selection().empty()) {
+    if (app->ActiveFunscript()->HasSelection()) {
         epsilon = 0.f;
         createUndoState = true;
     }
@@ -248,9 +248,10 @@ void RamerDouglasPeucker::DrawUI() noexcept
                 !app->ActiveFunscript()->undoSystem->MatchUndoTop(StateType::SIMPLIFY)) {
                 // calculate average distance in selection
                 int count = 0;
-                for (int i = 0, size = ctx().Selection().size(); i < size - 1; ++i) {
-                    auto action1 = ctx().Selection()[i];
-                    auto action2 = ctx().Selection()[i + 1];
+                auto selection = ctx().GetSelectedActions();
+                for (auto it = selection.begin(), next = it; it != selection.end() && ++next != selection.end(); ++it) {
+                    auto action1 = *it;
+                    auto action2 = *next;
                     
                     float dx = action1.atS - action2.atS;
                     float dy = action1.pos - action2.pos;
@@ -266,7 +267,7 @@ void RamerDouglasPeucker::DrawUI() noexcept
             app->undoSystem->Snapshot(StateType::SIMPLIFY, app->ActiveFunscript());
 
             createUndoState = false;
-            auto selection = ctx().Selection();
+            auto selection = ctx().GetSelectedActions();
             ctx().RemoveSelectedActions();
             FunscriptArray newActions;
             newActions.reserve(selection.size());
@@ -22,6 +22,8 @@ struct CivetwebContext
     mg_context* web = nullptr;
 	char errtxtbuf[256] = {0};
 	SDL_atomic_t clientsConnected = {0};
+	// set by the connection threads, the main thread sends the new clients fresh script snapshots
+	SDL_atomic_t clientsJoined = {0};
 };
 
 #define CTX static_cast<CivetwebContext*>(ctx)
@@ -57,11 +59,11 @@ static int ws_connect_handler(const struct mg_connection *conn, void *ctx) noexc
 /* Handler indicating the client is ready to receive data. */
 static void ws_ready_handler(struct mg_connection *conn, void *user_data) noexcept
 {
-	(void)user_data; /* unused */
-
 	/* Get websocket client context information. */
 	auto clientCtx = (OFS_WebsocketClient*)mg_get_user_connection_data(conn);
 	clientCtx->InitializeConnection(conn);
+	// the snapshots sent by InitializeConnection are only the last published ones
+	SDL_AtomicSet(&static_cast<CivetwebContext*>(user_data)->clientsJoined, 1);
 
 	// const struct mg_request_info *ri = mg_get_request_info(conn);
 
@@ -136,9 +138,8 @@ static int EventSerializationThread(void* user) noexcept
 			for(auto& ev : ctx->events)
 			{
 				auto toJson = dynamic_cast<ToJsonInterface*>(ev.get());
-				nlohmann::json json;
-				toJson->Serialize(json);
-				auto jsonText = Util::SerializeJson(json);
+				std::string jsonText;
+				toJson->SerializeText(jsonText);
 				EV::Queue().directDispatch(WsSerializedEvent::EventType, 
 					std::move(EV::Make<WsSerializedEvent>(std::move(jsonText))));
 			}
@@ -215,6 +216,10 @@ OFS_WebsocketApi::OFS_WebsocketApi() noexcept
 		{
 			if(ClientsConnected() > 0) 
 			{
+				// the clients send the published snapshots, make sure they belong to the new project
+				auto app = OpenFunscripter::ptr;
+				for(auto& script : app->LoadedFunscripts())
+					app->LoadedProject->ScriptSnapshot(*script);
 				// WsProjectChange remains handled by each internal client 
 				// this makes this event really expensive depending on the number of connected clients
 				EV::Queue().directDispatch(WsProjectChange::EventType, EV::Make<WsProjectChange>());
@@ -231,7 +236,10 @@ OFS_WebsocketApi::OFS_WebsocketApi() noexcept
 				auto app = OpenFunscripter::ptr;
 				auto& projectState = app->LoadedProject->State();
 				eventSerializationCtx->Push<WsFunscriptRemove>(ev->oldName);
-				eventSerializationCtx->Push<WsFunscriptChange>(ev->Script->Title(), ev->Script->Data(), projectState.metadata);
+				auto it = std::find_if(app->LoadedFunscripts().begin(), app->LoadedFunscripts().end(), 
+					[Script = ev->Script](auto& script) noexcept { return script.get() == Script; });
+				if(it != app->LoadedFunscripts().end())
+					eventSerializationCtx->Push<WsFunscriptChange>((*it)->Title(), app->LoadedProject->ScriptSnapshot(**it), projectState.metadata);
 			}
 		}
 	));
@@ -366,6 +374,19 @@ void OFS_WebsocketApi::Update() noexcept
 {
 	if(ClientsConnected() <= 0) return;
 
+	if(SDL_AtomicSet(&CTX->clientsJoined, 0))
+	{
+		// snapshots are only published on request, send every script again now that they're fresh
+		auto app = OpenFunscripter::ptr;
+		for(int i=0, size=app->LoadedFunscripts().size(); i < size; i += 1)
+		{
+			if(i + 1 > scriptUpdateCooldown.size()) {
+				scriptUpdateCooldown.resize(i + 1, 0);
+			}
+			scriptUpdateCooldown[i] = SDL_GetTicks();
+		}
+	}
+
 	for(int i=0, size=scriptUpdateCooldown.size(); i < size; i += 1)
 	{
 		auto& cd = scriptUpdateCooldown[i];
@@ -377,7 +398,7 @@ void OFS_WebsocketApi::Update() noexcept
 			{
 				auto& projectState = app->LoadedProject->State();
 				auto& script = app->LoadedFunscripts()[i];
-				eventSerializationCtx->Push<WsFunscriptChange>(script->Title(), script->Data(), projectState.metadata);
+				eventSerializationCtx->Push<WsFunscriptChange>(script->Title(), app->LoadedProject->ScriptSnapshot(*script), projectState.metadata);
 				LOGF_DEBUG("[WsFunscriptChange]: ScriptIdx: %d", i);
 			}
 			cd = 0;
@@ -91,7 +91,10 @@ void OFS_WebsocketClient::UpdateAll() noexcept
     auto& projectState = app->LoadedProject->State();
     for(auto& script : app->LoadedFunscripts())
     {
-        serializeSend(std::move(WsFunscriptChange(script->Title(), script->Data(), projectState.metadata)));
+        // also called from the connection thread, the published snapshot is safe to read from there
+        // it can be behind the actions, OFS_WebsocketApi::Update sends new clients fresh ones
+        if(auto snapshot = script->Snapshot())
+            serializeSend(std::move(WsFunscriptChange(script->Title(), std::move(snapshot), projectState.metadata)));
     }
 }
 
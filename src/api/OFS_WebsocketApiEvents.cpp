@@ -1,4 +1,5 @@
 #include "OFS_WebsocketApiEvents.h"
+#include "FunscriptWriter.h"
 
 inline static void initializeEvent(nlohmann::json& j, const char* eventName)
 {
@@ -45,10 +46,22 @@ void to_json(nlohmann::json& j, const WsFunscriptChange& p)
 {
     initializeEvent(j, "funscript_change");
     nlohmann::json funscript;
-    Funscript::Serialize(funscript, p.funscriptData, p.funscriptMetadata, true);
+    Funscript::Serialize(funscript, *p.snapshot, p.funscriptMetadata, true);
     j["data"] = { { "name", p.name }, { "funscript",  std::move(funscript) } };
 }
 
+void WsFunscriptChange::SerializeText(std::string& text) noexcept
+{
+    // same text as to_json, keys are in the order nlohmann sorts them
+    FunscriptWriter writer;
+    writer.WriteRaw("{\"data\":{\"funscript\":");
+    Funscript::SerializeText(writer, *snapshot, funscriptMetadata, true);
+    writer.WriteRaw(",\"name\":");
+    writer.WriteJson(name);
+    writer.WriteRaw("},\"name\":\"funscript_change\",\"type\":\"event\"}");
+    text = std::move(writer.Text());
+}
+
 void to_json(nlohmann::json& j, const WsFunscriptRemove& p)
 {
     initializeEvent(j, "funscript_remove");
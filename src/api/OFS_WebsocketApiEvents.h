@@ -10,6 +10,13 @@
 struct ToJsonInterface
 {
     virtual void Serialize(nlohmann::json& json) noexcept = 0;
+    // events with large payloads override this to write their text without a json document
+    virtual void SerializeText(std::string& text) noexcept
+    {
+        nlohmann::json json;
+        Serialize(json);
+        text = Util::SerializeJson(json);
+    }
 };
 
 void to_json(nlohmann::json& j, const class WsProjectChange& p);
@@ -77,13 +84,15 @@ class WsFunscriptChange : public OFS_Event<WsFunscriptChange>, public ToJsonInte
 {
     public:
     std::string name;
-    Funscript::FunscriptData funscriptData;
+    // shared with the script, never null
+    std::shared_ptr<const FunscriptSnapshot> snapshot;
     Funscript::Metadata funscriptMetadata;
 
-    WsFunscriptChange(const std::string& name, Funscript::FunscriptData funscriptData, Funscript::Metadata metadata) noexcept
-        : name(name), funscriptData(std::move(funscriptData)), funscriptMetadata(std::move(metadata)) {}
+    WsFunscriptChange(const std::string& name, std::shared_ptr<const FunscriptSnapshot> snapshot, Funscript::Metadata metadata) noexcept
+        : name(name), snapshot(std::move(snapshot)), funscriptMetadata(std::move(metadata)) {}
 
     void Serialize(nlohmann::json& json) noexcept override { to_json(json, *this); }
+    void SerializeText(std::string& text) noexcept override;
 };
 
 class WsProjectChange : public OFS_Event<WsProjectChange>, public ToJsonInterface
@@ -195,11 +195,15 @@ void OFS_LuaExtension::Execute(const std::string& func) noexcept
 	}
 }
 
-void OFS_LuaExtension::ScriptChanged(uint32_t scriptIdx) noexcept
+void OFS_LuaExtension::ScriptChanged(uint32_t scriptIdx, const FunscriptChange& scriptChange) noexcept
 {
 	sol::protected_function change = L[OFS_LuaExtension::ScriptChangeFunction];
 	if(change.valid()) {
-		auto res = change(scriptIdx + 1);
+		// scriptChange(scriptIdx, version, fromTime, toTime)
+		// fromTime and toTime are nil when the whole script changed
+		auto res = scriptChange.IsFull()
+			? change(scriptIdx + 1, scriptChange.Version)
+			: change(scriptIdx + 1, scriptChange.Version, (float)scriptChange.FromTime, (float)scriptChange.ToTime);
 		if(res.status() != sol::call_status::ok) {
 			auto err = sol::stack::get_traceback_or_errors(L.lua_state());
 			AddError(err.what());
@@ -6,6 +6,8 @@
 
 #include <memory>
 
+struct FunscriptChange;
+
 class OFS_LuaExtension
 {
 	private:
@@ -37,7 +39,7 @@ class OFS_LuaExtension
 		void Update() noexcept;
 		void Shutdown() noexcept;
 		void Toggle() noexcept;
-		void ScriptChanged(uint32_t scriptIdx) noexcept;
+		void ScriptChanged(uint32_t scriptIdx, const FunscriptChange& change) noexcept;
 
 		void Execute(const std::string& function) noexcept;
 };
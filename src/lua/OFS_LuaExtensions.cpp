@@ -52,11 +52,11 @@ void OFS_LuaExtensions::load(const std::string& path) noexcept
 	}
 }
 
-void OFS_LuaExtensions::ScriptChanged(uint32_t scriptIdx) noexcept
+void OFS_LuaExtensions::ScriptChanged(uint32_t scriptIdx, const FunscriptChange& change) noexcept
 {
 	for(auto& ext : Extensions)	{
 		if(!ext.Active) continue;
-		ext.ScriptChanged(scriptIdx);
+		ext.ScriptChanged(scriptIdx, change);
 	}
 }
 
@@ -9,6 +9,8 @@
 #include <unordered_map>
 #include <string>
 
+struct FunscriptChange;
+
 struct OFS_LuaBinding
 {
 	std::string GlobalName;
@@ -53,7 +55,7 @@ class OFS_LuaExtensions
         void Update(float delta) noexcept;
         void ShowExtensions() noexcept;
         void ReloadEnabledExtensions() noexcept;
-        void ScriptChanged(uint32_t scriptIdx) noexcept;
+        void ScriptChanged(uint32_t scriptIdx, const FunscriptChange& change) noexcept;
         
         void AddBinding(const std::string& extId, const std::string& uniqueId, const std::string& name) noexcept;
 };
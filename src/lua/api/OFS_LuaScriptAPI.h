@@ -66,10 +66,12 @@ class LuaFunscript
             OFS_PROFILE(__FUNCTION__);
             auto ref = script.lock();
             if(ref) {
-                auto size = ref->Actions().size();
-                actions.reserve(size);
-                for(auto action : ref->Actions()) {
-                    actions.emplace_back(action, ref->IsSelected(action));
+                auto& scriptActions = ref->Actions();
+                auto& selection = ref->Selection();
+                actions.reserve(scriptActions.size());
+                uint32_t i = 0;
+                for(auto& action : scriptActions) {
+                    actions.emplace_back(action, selection.Test(i++));
                 }
             }
         }
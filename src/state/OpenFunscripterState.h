@@ -30,6 +30,11 @@ struct OpenFunscripterState
 		std::string defaultPath = "./";
 	} heatmapSettings;
 
+	struct StatisticsSettings {
+		float speedLimit = 400.f;
+		float pauseThreshold = 10.f;
+	} statisticsSettings;
+
     bool showDebugLog = false;
     bool showVideo = true;
 
@@ -41,6 +46,7 @@ struct OpenFunscripterState
     bool showSpecialFunctions = false;
     bool showWsApi = false;
     bool showChapterManager = false;
+    bool showAudioSync = false;
 
     inline static OpenFunscripterState& State(uint32_t stateHandle) noexcept
     {
@@ -58,6 +64,11 @@ REFL_TYPE(OpenFunscripterState::HeatmapSettings)
 	REFL_FIELD(defaultPath)
 REFL_END
 
+REFL_TYPE(OpenFunscripterState::StatisticsSettings)
+	REFL_FIELD(speedLimit)
+	REFL_FIELD(pauseThreshold)
+REFL_END
+
 REFL_TYPE(OpenFunscripterState)
     REFL_FIELD(recentFiles)
     REFL_FIELD(lastPath)
@@ -69,4 +80,6 @@ REFL_TYPE(OpenFunscripterState)
     REFL_FIELD(showSpecialFunctions)
     REFL_FIELD(showWsApi)
     REFL_FIELD(showChapterManager)
+    REFL_FIELD(showAudioSync)
+    REFL_FIELD(statisticsSettings)
 REFL_END
\ No newline at end of file
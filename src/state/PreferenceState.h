@@ -19,6 +19,8 @@ struct PreferenceState
 	int32_t currentTheme = static_cast<int32_t>(OFS_Theme::Dark);
 
 	int32_t fastStepAmount = 6;
+	// megabytes
+	int32_t undoMemoryLimit = 256;
 
 	int32_t	vsync = 0;
 	int32_t framerateLimit = 150;
@@ -37,6 +39,7 @@ REFL_TYPE(PreferenceState)
 	REFL_FIELD(defaultFontSize)
 	REFL_FIELD(currentTheme)
 	REFL_FIELD(fastStepAmount)
+	REFL_FIELD(undoMemoryLimit)
 	REFL_FIELD(vsync)
 	REFL_FIELD(framerateLimit)
 	REFL_FIELD(forceHwDecoding)
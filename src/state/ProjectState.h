@@ -13,6 +13,8 @@ struct TempoOverlayState
     float bpm = 100.f;
     float beatOffsetSeconds = 0.f;
     uint32_t measureIndex = 0;
+    // stepping moves to a detected onset close to the next beat
+    bool snapToOnsets = false;
 
     inline static TempoOverlayState& State(uint32_t stateHandle) noexcept
     {
@@ -24,6 +26,7 @@ REFL_TYPE(TempoOverlayState)
     REFL_FIELD(bpm)
     REFL_FIELD(beatOffsetSeconds)
     REFL_FIELD(measureIndex)
+    REFL_FIELD(snapToOnsets)
 REFL_END
 
 struct ProjectState